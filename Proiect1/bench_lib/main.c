@@ -0,0 +1,2396 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+//clock_gettime under a strict -std=c11
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cchashtable.h"
+#include "ccconcurrenthashtable.h"
+#include "ccintmap.h"
+#include "ccvector.h"
+#include "ccsort.h"
+#include "cctypedvector.h"
+#include "ccplatform.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+int BenchHashTableRehash();
+int BenchHashTableLookup();
+int BenchHashTableFilter();
+int BenchHashFunctions(const char* CorpusPath);
+int BenchHashTableBatch();
+int BenchHashTableIteration();
+int BenchHashTableInsertionOrder();
+int BenchHashTableFreeze();
+int BenchHashTableSnapshot();
+int BenchIntMap();
+int BenchHashTableUpdate();
+int BenchConcurrentHashTable();
+int BenchLockFreeReads();
+int BenchVectorAppend();
+int BenchVectorSort();
+int BenchVectorSortParallel();
+int BenchVectorKernels();
+int BenchTypedVectorSort();
+int BenchSmallVectors();
+int BenchMappedVector();
+
+void RunBenchmarks(const char* CorpusPath);
+
+// bench_lib [corpus]
+// corpus is an optional text file with one key per line, used by the hash function benchmark
+int main(int argc, char* argv[])
+{
+    RunBenchmarks(argc > 1 ? argv[1] : NULL);
+
+    return 0;
+}
+
+void RunBenchmarks(const char* CorpusPath)
+{
+    /// NOTE: build and run the Release configuration, Debug numbers are meaningless.
+    if (0 != BenchHashTableRehash())
+    {
+        printf("HashTable rehash benchmark failed\n\n");
+    }
+
+    if (0 != BenchHashTableLookup())
+    {
+        printf("HashTable lookup benchmark failed\n\n");
+    }
+
+    if (0 != BenchHashTableFilter())
+    {
+        printf("HashTable filter benchmark failed\n\n");
+    }
+
+    if (0 != BenchHashTableIteration())
+    {
+        printf("HashTable iteration benchmark failed\n\n");
+    }
+
+    if (0 != BenchHashTableInsertionOrder())
+    {
+        printf("HashTable insertion order benchmark failed\n\n");
+    }
+
+    if (0 != BenchHashTableFreeze())
+    {
+        printf("HashTable freeze benchmark failed\n\n");
+    }
+
+    if (0 != BenchHashTableSnapshot())
+    {
+        printf("HashTable snapshot benchmark failed\n\n");
+    }
+
+    if (0 != BenchIntMap())
+    {
+        printf("IntMap benchmark failed\n\n");
+    }
+
+    if (0 != BenchHashTableUpdate())
+    {
+        printf("HashTable update benchmark failed\n\n");
+    }
+
+    if (0 != BenchHashTableBatch())
+    {
+        printf("HashTable batch benchmark failed\n\n");
+    }
+
+    if (0 != BenchConcurrentHashTable())
+    {
+        printf("ConcurrentHashTable benchmark failed\n\n");
+    }
+
+    if (0 != BenchLockFreeReads())
+    {
+        printf("Lock-free read benchmark failed\n\n");
+    }
+
+    if (0 != BenchHashFunctions(CorpusPath))
+    {
+        printf("Hash function benchmark failed\n\n");
+    }
+
+    if (0 != BenchVectorAppend())
+    {
+        printf("Vector append benchmark failed\n\n");
+    }
+
+    if (0 != BenchVectorSort())
+    {
+        printf("Vector sort benchmark failed\n\n");
+    }
+
+    if (0 != BenchVectorSortParallel())
+    {
+        printf("Vector parallel sort benchmark failed\n\n");
+    }
+
+    if (0 != BenchVectorKernels())
+    {
+        printf("Vector kernel benchmark failed\n\n");
+    }
+
+    if (0 != BenchTypedVectorSort())
+    {
+        printf("Typed vector sort benchmark failed\n\n");
+    }
+
+    if (0 != BenchSmallVectors())
+    {
+        printf("Small vector benchmark failed\n\n");
+    }
+
+    if (0 != BenchMappedVector())
+    {
+        printf("Mapped vector benchmark failed\n\n");
+    }
+}
+
+// Monotonic time in nanoseconds
+unsigned long long BenchNow()
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (unsigned long long)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+#endif
+}
+
+// Builds Count distinct path-like keys, all stored in one buffer released with BenchFreeKeys
+// The buffer is also kept after the last key so the keys can be shuffled
+char** BenchMakeKeys(int Count, int Seed)
+{
+    char** keys;
+    char* buffer;
+    const int maxLength = 64;
+
+    keys = (char**)malloc(sizeof(char*) * ((size_t)Count + 1));
+    buffer = (char*)malloc((size_t)maxLength * (size_t)Count);
+    if (keys == NULL || buffer == NULL)
+    {
+        free(keys);
+        free(buffer);
+        return NULL;
+    }
+
+    for (int i = 0; i < Count; i++)
+    {
+        keys[i] = buffer + (size_t)i * maxLength;
+        snprintf(keys[i], (size_t)maxLength, "/srv/data/%d/user%d/file%d.log", Seed, i % 977, i);
+    }
+    keys[Count] = buffer;
+    return keys;
+}
+
+void BenchFreeKeys(char** Keys, int Count)
+{
+    if (Keys != NULL)
+    {
+        free(Keys[Count]);
+        free(Keys);
+    }
+}
+
+int CompareLatencies(const void* First, const void* Second)
+{
+    unsigned long long first = *(const unsigned long long*)First;
+    unsigned long long second = *(const unsigned long long*)Second;
+
+    return (first > second) - (first < second);
+}
+
+// Inserts Count keys timing every call, then prints the latency percentiles
+int BenchInsertLatency(const char* Name, CC_HASH_TABLE_OPTIONS* Options, char** Keys, int Count, unsigned long long* Latencies)
+{
+    CC_HASH_TABLE* table = NULL;
+    unsigned long long total = 0;
+
+    if (0 != HtCreateEx(&table, Options))
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < Count; i++)
+    {
+        unsigned long long start = BenchNow();
+        if (0 != HtSetKeyValue(table, Keys[i], i))
+        {
+            HtDestroy(&table);
+            return -1;
+        }
+        Latencies[i] = BenchNow() - start;
+        total += Latencies[i];
+    }
+
+    qsort(Latencies, (size_t)Count, sizeof(Latencies[0]), CompareLatencies);
+    printf("%-12s total %8.1f ms  p50 %6llu ns  p99 %6llu ns  p99.9 %8llu ns  max %10llu ns\n",
+        Name,
+        (double)total / 1e6,
+        Latencies[Count / 2],
+        Latencies[(int)((double)Count * 0.99)],
+        Latencies[(int)((double)Count * 0.999)],
+        Latencies[Count - 1]);
+
+    return HtDestroy(&table);
+}
+
+int BenchHashTableRehash()
+{
+    const int count = 1 << 21;
+    int retVal = -1;
+    char** keys = NULL;
+    unsigned long long* latencies = NULL;
+    CC_HASH_TABLE_OPTIONS stopTheWorld = { 0 };
+    CC_HASH_TABLE_OPTIONS incremental = { 0 };
+
+    incremental.Flags = HT_FLAG_INCREMENTAL_REHASH;
+
+    printf("HtSetKeyValue latency, %d keys\n", count);
+
+    keys = BenchMakeKeys(count, 0);
+    latencies = (unsigned long long*)malloc(sizeof(unsigned long long) * (size_t)count);
+    if (keys == NULL || latencies == NULL)
+    {
+        goto cleanup;
+    }
+
+    retVal = BenchInsertLatency("rehash", &stopTheWorld, keys, count, latencies);
+    if (0 != retVal)
+    {
+        goto cleanup;
+    }
+
+    retVal = BenchInsertLatency("incremental", &incremental, keys, count, latencies);
+
+cleanup:
+    printf("\n");
+    BenchFreeKeys(keys, count);
+    free(latencies);
+    return retVal;
+}
+
+// Shuffles Keys in place so lookups do not follow the insertion order
+void BenchShuffleKeys(char** Keys, int Count)
+{
+    unsigned int seed = 12345;
+
+    for (int i = Count - 1; i > 0; i--)
+    {
+        int j;
+        char* temp;
+
+        seed = seed * 1103515245 + 12345;
+        j = (int)((seed >> 8) % (unsigned int)(i + 1));
+        temp = Keys[i];
+        Keys[i] = Keys[j];
+        Keys[j] = temp;
+    }
+}
+
+// Returns the number of HtGetKeyValue calls per second over Keys
+double BenchLookupRate(CC_HASH_TABLE* Table, char** Keys, int Count, int* Found)
+{
+    unsigned long long start;
+    int value;
+
+    *Found = 0;
+    start = BenchNow();
+    for (int i = 0; i < Count; i++)
+    {
+        *Found += (0 == HtGetKeyValue(Table, Keys[i], &value));
+    }
+    return (double)Count * 1e9 / (double)(BenchNow() - start);
+}
+
+int BenchHashTableLookup()
+{
+    const int count = 1 << 20;
+    const char* names[] = { "scalar", "sse2", "sse4.1", "avx2" };
+    int retVal = -1;
+    char** keys = NULL;
+    char** missingKeys = NULL;
+    CC_HASH_TABLE* table = NULL;
+
+    printf("HtGetKeyValue throughput, %d keys\n", count);
+
+    keys = BenchMakeKeys(count, 0);
+    missingKeys = BenchMakeKeys(count, 1);
+    if (keys == NULL || missingKeys == NULL)
+    {
+        goto cleanup;
+    }
+
+    for (int level = CC_SIMD_NONE; level <= CC_SIMD_AVX2; level++)
+    {
+        int hits, misses;
+        double hitRate, missRate;
+
+        if (level == CC_SIMD_SSE41)
+        {
+            //the control byte scan has no SSE4.1 specific code
+            continue;
+        }
+
+        CcSetSimdLevel(level);
+        if (CcGetSimdLevel() != level)
+        {
+            printf("%-8s not supported\n", names[level]);
+            continue;
+        }
+
+        retVal = HtCreate(&table);
+        if (0 != retVal)
+        {
+            goto cleanup;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            HtSetKeyValue(table, keys[i], i);
+        }
+        BenchShuffleKeys(keys, count);
+
+        hitRate = BenchLookupRate(table, keys, count, &hits);
+        missRate = BenchLookupRate(table, missingKeys, count, &misses);
+        printf("%-8s hits %7.2f M/s  misses %7.2f M/s\n", names[level], hitRate / 1e6, missRate / 1e6);
+
+        HtDestroy(&table);
+        if (hits != count || misses != 0)
+        {
+            printf("Invalid lookup results!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    retVal = 0;
+
+cleanup:
+    CcSetSimdLevel(CC_SIMD_AVX2);
+    printf("\n");
+    if (NULL != table)
+    {
+        HtDestroy(&table);
+    }
+    BenchFreeKeys(keys, count);
+    BenchFreeKeys(missingKeys, count);
+    return retVal;
+}
+
+// Lookups where only 1 in 20 keys is in the table, like a deduplication pass
+int BenchHashTableFilter()
+{
+    const int sizes[] = { 1 << 16, 1 << 20, 1 << 22 };
+    const int lookupCount = 1 << 20;
+    int retVal = -1;
+    char** keys = NULL;
+    char** missingKeys = NULL;
+    char** lookups = NULL;
+    CC_HASH_TABLE* table = NULL;
+
+    printf("HtGetKeyValue with 95%% misses, with and without HT_FLAG_BLOOM_FILTER\n");
+
+    keys = BenchMakeKeys(sizes[2], 0);
+    missingKeys = BenchMakeKeys(lookupCount, 1);
+    lookups = (char**)malloc(sizeof(char*) * (size_t)lookupCount);
+    if (keys == NULL || missingKeys == NULL || lookups == NULL)
+    {
+        goto cleanup;
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < lookupCount; j++)
+        {
+            lookups[j] = j % 20 == 0 ? keys[((unsigned int)j * 2654435761u) % (unsigned int)sizes[i]] : missingKeys[j];
+        }
+
+        for (int filtered = 0; filtered < 2; filtered++)
+        {
+            CC_HASH_TABLE_OPTIONS options = { 0 };
+            CC_HASH_TABLE_STATS stats;
+            double rate;
+            int hits;
+
+            options.Flags = filtered ? HT_FLAG_BLOOM_FILTER : 0;
+            options.ExpectedKeyCount = sizes[i];
+            retVal = HtCreateEx(&table, &options);
+            if (0 != retVal)
+            {
+                goto cleanup;
+            }
+            for (int j = 0; j < sizes[i]; j++)
+            {
+                HtSetKeyValue(table, keys[j], j);
+            }
+
+            rate = BenchLookupRate(table, lookups, lookupCount, &hits);
+            HtGetStats(table, &stats);
+            printf("%8d keys %-9s %7.2f M/s", sizes[i], filtered ? "filter" : "no filter", rate / 1e6);
+            if (filtered)
+            {
+                printf("  %6.2f MB %5.2f bits/key fpr %.4f", (double)stats.FilterBytes / 1e6, stats.FilterBitsPerKey, stats.FilterFalsePositiveRate);
+            }
+            printf("\n");
+
+            HtDestroy(&table);
+            if (hits != (lookupCount + 19) / 20)
+            {
+                printf("Invalid lookup results!\n");
+                retVal = -1;
+                goto cleanup;
+            }
+        }
+    }
+    retVal = 0;
+
+cleanup:
+    printf("\n");
+    if (NULL != table)
+    {
+        HtDestroy(&table);
+    }
+    free(lookups);
+    BenchFreeKeys(keys, sizes[2]);
+    BenchFreeKeys(missingKeys, lookupCount);
+    return retVal;
+}
+
+// Walks the whole table with a stack iterator, returns the time taken in ns
+unsigned long long BenchIterate(CC_HASH_TABLE* Table, int* Keys)
+{
+    CC_HASH_TABLE_ITERATOR iterator;
+    unsigned long long start;
+    char* key;
+
+    *Keys = 0;
+    start = BenchNow();
+    for (int retVal = HtInitIterator(Table, &iterator, &key); retVal == 0; retVal = HtGetNextKey(&iterator, &key))
+    {
+        *Keys += 1;
+    }
+    return BenchNow() - start;
+}
+
+int BenchHashTableIteration()
+{
+    const int count = 1 << 20;
+    const int sparseCount = 1000;
+    int retVal = -1;
+    char** keys = NULL;
+    CC_HASH_TABLE* table = NULL;
+    unsigned long long time;
+    int iterated;
+
+    printf("HtInitIterator / HtGetNextKey, %d keys\n", count);
+
+    keys = BenchMakeKeys(count, 0);
+    if (keys == NULL)
+    {
+        goto cleanup;
+    }
+
+    retVal = HtCreate(&table);
+    if (0 != retVal)
+    {
+        goto cleanup;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        HtSetKeyValue(table, keys[i], i);
+    }
+
+    time = BenchIterate(table, &iterated);
+    printf("full table   %8d keys %10.2f ms %6.2f ns/key\n", iterated, (double)time / 1e6, (double)time / iterated);
+
+    //the capacity stays the same, the bitmap skips the empty stretches
+    for (int i = sparseCount; i < count; i++)
+    {
+        HtRemoveKey(table, keys[i]);
+    }
+    time = BenchIterate(table, &iterated);
+    printf("sparse table %8d keys %10.2f ms %6.2f ns/key\n", iterated, (double)time / 1e6, (double)time / iterated);
+
+    if (iterated != sparseCount)
+    {
+        printf("Invalid iteration results!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    retVal = 0;
+
+cleanup:
+    printf("\n");
+    if (NULL != table)
+    {
+        HtDestroy(&table);
+    }
+    BenchFreeKeys(keys, count);
+    return retVal;
+}
+
+// Bytes taken by the slot arrays of Table, the keys themselves are not counted
+size_t BenchTableBytes(CC_HASH_TABLE* Table)
+{
+    size_t capacity = (size_t)Table->Table.Capacity;
+    size_t bytes = 16 + capacity + 16 + (capacity + 63) / 64 * 8;
+
+    if (Table->Flags & HT_FLAG_FROZEN)
+    {
+        return (size_t)Table->Count * sizeof(NODEH) + (size_t)Table->Frozen.BucketCount * sizeof(unsigned int);
+    }
+    if (Table->Table.Index != NULL)
+    {
+        return bytes + capacity * sizeof(unsigned int) + (size_t)Table->Table.EntryCapacity * sizeof(NODEH);
+    }
+    return bytes + capacity * sizeof(NODEH);
+}
+
+int BenchHashTableInsertionOrder()
+{
+    const int maxCount = 1 << 20;
+    int retVal = -1;
+    char** keys = NULL;
+    CC_HASH_TABLE* table = NULL;
+    CC_HASH_TABLE_OPTIONS options = { 0 };
+
+    printf("HT_FLAG_INSERTION_ORDER, memory, full iteration and lookups\n");
+
+    keys = BenchMakeKeys(maxCount, 0);
+    if (keys == NULL)
+    {
+        goto cleanup;
+    }
+
+    for (int count = 1000; count <= maxCount; count *= 32)
+    {
+        for (int ordered = 0; ordered < 2; ordered++)
+        {
+            unsigned long long time;
+            double rate;
+            int iterated;
+            int hits;
+
+            options.Flags = ordered ? HT_FLAG_INSERTION_ORDER : 0;
+            retVal = HtCreateEx(&table, &options);
+            if (0 != retVal)
+            {
+                goto cleanup;
+            }
+            for (int i = 0; i < count; i++)
+            {
+                HtSetKeyValue(table, keys[i], i);
+            }
+
+            time = BenchIterate(table, &iterated);
+            rate = BenchLookupRate(table, keys, count, &hits);
+            printf("%-9s %8d keys %6.1f bytes/key iterate %6.2f ns/key lookup %8.2f Mops/s\n",
+                ordered ? "ordered" : "swiss", count, (double)BenchTableBytes(table) / count,
+                (double)time / iterated, rate / 1e6);
+            HtDestroy(&table);
+
+            if (iterated != count || hits != count)
+            {
+                printf("Invalid results!\n");
+                retVal = -1;
+                goto cleanup;
+            }
+        }
+    }
+    retVal = 0;
+
+cleanup:
+    printf("\n");
+    if (NULL != table)
+    {
+        HtDestroy(&table);
+    }
+    BenchFreeKeys(keys, maxCount);
+    return retVal;
+}
+
+int BenchHashTableFreeze()
+{
+    const int maxCount = 1 << 22;
+    int retVal = -1;
+    char** keys = NULL;
+    char** missingKeys = NULL;
+    CC_HASH_TABLE* table = NULL;
+
+    printf("HtFreeze, memory and lookups against the mutable table\n");
+
+    keys = BenchMakeKeys(maxCount, 0);
+    missingKeys = BenchMakeKeys(maxCount, 1);
+    if (keys == NULL || missingKeys == NULL)
+    {
+        goto cleanup;
+    }
+
+    for (int count = 1000; count <= maxCount; count *= 64)
+    {
+        unsigned long long start;
+        int hits;
+        int misses;
+
+        retVal = HtCreate(&table);
+        if (0 != retVal)
+        {
+            goto cleanup;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            HtSetKeyValue(table, keys[i], i);
+        }
+        BenchShuffleKeys(keys, count);
+
+        for (int frozen = 0; frozen < 2; frozen++)
+        {
+            double hitRate;
+            double missRate;
+
+            start = BenchNow();
+            if (frozen && 0 != HtFreeze(table))
+            {
+                printf("HtFreeze failed!\n");
+                retVal = -1;
+                goto cleanup;
+            }
+            if (frozen)
+            {
+                printf("%8d keys frozen in %.2f ms\n", count, (double)(BenchNow() - start) / 1e6);
+            }
+
+            hitRate = BenchLookupRate(table, keys, count, &hits);
+            missRate = BenchLookupRate(table, missingKeys, count, &misses);
+            printf("%-7s %8d keys %6.1f bytes/key hit %8.2f Mops/s miss %8.2f Mops/s\n",
+                frozen ? "frozen" : "mutable", count, (double)BenchTableBytes(table) / count, hitRate / 1e6, missRate / 1e6);
+
+            if (hits != count || misses != 0)
+            {
+                printf("Invalid lookup results!\n");
+                retVal = -1;
+                goto cleanup;
+            }
+        }
+        HtDestroy(&table);
+    }
+    retVal = 0;
+
+cleanup:
+    printf("\n");
+    if (NULL != table)
+    {
+        HtDestroy(&table);
+    }
+    BenchFreeKeys(keys, maxCount);
+    BenchFreeKeys(missingKeys, maxCount);
+    return retVal;
+}
+
+// Cold start: filling a table from the keys against loading a snapshot of it
+int BenchHashTableSnapshot()
+{
+    const int maxCount = 1 << 22;
+    const char* path = "bench_hashtable.snap";
+    int retVal = -1;
+    char** keys = NULL;
+    CC_HASH_TABLE* table = NULL;
+    CC_HASH_TABLE* loaded = NULL;
+
+    printf("HtSaveSnapshot / HtLoadSnapshot, startup time\n");
+
+    keys = BenchMakeKeys(maxCount, 0);
+    if (keys == NULL)
+    {
+        goto cleanup;
+    }
+
+    for (int count = 1000; count <= maxCount; count *= 64)
+    {
+        unsigned long long buildTime;
+        unsigned long long saveTime;
+        unsigned long long loadTime;
+        unsigned long long verifyTime;
+        double rate;
+        int hits;
+
+        buildTime = BenchNow();
+        retVal = HtCreate(&table);
+        if (0 != retVal)
+        {
+            goto cleanup;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            HtSetKeyValue(table, keys[i], i);
+        }
+        buildTime = BenchNow() - buildTime;
+
+        saveTime = BenchNow();
+        retVal = HtSaveSnapshot(table, path);
+        saveTime = BenchNow() - saveTime;
+        if (0 != retVal)
+        {
+            goto cleanup;
+        }
+
+        verifyTime = BenchNow();
+        retVal = HtLoadSnapshot(&loaded, path, HT_SNAPSHOT_VERIFY);
+        verifyTime = BenchNow() - verifyTime;
+        HtDestroy(&loaded);
+
+        loadTime = BenchNow();
+        retVal |= HtLoadSnapshot(&loaded, path, 0);
+        loadTime = BenchNow() - loadTime;
+        if (0 != retVal)
+        {
+            goto cleanup;
+        }
+
+        //the first lookups fault the pages in
+        rate = BenchLookupRate(loaded, keys, count, &hits);
+        printf("%8d keys build %9.2f ms save %9.2f ms load %7.3f ms (verified %8.2f ms) lookup %6.2f Mops/s\n",
+            count, (double)buildTime / 1e6, (double)saveTime / 1e6, (double)loadTime / 1e6, (double)verifyTime / 1e6, rate / 1e6);
+
+        HtDestroy(&loaded);
+        HtDestroy(&table);
+        if (hits != count)
+        {
+            printf("Invalid lookup results!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    retVal = 0;
+
+cleanup:
+    printf("\n");
+    if (NULL != table)
+    {
+        HtDestroy(&table);
+    }
+    if (NULL != loaded)
+    {
+        HtDestroy(&loaded);
+    }
+    remove(path);
+    BenchFreeKeys(keys, maxCount);
+    return retVal;
+}
+
+// Integer ids in CC_INT_MAP against the same ids formatted into CC_HASH_TABLE keys,
+// the string side pays for the formatting on every call like its callers do
+int BenchIntMap()
+{
+    const int count = 1 << 20;
+    int retVal = -1;
+    long long* ids = NULL;
+    CC_INT_MAP* map = NULL;
+    CC_HASH_TABLE* table = NULL;
+    char key[32];
+    unsigned long long start;
+    double insertTime;
+    double lookupTime;
+    int value;
+    int found;
+
+    printf("CC_INT_MAP against snprintf keys in CC_HASH_TABLE, %d ids\n", count);
+
+    ids = (long long*)malloc(sizeof(long long) * (size_t)count);
+    if (ids == NULL)
+    {
+        goto cleanup;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        //sparse 40-bit ids, like database keys
+        ids[i] = ((long long)i << 20) ^ (long long)((unsigned int)i * 2654435761u % 1000003);
+    }
+
+    retVal = ImCreate(&map);
+    if (0 != retVal)
+    {
+        goto cleanup;
+    }
+    start = BenchNow();
+    for (int i = 0; i < count; i++)
+    {
+        ImSetKeyValue(map, ids[i], i);
+    }
+    insertTime = (double)(BenchNow() - start);
+    found = 0;
+    start = BenchNow();
+    for (int i = 0; i < count; i++)
+    {
+        found += (0 == ImGetKeyValue(map, ids[((unsigned int)i * 7919u) & (unsigned int)(count - 1)], &value));
+    }
+    lookupTime = (double)(BenchNow() - start);
+    printf("int map      insert %6.2f ns/key lookup %6.2f ns/key\n", insertTime / count, lookupTime / count);
+    if (found != count)
+    {
+        printf("Invalid lookup results!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    //the table owns its keys, the formatting buffer is reused like a caller would
+    CC_HASH_TABLE_OPTIONS options = { 0 };
+    options.Flags = HT_FLAG_OWN_KEYS;
+    retVal = HtCreateEx(&table, &options);
+    if (0 != retVal)
+    {
+        goto cleanup;
+    }
+    start = BenchNow();
+    for (int i = 0; i < count; i++)
+    {
+        snprintf(key, sizeof(key), "%lld", ids[i]);
+        HtSetKeyValue(table, key, i);
+    }
+    insertTime = (double)(BenchNow() - start);
+    found = 0;
+    start = BenchNow();
+    for (int i = 0; i < count; i++)
+    {
+        snprintf(key, sizeof(key), "%lld", ids[((unsigned int)i * 7919u) & (unsigned int)(count - 1)]);
+        found += (0 == HtGetKeyValue(table, key, &value));
+    }
+    lookupTime = (double)(BenchNow() - start);
+    printf("string table insert %6.2f ns/key lookup %6.2f ns/key\n", insertTime / count, lookupTime / count);
+    if (found != count)
+    {
+        printf("Invalid lookup results!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    retVal = 0;
+
+cleanup:
+    printf("\n");
+    if (NULL != map)
+    {
+        ImDestroy(&map);
+    }
+    if (NULL != table)
+    {
+        HtDestroy(&table);
+    }
+    free(ids);
+    return retVal;
+}
+
+// Word count over Distinct keys: Updates increments, each done with one of the update patterns
+//      0 - get, remove and set again, all the table offered before HtIncrementBy
+//      1 - HtIncrementBy
+//      2 - HtGetValuePtr, HtSetKeyValue for the first occurrence
+double BenchUpdateRate(int Pattern, char** Keys, int Distinct, int Updates, int* Total)
+{
+    CC_HASH_TABLE* table = NULL;
+    CC_HASH_TABLE_ITERATOR iterator;
+    unsigned long long start;
+    double elapsed;
+    char* key;
+    int value;
+    int* valuePtr;
+
+    if (0 != HtCreate(&table))
+    {
+        return 0;
+    }
+
+    start = BenchNow();
+    for (int i = 0; i < Updates; i++)
+    {
+        key = Keys[((unsigned int)i * 2654435761u) % (unsigned int)Distinct];
+        if (Pattern == 0)
+        {
+            value = 0;
+            if (0 == HtGetKeyValue(table, key, &value))
+            {
+                HtRemoveKey(table, key);
+            }
+            HtSetKeyValue(table, key, value + 1);
+        }
+        else if (Pattern == 1)
+        {
+            HtIncrementBy(table, key, 1, NULL);
+        }
+        else if (0 == HtGetValuePtr(table, key, &valuePtr))
+        {
+            *valuePtr += 1;
+        }
+        else
+        {
+            HtSetKeyValue(table, key, 1);
+        }
+    }
+    elapsed = (double)(BenchNow() - start);
+
+    *Total = 0;
+    for (int status = HtInitIterator(table, &iterator, &key); status >= 0; status = HtGetNextKey(&iterator, &key))
+    {
+        HtGetKeyValue(table, key, &value);
+        *Total += value;
+    }
+    HtDestroy(&table);
+    return (double)Updates * 1e9 / elapsed;
+}
+
+int BenchHashTableUpdate()
+{
+    const int updates = 1 << 22;
+    const int distinctCounts[] = { 1000, 64000, 1000000 };
+    const char* names[] = { "get/remove/set", "HtIncrementBy", "HtGetValuePtr" };
+    int retVal = -1;
+    char** keys = NULL;
+    int total;
+
+    printf("Read-modify-write, %d increments\n", updates);
+    keys = BenchMakeKeys(distinctCounts[2], 3);
+    if (keys == NULL)
+    {
+        goto cleanup;
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        printf("%8d keys", distinctCounts[i]);
+        for (int pattern = 0; pattern < 3; pattern++)
+        {
+            double rate = BenchUpdateRate(pattern, keys, distinctCounts[i], updates, &total);
+
+            printf("  %s %6.2f Mops/s", names[pattern], rate / 1e6);
+            if (total != updates)
+            {
+                printf("\nInvalid sum of the counters!\n");
+                goto cleanup;
+            }
+        }
+        printf("\n");
+    }
+    retVal = 0;
+
+cleanup:
+    printf("\n");
+    if (NULL != keys)
+    {
+        BenchFreeKeys(keys, distinctCounts[2]);
+    }
+    return retVal;
+}
+
+// Returns the number of keys per second looked up through HtGetKeyValueMany in batches of BatchSize
+double BenchBatchLookupRate(CC_HASH_TABLE* Table, char** Keys, int Count, int BatchSize, int* Values, int* Results, int* Found)
+{
+    unsigned long long start;
+
+    *Found = 0;
+    start = BenchNow();
+    for (int i = 0; i < Count; i += BatchSize)
+    {
+        int batch = Count - i < BatchSize ? Count - i : BatchSize;
+        *Found += HtGetKeyValueMany(Table, Keys + i, batch, Values, Results);
+    }
+    return (double)Count * 1e9 / (double)(BenchNow() - start);
+}
+
+int BenchHashTableBatch()
+{
+    const int count = 1 << 20;
+    const int batchSizes[] = { 8, 32, 256 };
+    int retVal = -1;
+    char** keys = NULL;
+    char** missingKeys = NULL;
+    int* values = NULL;
+    int* results = NULL;
+    CC_HASH_TABLE* table = NULL;
+    unsigned long long start;
+    double rate;
+    int hits, misses;
+
+    printf("HtGetKeyValueMany / HtSetKeyValueMany throughput, %d keys\n", count);
+
+    keys = BenchMakeKeys(count, 0);
+    missingKeys = BenchMakeKeys(count, 1);
+    values = (int*)malloc(count * sizeof(int));
+    results = (int*)malloc(count * sizeof(int));
+    if (keys == NULL || missingKeys == NULL || values == NULL || results == NULL)
+    {
+        goto cleanup;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        values[i] = i;
+    }
+
+    //inserts, single calls first
+    retVal = HtCreate(&table);
+    if (0 != retVal)
+    {
+        goto cleanup;
+    }
+    start = BenchNow();
+    for (int i = 0; i < count; i++)
+    {
+        HtSetKeyValue(table, keys[i], values[i]);
+    }
+    rate = (double)count * 1e9 / (double)(BenchNow() - start);
+    printf("set single     %7.2f M/s\n", rate / 1e6);
+    HtDestroy(&table);
+
+    for (int b = 0; b < (int)(sizeof(batchSizes) / sizeof(batchSizes[0])); b++)
+    {
+        int inserted = 0;
+
+        retVal = HtCreate(&table);
+        if (0 != retVal)
+        {
+            goto cleanup;
+        }
+        start = BenchNow();
+        for (int i = 0; i < count; i += batchSizes[b])
+        {
+            int batch = count - i < batchSizes[b] ? count - i : batchSizes[b];
+            inserted += HtSetKeyValueMany(table, keys + i, values + i, batch, results + i);
+        }
+        rate = (double)count * 1e9 / (double)(BenchNow() - start);
+        printf("set batch %-4d %7.2f M/s\n", batchSizes[b], rate / 1e6);
+        if (inserted != count)
+        {
+            printf("Invalid insert results!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+        HtDestroy(&table);
+    }
+
+    //lookups on one table, random order so every probe misses the cache
+    retVal = HtCreate(&table);
+    if (0 != retVal)
+    {
+        goto cleanup;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        HtSetKeyValue(table, keys[i], i);
+    }
+    BenchShuffleKeys(keys, count);
+
+    rate = BenchLookupRate(table, keys, count, &hits);
+    printf("get single     hits %7.2f M/s", rate / 1e6);
+    rate = BenchLookupRate(table, missingKeys, count, &misses);
+    printf("  misses %7.2f M/s\n", rate / 1e6);
+
+    for (int b = 0; b < (int)(sizeof(batchSizes) / sizeof(batchSizes[0])); b++)
+    {
+        rate = BenchBatchLookupRate(table, keys, count, batchSizes[b], values, results, &hits);
+        printf("get batch %-4d hits %7.2f M/s", batchSizes[b], rate / 1e6);
+        rate = BenchBatchLookupRate(table, missingKeys, count, batchSizes[b], values, results, &misses);
+        printf("  misses %7.2f M/s\n", rate / 1e6);
+        if (hits != count || misses != 0)
+        {
+            printf("Invalid lookup results!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    retVal = 0;
+
+cleanup:
+    printf("\n");
+    if (NULL != table)
+    {
+        HtDestroy(&table);
+    }
+    BenchFreeKeys(keys, count);
+    BenchFreeKeys(missingKeys, count);
+    free(values);
+    free(results);
+    return retVal;
+}
+
+#define BENCH_MAX_THREADS 32
+
+typedef struct _BENCH_MIX_CONTEXT {
+    CC_CONCURRENT_HASH_TABLE* Table;
+    char** Keys;            //every key, the reads pick from all of them
+    int KeyCount;
+    int FirstOwnKey;        //writes only touch Keys[FirstOwnKey .. FirstOwnKey + OwnKeyCount)
+    int OwnKeyCount;
+    int ReadPercent;
+    int Operations;
+    unsigned int Seed;
+} BENCH_MIX_CONTEXT;
+
+// Runs a random mix of lookups and writes. A write removes one of the thread's own keys
+// and the next write puts it back, so the table size stays the same.
+void BenchMixThread(void* Context)
+{
+    BENCH_MIX_CONTEXT* context = (BENCH_MIX_CONTEXT*)Context;
+    unsigned int seed = context->Seed;
+    int nextOwnKey = 0;
+    int removedKey = -1;
+    int value;
+
+    for (int i = 0; i < context->Operations; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        if ((int)((seed >> 8) % 100) < context->ReadPercent)
+        {
+            ChtGetKeyValue(context->Table, context->Keys[(seed >> 4) % (unsigned int)context->KeyCount], &value);
+        }
+        else if (removedKey >= 0)
+        {
+            ChtSetKeyValue(context->Table, context->Keys[removedKey], removedKey);
+            removedKey = -1;
+        }
+        else
+        {
+            removedKey = context->FirstOwnKey + nextOwnKey;
+            nextOwnKey = (nextOwnKey + 1) % context->OwnKeyCount;
+            ChtRemoveKey(context->Table, context->Keys[removedKey]);
+        }
+    }
+
+    //leave the table as it was
+    if (removedKey >= 0)
+    {
+        ChtSetKeyValue(context->Table, context->Keys[removedKey], removedKey);
+    }
+}
+
+int BenchConcurrentHashTable()
+{
+    const int count = 1 << 20;
+    const int operations = 1 << 22;
+    const int threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+    const int readPercents[] = { 90, 50 };
+    const int shardCounts[] = { 1, CHT_DEFAULT_SHARD_COUNT };
+    int retVal = -1;
+    char** keys = NULL;
+    CC_CONCURRENT_HASH_TABLE* table = NULL;
+    BENCH_MIX_CONTEXT contexts[BENCH_MAX_THREADS];
+    CC_THREAD threads[BENCH_MAX_THREADS];
+
+    printf("CC_CONCURRENT_HASH_TABLE throughput, %d keys, %d operations, %d processors\n", count, operations, CcGetProcessorCount());
+    printf("1 shard is the same as one global reader-writer lock around a CC_HASH_TABLE\n");
+
+    keys = BenchMakeKeys(count, 0);
+    if (keys == NULL)
+    {
+        goto cleanup;
+    }
+
+    for (int s = 0; s < (int)(sizeof(shardCounts) / sizeof(shardCounts[0])); s++)
+    {
+        retVal = ChtCreate(&table, shardCounts[s], NULL);
+        if (0 != retVal)
+        {
+            goto cleanup;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            ChtSetKeyValue(table, keys[i], i);
+        }
+
+        for (int m = 0; m < (int)(sizeof(readPercents) / sizeof(readPercents[0])); m++)
+        {
+            printf("%4d shards %d/%d reads/writes:", shardCounts[s], readPercents[m], 100 - readPercents[m]);
+            for (int t = 0; t < (int)(sizeof(threadCounts) / sizeof(threadCounts[0])); t++)
+            {
+                int threadCount = threadCounts[t];
+                unsigned long long start;
+                double rate;
+
+                for (int i = 0; i < threadCount; i++)
+                {
+                    contexts[i].Table = table;
+                    contexts[i].Keys = keys;
+                    contexts[i].KeyCount = count;
+                    contexts[i].OwnKeyCount = count / threadCount;
+                    contexts[i].FirstOwnKey = i * contexts[i].OwnKeyCount;
+                    contexts[i].ReadPercent = readPercents[m];
+                    contexts[i].Operations = operations / threadCount;
+                    contexts[i].Seed = 1000u + (unsigned int)i;
+                }
+
+                start = BenchNow();
+                for (int i = 0; i < threadCount; i++)
+                {
+                    if (0 != CcThreadCreate(&threads[i], BenchMixThread, &contexts[i]))
+                    {
+                        //wait for the ones already running before giving up
+                        for (int j = 0; j < i; j++)
+                        {
+                            CcThreadJoin(threads[j]);
+                        }
+                        retVal = -1;
+                        goto cleanup;
+                    }
+                }
+                for (int i = 0; i < threadCount; i++)
+                {
+                    CcThreadJoin(threads[i]);
+                }
+                rate = (double)operations * 1e9 / (double)(BenchNow() - start);
+                printf("  %dT %6.2f M/s", threadCount, rate / 1e6);
+            }
+            printf("\n");
+        }
+
+        if (count != ChtGetKeyCount(table))
+        {
+            printf("Invalid key count!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+        ChtDestroy(&table);
+    }
+    retVal = 0;
+
+cleanup:
+    printf("\n");
+    if (NULL != table)
+    {
+        ChtDestroy(&table);
+    }
+    BenchFreeKeys(keys, count);
+    return retVal;
+}
+
+typedef struct _BENCH_WRITER_CONTEXT {
+    CC_CONCURRENT_HASH_TABLE* Table;
+    char** Keys;
+    int KeyCount;
+    volatile long Stop;
+    long long Writes;
+} BENCH_WRITER_CONTEXT;
+
+// Keeps removing and re-inserting keys until Stop is set, the shards rehash and
+// retire memory all the time
+void BenchWriterThread(void* Context)
+{
+    BENCH_WRITER_CONTEXT* context = (BENCH_WRITER_CONTEXT*)Context;
+    int key = 0;
+
+    while (0 == CcAtomicLoad(&context->Stop))
+    {
+        ChtRemoveKey(context->Table, context->Keys[key]);
+        ChtSetKeyValue(context->Table, context->Keys[key], key);
+        key = (key + 1) % context->KeyCount;
+        context->Writes += 2;
+    }
+}
+
+int BenchLockFreeReads()
+{
+    const int count = 1 << 20;
+    const int operations = 1 << 22;
+    const int threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+    const int flags[] = { 0, CHT_FLAG_LOCK_FREE_READS };
+    const char* names[] = { "shard locks", "lock-free  " };
+    int retVal = -1;
+    char** keys = NULL;
+    CC_CONCURRENT_HASH_TABLE* table = NULL;
+    BENCH_MIX_CONTEXT contexts[BENCH_MAX_THREADS];
+    CC_THREAD threads[BENCH_MAX_THREADS];
+    BENCH_WRITER_CONTEXT writer;
+    CC_THREAD writerThread;
+
+    printf("CC_CONCURRENT_HASH_TABLE read throughput next to one writer, %d keys, %d reads, %d processors\n", count, operations, CcGetProcessorCount());
+
+    keys = BenchMakeKeys(count, 0);
+    if (keys == NULL)
+    {
+        goto cleanup;
+    }
+
+    for (int f = 0; f < (int)(sizeof(flags) / sizeof(flags[0])); f++)
+    {
+        CC_HASH_TABLE_OPTIONS options = { 0 };
+
+        options.Flags = flags[f];
+        retVal = ChtCreate(&table, 0, &options);
+        if (0 != retVal)
+        {
+            goto cleanup;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            ChtSetKeyValue(table, keys[i], i);
+        }
+
+        printf("%s:", names[f]);
+        for (int t = 0; t < (int)(sizeof(threadCounts) / sizeof(threadCounts[0])); t++)
+        {
+            int threadCount = threadCounts[t];
+            int started = 0;
+            unsigned long long start;
+            double rate;
+
+            writer.Table = table;
+            writer.Keys = keys;
+            writer.KeyCount = count;
+            writer.Stop = 0;
+            writer.Writes = 0;
+            if (0 != CcThreadCreate(&writerThread, BenchWriterThread, &writer))
+            {
+                retVal = -1;
+                goto cleanup;
+            }
+
+            for (int i = 0; i < threadCount; i++)
+            {
+                contexts[i].Table = table;
+                contexts[i].Keys = keys;
+                contexts[i].KeyCount = count;
+                contexts[i].FirstOwnKey = 0;
+                contexts[i].OwnKeyCount = 1;
+                contexts[i].ReadPercent = 100;
+                contexts[i].Operations = operations / threadCount;
+                contexts[i].Seed = 1000u + (unsigned int)i;
+            }
+
+            start = BenchNow();
+            for (started = 0; started < threadCount; started++)
+            {
+                if (0 != CcThreadCreate(&threads[started], BenchMixThread, &contexts[started]))
+                {
+                    retVal = -1;
+                    break;
+                }
+            }
+            for (int i = 0; i < started; i++)
+            {
+                CcThreadJoin(threads[i]);
+            }
+            rate = (double)operations * 1e9 / (double)(BenchNow() - start);
+
+            CcAtomicIncrement(&writer.Stop);
+            CcThreadJoin(writerThread);
+            if (started != threadCount)
+            {
+                goto cleanup;
+            }
+            printf("  %dT %6.2f M/s", threadCount, rate / 1e6);
+        }
+        printf("\n");
+
+        ChtDestroy(&table);
+    }
+    retVal = 0;
+
+cleanup:
+    printf("\n");
+    if (NULL != table)
+    {
+        ChtDestroy(&table);
+    }
+    BenchFreeKeys(keys, count);
+    return retVal;
+}
+
+// Reads one key per line from Path, same layout as BenchMakeKeys
+char** BenchLoadKeys(const char* Path, int* Count)
+{
+    FILE* file = NULL;
+    char* buffer = NULL;
+    char** keys = NULL;
+    long size;
+    int count = 0;
+
+#ifdef _MSC_VER
+    if (0 != fopen_s(&file, Path, "rb"))
+    {
+        file = NULL;
+    }
+#else
+    file = fopen(Path, "rb");
+#endif
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    buffer = (char*)malloc((size_t)size + 1);
+    if (buffer == NULL || fread(buffer, 1, (size_t)size, file) != (size_t)size)
+    {
+        goto error;
+    }
+    buffer[size] = '\0';
+
+    for (long i = 0; i < size; i++)
+    {
+        count += buffer[i] == '\n';
+    }
+
+    keys = (char**)malloc(sizeof(char*) * ((size_t)count + 2));
+    if (keys == NULL)
+    {
+        goto error;
+    }
+
+    count = 0;
+    for (char* line = buffer; *line != '\0';)
+    {
+        char* end = line;
+        while (*end != '\0' && *end != '\n' && *end != '\r')
+        {
+            end++;
+        }
+        char* next = end;
+        while (*next == '\n' || *next == '\r')
+        {
+            *next++ = '\0';
+        }
+        if (end != line)
+        {
+            keys[count++] = line;
+        }
+        line = next;
+    }
+    keys[count] = buffer;
+
+    fclose(file);
+    *Count = count;
+    return keys;
+
+error:
+    fclose(file);
+    free(buffer);
+    free(keys);
+    return NULL;
+}
+
+#define BENCH_HISTOGRAM_SIZE 8
+
+// Hashes every key of the corpus with Function and prints its speed and how well the
+// hashes spread over a table sized like CC_HASH_TABLE would size it for the corpus
+int BenchHashFunction(const char* Name, CC_HASH_FUNCTION Function, char** Keys, int Count)
+{
+    const int passes = 10;
+    unsigned long long* hashes = NULL;
+    unsigned int* lengths = NULL;
+    int* homeCount = NULL;
+    unsigned char* used = NULL;
+    unsigned long long bytes = 0, start, elapsed, sink = 0;
+    int histogram[BENCH_HISTOGRAM_SIZE] = { 0 };
+    int capacity = HT_INITIAL_CAPACITY;
+    int longestProbe = 0;
+    int retVal = -1;
+
+    while (capacity / 8 * 7 < Count)
+    {
+        capacity *= 2;
+    }
+
+    hashes = (unsigned long long*)malloc(sizeof(unsigned long long) * (size_t)Count);
+    lengths = (unsigned int*)malloc(sizeof(unsigned int) * (size_t)Count);
+    homeCount = (int*)calloc((size_t)capacity, sizeof(int));
+    used = (unsigned char*)calloc((size_t)capacity, 1);
+    if (hashes == NULL || lengths == NULL || homeCount == NULL || used == NULL)
+    {
+        goto cleanup;
+    }
+
+    for (int i = 0; i < Count; i++)
+    {
+        lengths[i] = (unsigned int)strlen(Keys[i]);
+    }
+
+    start = BenchNow();
+    for (int pass = 0; pass < passes; pass++)
+    {
+        for (int i = 0; i < Count; i++)
+        {
+            hashes[i] = Function(Keys[i], lengths[i], (unsigned long long)pass);
+            sink ^= hashes[i];
+            bytes += lengths[i];
+        }
+    }
+    elapsed = BenchNow() - start;
+
+    //last pass used seed passes - 1, good enough for the distribution
+    for (int i = 0; i < Count; i++)
+    {
+        unsigned int index = (unsigned int)hashes[i] & (unsigned int)(capacity - 1);
+        int probe = 0;
+
+        homeCount[index]++;
+        while (used[index])
+        {
+            index = (index + 1) & (unsigned int)(capacity - 1);
+            probe++;
+        }
+        used[index] = 1;
+        if (probe > longestProbe)
+        {
+            longestProbe = probe;
+        }
+    }
+    for (int i = 0; i < capacity; i++)
+    {
+        histogram[homeCount[i] < BENCH_HISTOGRAM_SIZE - 1 ? homeCount[i] : BENCH_HISTOGRAM_SIZE - 1]++;
+    }
+
+    printf("%-8s %8.2f MB/s  longest probe %5d  keys per home slot:", Name,
+        (double)bytes * 1e3 / (double)elapsed, longestProbe);
+    for (int i = 0; i < BENCH_HISTOGRAM_SIZE; i++)
+    {
+        printf(" %d%s:%d", i, i == BENCH_HISTOGRAM_SIZE - 1 ? "+" : "", histogram[i]);
+    }
+    printf("%s\n", sink == 0 ? " " : "");
+    retVal = 0;
+
+cleanup:
+    free(hashes);
+    free(lengths);
+    free(homeCount);
+    free(used);
+    return retVal;
+}
+
+// Fills a real table with the corpus and prints what HtGetStats sees of it
+int BenchHashTableStats(const char* Name, CC_HASH_FUNCTION Function, char** Keys, int Count)
+{
+    CC_HASH_TABLE_OPTIONS options = { 0 };
+    CC_HASH_TABLE_STATS stats;
+    CC_HASH_TABLE* table = NULL;
+    unsigned long long start;
+    double statsTime;
+
+    options.HashRoutine = Function;
+    if (0 != HtCreateEx(&table, &options))
+    {
+        return -1;
+    }
+    for (int i = 0; i < Count; i++)
+    {
+        HtSetKeyValue(table, Keys[i], i);
+    }
+
+    start = BenchNow();
+    HtGetStats(table, &stats);
+    statsTime = (double)(BenchNow() - start);
+
+    printf("%-8s table load %.2f  %6.2f MB  %d resizes  max probe %d groups  keys per distance:", Name,
+        stats.LoadFactor, (double)(stats.SlotBytes + stats.NodeBytes + stats.KeyBytes) / 1e6, stats.ResizeCount, stats.MaxProbeDistance);
+    for (int i = 0; i < HT_STATS_PROBE_BUCKETS; i++)
+    {
+        printf(" %d%s:%d", i, i == HT_STATS_PROBE_BUCKETS - 1 ? "+" : "", stats.ProbeHistogram[i]);
+    }
+    printf("  (HtGetStats %.2f ms)\n", statsTime / 1e6);
+
+    HtDestroy(&table);
+    return 0;
+}
+
+int BenchHashFunctions(const char* CorpusPath)
+{
+    const char* names[] = { "wyhash", "xxhash64", "siphash", "djb2" };
+    CC_HASH_FUNCTION functions[] = { HfWyHash, HfXxHash64, HfSipHash, HfDjb2 };
+    char** keys = NULL;
+    int count = 1 << 20;
+    int retVal = -1;
+
+    if (CorpusPath != NULL)
+    {
+        keys = BenchLoadKeys(CorpusPath, &count);
+        printf("Hash functions, %d keys from %s\n", count, CorpusPath);
+    }
+    else
+    {
+        keys = BenchMakeKeys(count, 0);
+        printf("Hash functions, %d generated path keys\n", count);
+    }
+    if (keys == NULL || count == 0)
+    {
+        goto cleanup;
+    }
+
+    for (int i = 0; i < (int)(sizeof(functions) / sizeof(functions[0])); i++)
+    {
+        retVal = BenchHashFunction(names[i], functions[i], keys, count);
+        if (0 != retVal)
+        {
+            goto cleanup;
+        }
+    }
+    for (int i = 0; i < (int)(sizeof(functions) / sizeof(functions[0])); i++)
+    {
+        retVal = BenchHashTableStats(names[i], functions[i], keys, count);
+        if (0 != retVal)
+        {
+            goto cleanup;
+        }
+    }
+
+cleanup:
+    printf("\n");
+    BenchFreeKeys(keys, count);
+    return retVal;
+}
+
+// VecInsertTail as it was before geometric growth, 2048 more elements on every reallocation
+int BenchFixedGrowthInsertTail(CC_VECTOR* Vector, int Value)
+{
+    if (Vector->Count >= Vector->Size && 0 != VecReserve(Vector, Vector->Size + 2048))
+    {
+        return -1;
+    }
+    Vector->Array[Vector->Count] = Value;
+    Vector->Count += 1;
+    return 0;
+}
+
+// Returns the elements appended per second to a new vector of Count elements,
+// Mode 0 grows it with VecInsertTail, 1 reserves first, 2 grows like the old code did
+double BenchAppendRate(int Mode, int Count)
+{
+    //small sizes are repeated, every measure covers at least 16M elements
+    int rounds = Count < (1 << 24) ? (1 << 24) / Count : 1;
+    unsigned long long start;
+    unsigned long long elapsed = 0;
+    CC_VECTOR* vector = NULL;
+
+    for (int round = 0; round < rounds; round++)
+    {
+        if (0 != VecCreate(&vector))
+        {
+            return 0;
+        }
+        start = BenchNow();
+        if (Mode == 1)
+        {
+            VecReserve(vector, Count);
+        }
+        for (int i = 0; i < Count; i++)
+        {
+            if (0 != (Mode == 2 ? BenchFixedGrowthInsertTail(vector, i) : VecInsertTail(vector, i)))
+            {
+                VecDestroy(&vector);
+                return 0;
+            }
+        }
+        elapsed += BenchNow() - start;
+        VecDestroy(&vector);
+    }
+    return (double)Count * rounds * 1e9 / (double)elapsed;
+}
+
+int BenchVectorAppend()
+{
+    printf("VecInsertTail throughput, M elements/s\n");
+    printf("%10s %12s %12s %12s %18s\n", "elements", "geometric", "reserved", "fixed 2048", "reallocs geo/fixed");
+    for (int count = 1000; count <= 100000000; count *= 10)
+    {
+        double geometric = BenchAppendRate(0, count);
+        double reserved = BenchAppendRate(1, count);
+        double fixed = BenchAppendRate(2, count);
+        int geometricReallocs = 0;
+
+        if (geometric == 0 || reserved == 0 || fixed == 0)
+        {
+            printf("Out of memory at %d elements\n\n", count);
+            return -1;
+        }
+        //every reallocation copies the whole array
+        for (long long size = VEC_MIN_CAPACITY, last = 0; last < count; last = size, size *= 2)
+        {
+            geometricReallocs++;
+        }
+        printf("%10d %12.1f %12.1f %12.1f %8d/%d\n", count, geometric / 1e6, reserved / 1e6, fixed / 1e6,
+            geometricReallocs, (count + 2047) / 2048);
+    }
+    printf("\n");
+    return 0;
+}
+
+int BenchCompareInts(const void* First, const void* Second)
+{
+    int first = *(const int*)First;
+    int second = *(const int*)Second;
+
+    return (first > second) - (first < second);
+}
+
+// Fills Array with Count values, Pattern 0 random, 1 sorted, 2 reversed, 3 few unique
+void BenchFillSortInput(int* Array, int Count, int Pattern, unsigned int Seed)
+{
+    for (int i = 0; i < Count; i++)
+    {
+        Seed = Seed * 1103515245u + 12345u;
+        switch (Pattern)
+        {
+        case 0:
+            Array[i] = (int)(Seed ^ (Seed >> 15));
+            break;
+        case 1:
+            Array[i] = i;
+            break;
+        case 2:
+            Array[i] = Count - i;
+            break;
+        default:
+            Array[i] = (int)((Seed >> 16) % 16);
+            break;
+        }
+    }
+}
+
+// Returns the elements sorted per second in ascending order, Engine 0 is qsort,
+// 1 SrtIntroSort, 2 SrtRadixSort and 3 VecSortEx, which picks one of the two
+double BenchSortRate(int Engine, int Pattern, int Count)
+{
+    //small sizes are repeated, every measure covers at least 4M elements
+    int rounds = Count < (1 << 22) ? (1 << 22) / Count : 1;
+    unsigned long long start;
+    unsigned long long elapsed = 0;
+    CC_VECTOR* vector = NULL;
+    int* buffer = (int*)malloc(sizeof(int) * (size_t)Count);
+
+    if (buffer == NULL || 0 != VecCreateWithCapacity(&vector, Count))
+    {
+        free(buffer);
+        return 0;
+    }
+
+    for (int round = 0; round < rounds; round++)
+    {
+        BenchFillSortInput(vector->Array, Count, Pattern, (unsigned int)round);
+        vector->Count = Count;
+
+        start = BenchNow();
+        switch (Engine)
+        {
+        case 0:
+            qsort(vector->Array, (size_t)Count, sizeof(int), BenchCompareInts);
+            break;
+        case 1:
+            SrtIntroSort(vector->Array, Count, 0);
+            break;
+        case 2:
+            SrtRadixSort(vector->Array, Count, 0, buffer);
+            break;
+        default:
+            VecSortEx(vector, VEC_SORT_ASCENDING);
+            break;
+        }
+        elapsed += BenchNow() - start;
+    }
+
+    VecDestroy(&vector);
+    free(buffer);
+    return (double)Count * rounds * 1e9 / (double)elapsed;
+}
+
+int BenchVectorSort()
+{
+    const char* patterns[] = { "random", "sorted", "reversed", "few unique" };
+    int counts[] = { 16, 100, 512, 1024, 2048, 4096, 10000, 1000000, 10000000 };
+
+    printf("VecSortEx throughput, M elements/s, radix sort from %d elements\n", SRT_RADIX_LIMIT);
+    printf("%-10s %10s %10s %10s %10s %10s\n", "input", "elements", "qsort", "introsort", "radix", "VecSortEx");
+    for (int pattern = 0; pattern < 4; pattern++)
+    {
+        for (int i = 0; i < (int)(sizeof(counts) / sizeof(counts[0])); i++)
+        {
+            double rates[4];
+
+            for (int engine = 0; engine < 4; engine++)
+            {
+                rates[engine] = BenchSortRate(engine, pattern, counts[i]);
+                if (rates[engine] == 0)
+                {
+                    printf("Out of memory at %d elements\n\n", counts[i]);
+                    return -1;
+                }
+            }
+            printf("%-10s %10d %10.1f %10.1f %10.1f %10.1f\n", patterns[pattern], counts[i],
+                rates[0] / 1e6, rates[1] / 1e6, rates[2] / 1e6, rates[3] / 1e6);
+        }
+    }
+    printf("\n");
+    return 0;
+}
+
+// Milliseconds VecSortParallel takes on Input, ThreadCount 0 times VecSort instead
+double BenchParallelSortTime(CC_VECTOR* Vector, int* Input, int Count, int ThreadCount)
+{
+    unsigned long long start;
+
+    memcpy(Vector->Array, Input, sizeof(int) * (size_t)Count);
+    Vector->Count = Count;
+
+    start = BenchNow();
+    if (0 != (ThreadCount == 0 ? VecSort(Vector) : VecSortParallel(Vector, ThreadCount)))
+    {
+        return 0;
+    }
+    return (double)(BenchNow() - start) / 1e6;
+}
+
+int BenchVectorSortParallel()
+{
+    const char* patterns[] = { "random", "few unique" };
+    const int count = 1 << 25;
+    int retVal = -1;
+    int* input = (int*)malloc(sizeof(int) * (size_t)count);
+    CC_VECTOR* vector = NULL;
+
+    if (input == NULL || 0 != VecCreateWithCapacity(&vector, count))
+    {
+        goto cleanup;
+    }
+
+    printf("VecSortParallel speedup over VecSort, %d elements, %d processors\n", count, CcGetProcessorCount());
+    printf("%-10s %8s %12s %8s\n", "input", "threads", "ms", "speedup");
+    for (int pattern = 0; pattern < 2; pattern++)
+    {
+        double sequential;
+
+        //sorted input would be caught by the first scan, only these two are worth splitting
+        BenchFillSortInput(input, count, pattern == 0 ? 0 : 3, 7);
+        sequential = BenchParallelSortTime(vector, input, count, 0);
+        if (sequential == 0)
+        {
+            goto cleanup;
+        }
+        printf("%-10s %8s %12.1f %8.2f\n", patterns[pattern], "VecSort", sequential, 1.0);
+
+        for (int threads = 1; threads <= 32; threads *= 2)
+        {
+            double elapsed = BenchParallelSortTime(vector, input, count, threads);
+
+            if (elapsed == 0)
+            {
+                goto cleanup;
+            }
+            printf("%-10s %8d %12.1f %8.2f\n", patterns[pattern], threads, elapsed, sequential / elapsed);
+        }
+    }
+    retVal = 0;
+
+cleanup:
+    printf("\n");
+    VecDestroy(&vector);
+    free(input);
+    return retVal;
+}
+
+volatile long long gBenchSink;
+
+// Returns the GB/s Kernel reads from a vector of Count elements, Kernel 0 is the sum
+// through VecGetValueByIndex the kernels replace, then VecSum, VecMinMax, VecFind of a
+// missing value, VecCountEqual and VecFillRange
+double BenchKernelRate(CC_VECTOR* Vector, int Kernel, int Count)
+{
+    //small sizes are repeated, every measure covers at least 256M elements
+    int rounds = Count < (1 << 28) ? (1 << 28) / Count : 1;
+    unsigned long long start = BenchNow();
+    long long result = 0;
+
+    for (int round = 0; round < rounds; round++)
+    {
+        long long sum = 0;
+        int min = 0;
+        int max = 0;
+
+        switch (Kernel)
+        {
+        case 0:
+            for (int i = 0; i < Count; i++)
+            {
+                int value = 0;
+
+                VecGetValueByIndex(Vector, i, &value);
+                sum += value;
+            }
+            result += sum;
+            break;
+        case 1:
+            VecSum(Vector, &sum);
+            result += sum;
+            break;
+        case 2:
+            VecMinMax(Vector, &min, &max);
+            result += min + max;
+            break;
+        case 3:
+            result += VecFind(Vector, -1);
+            break;
+        case 4:
+            result += VecCountEqual(Vector, 5);
+            break;
+        default:
+            VecFillRange(Vector, 0, Count, round);
+            break;
+        }
+    }
+    gBenchSink = result;
+    return (double)Count * sizeof(int) * rounds / (double)(BenchNow() - start);
+}
+
+int BenchVectorKernels()
+{
+    const char* levels[] = { "scalar", "SSE2", "SSE4.1", "AVX2" };
+    const char* kernels[] = { "get loop", "VecSum", "VecMinMax", "VecFind", "VecCountEqual", "VecFillRange" };
+    int counts[] = { 4096, 1 << 18, 1 << 26 };
+    CC_VECTOR* vector = NULL;
+    int level = CcGetSimdLevel();
+
+    if (0 != VecCreateWithCapacity(&vector, counts[2]))
+    {
+        return -1;
+    }
+    for (int i = 0; i < counts[2]; i++)
+    {
+        VecInsertTail(vector, i % 1000);
+    }
+
+    printf("Vector kernels, GB/s read or written, %s CPU\n", levels[level]);
+    printf("%-14s %8s %10s %10s %10s\n", "kernel", "level", "16 KB", "1 MB", "256 MB");
+    for (int kernel = 0; kernel < 6; kernel++)
+    {
+        for (int simd = CC_SIMD_NONE; simd <= level; simd++)
+        {
+            //SSE2 alone runs the scalar loops, the get loop does not change with the level
+            if (simd == CC_SIMD_SSE2 || (kernel == 0 && simd != CC_SIMD_NONE))
+            {
+                continue;
+            }
+            CcSetSimdLevel(simd);
+            printf("%-14s %8s", kernels[kernel], levels[simd]);
+            for (int i = 0; i < 3; i++)
+            {
+                vector->Count = counts[i];
+                printf(" %10.2f", BenchKernelRate(vector, kernel, counts[i]));
+            }
+            printf("\n");
+        }
+    }
+    CcSetSimdLevel(CC_SIMD_AVX2);
+
+    printf("\n");
+    VecDestroy(&vector);
+    return 0;
+}
+
+typedef struct _BENCH_RECORD {
+    long long Key;
+    int Id;
+    int Flags;
+} BENCH_RECORD;
+
+#define BENCH_RECORD_LESS(A, B) ((A).Key < (B).Key)
+
+CC_VECTOR_DEFINE(BENCH_VECTOR_I64, long long, SRT_LESS)
+CC_VECTOR_DEFINE(BENCH_VECTOR_RECORD, BENCH_RECORD, BENCH_RECORD_LESS)
+
+int BenchCompareI64(const void* First, const void* Second)
+{
+    long long first = *(const long long*)First;
+    long long second = *(const long long*)Second;
+
+    return (first > second) - (first < second);
+}
+
+int BenchCompareRecords(const void* First, const void* Second)
+{
+    long long first = ((const BENCH_RECORD*)First)->Key;
+    long long second = ((const BENCH_RECORD*)Second)->Key;
+
+    return (first > second) - (first < second);
+}
+
+// Returns the random elements sorted per second in ascending order, Records 0 for
+// long longs and 1 for 16 byte records. Engine 0 is qsort, 1 SortEx and 2
+// SortParallelEx with one thread per processor.
+double BenchTypedSortRate(int Records, int Engine, int Count)
+{
+    int rounds = Count < (1 << 22) ? (1 << 22) / Count : 1;
+    unsigned long long start;
+    unsigned long long elapsed = 0;
+    int* input = (int*)malloc(sizeof(int) * (size_t)Count * 2);
+    BENCH_VECTOR_I64* numbers = NULL;
+    BENCH_VECTOR_RECORD* records = NULL;
+    int failed = 0;
+
+    if (input == NULL || 0 != BENCH_VECTOR_I64CreateWithCapacity(&numbers, Count)
+        || 0 != BENCH_VECTOR_RECORDCreateWithCapacity(&records, Count))
+    {
+        failed = 1;
+        goto cleanup;
+    }
+
+    for (int round = 0; round < rounds && !failed; round++)
+    {
+        BenchFillSortInput(input, Count * 2, 0, (unsigned int)round);
+        for (int i = 0; i < Count; i++)
+        {
+            long long key = (long long)input[2 * i] * 4294967296LL + (unsigned int)input[2 * i + 1];
+            BENCH_RECORD record = { key, i, 0 };
+
+            numbers->Array[i] = key;
+            records->Array[i] = record;
+        }
+        numbers->Count = Count;
+        records->Count = Count;
+
+        start = BenchNow();
+        if (Engine == 0)
+        {
+            if (Records)
+            {
+                qsort(records->Array, (size_t)Count, sizeof(BENCH_RECORD), BenchCompareRecords);
+            }
+            else
+            {
+                qsort(numbers->Array, (size_t)Count, sizeof(long long), BenchCompareI64);
+            }
+        }
+        else if (Engine == 1)
+        {
+            failed = Records ? BENCH_VECTOR_RECORDSortEx(records, VEC_SORT_ASCENDING) : BENCH_VECTOR_I64SortEx(numbers, VEC_SORT_ASCENDING);
+        }
+        else
+        {
+            failed = Records ? BENCH_VECTOR_RECORDSortParallelEx(records, CcGetProcessorCount(), VEC_SORT_ASCENDING)
+                : BENCH_VECTOR_I64SortParallelEx(numbers, CcGetProcessorCount(), VEC_SORT_ASCENDING);
+        }
+        elapsed += BenchNow() - start;
+    }
+
+cleanup:
+    BENCH_VECTOR_I64Destroy(&numbers);
+    BENCH_VECTOR_RECORDDestroy(&records);
+    free(input);
+    return failed ? 0 : (double)Count * rounds * 1e9 / (double)elapsed;
+}
+
+int BenchTypedVectorSort()
+{
+    const char* types[] = { "long long", "record" };
+    int counts[] = { 1000, 100000, 1000000, 10000000 };
+
+    printf("CC_VECTOR_DEFINE sort throughput, M random elements/s, %d processors\n", CcGetProcessorCount());
+    printf("%-10s %10s %10s %10s %14s\n", "type", "elements", "qsort", "SortEx", "SortParallelEx");
+    for (int records = 0; records < 2; records++)
+    {
+        for (int i = 0; i < (int)(sizeof(counts) / sizeof(counts[0])); i++)
+        {
+            double rates[3];
+
+            for (int engine = 0; engine < 3; engine++)
+            {
+                rates[engine] = BenchTypedSortRate(records, engine, counts[i]);
+                if (rates[engine] == 0)
+                {
+                    printf("Out of memory at %d elements\n\n", counts[i]);
+                    return -1;
+                }
+            }
+            printf("%-10s %10d %10.1f %10.1f %14.1f\n", types[records], counts[i], rates[0] / 1e6, rates[1] / 1e6, rates[2] / 1e6);
+        }
+    }
+    printf("\n");
+    return 0;
+}
+
+// Resident memory of the process in bytes, 0 if it cannot be read
+size_t BenchResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return 0;
+    }
+    return counters.WorkingSetSize;
+#else
+    unsigned long long size = 0;
+    unsigned long long resident = 0;
+    FILE* file = fopen("/proc/self/statm", "r");
+
+    if (file == NULL)
+    {
+        return 0;
+    }
+    if (fscanf(file, "%llu %llu", &size, &resident) != 2)
+    {
+        resident = 0;
+    }
+    fclose(file);
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+#define BENCH_SMALL_INLINE  16
+
+typedef CC_SMALL_VECTOR(BENCH_SMALL_INLINE) BENCH_SMALL_VECTOR;
+
+// Creates Count vectors of 1 to BENCH_SMALL_INLINE elements, Kind 0 with VecCreate,
+// 1 with VecCreateSmall and 2 in the CC_SMALL_VECTOR members of Small
+// Returns the number of vectors created, less than Count when out of memory
+int BenchCreateSmallVectors(int Kind, CC_VECTOR** Vectors, BENCH_SMALL_VECTOR* Small, int Count)
+{
+    for (int i = 0; i < Count; i++)
+    {
+        int created = Kind == 0 ? VecCreate(&Vectors[i]) : Kind == 1 ? VecCreateSmall(&Vectors[i], BENCH_SMALL_INLINE)
+            : VEC_INIT_SMALL(Small[i]);
+
+        if (created != 0)
+        {
+            return i;
+        }
+        if (Kind == 2)
+        {
+            Vectors[i] = &Small[i].Vector;
+        }
+        for (int j = 0; j <= i % BENCH_SMALL_INLINE; j++)
+        {
+            if (0 != VecInsertTail(Vectors[i], j))
+            {
+                return i + 1;
+            }
+        }
+    }
+    return Count;
+}
+
+void BenchDestroySmallVectors(int Kind, CC_VECTOR** Vectors, int Count)
+{
+    for (int i = 0; i < Count; i++)
+    {
+        if (Kind == 2)
+        {
+            VecUninit(Vectors[i]);
+        }
+        else
+        {
+            VecDestroy(&Vectors[i]);
+        }
+    }
+}
+
+int BenchSmallVectors()
+{
+    const char* kinds[] = { "VecCreate", "VecCreateSmall", "CC_SMALL_VECTOR" };
+    const int count = 1000000;
+    const int batch = 1024;
+    const int rounds = 4096;
+    CC_VECTOR** vectors[3] = { NULL, NULL, NULL };
+    int created[3] = { 0, 0, 0 };
+    BENCH_SMALL_VECTOR* smallVectors = (BENCH_SMALL_VECTOR*)malloc(sizeof(BENCH_SMALL_VECTOR) * (size_t)batch);
+    BENCH_SMALL_VECTOR* kept = NULL;
+    int retVal = -1;
+
+    for (int kind = 0; kind < 3; kind++)
+    {
+        vectors[kind] = (CC_VECTOR**)malloc(sizeof(CC_VECTOR*) * (size_t)count);
+    }
+    if (smallVectors == NULL || vectors[0] == NULL || vectors[1] == NULL || vectors[2] == NULL)
+    {
+        printf("Out of memory\n\n");
+        goto cleanup;
+    }
+
+    printf("Vectors of 1 to %d elements, %d inline, created, filled and destroyed %d at a time,\n", BENCH_SMALL_INLINE, BENCH_SMALL_INLINE, batch);
+    printf("then resident memory with %d of them\n", count);
+    printf("%-16s %12s %14s\n", "kind", "M vectors/s", "bytes/vector");
+    for (int kind = 0; kind < 3; kind++)
+    {
+        unsigned long long start;
+        unsigned long long elapsed = 0;
+        size_t resident;
+
+        for (int round = 0; round < rounds; round++)
+        {
+            int done;
+
+            start = BenchNow();
+            done = BenchCreateSmallVectors(kind, vectors[kind], smallVectors, batch);
+            BenchDestroySmallVectors(kind, vectors[kind], done);
+            elapsed += BenchNow() - start;
+            if (done != batch)
+            {
+                printf("Out of memory\n\n");
+                goto cleanup;
+            }
+        }
+
+        //the vectors of every kind are kept until the end, the next kind cannot reuse their memory
+        resident = BenchResidentBytes();
+        if (kind == 2)
+        {
+            kept = (BENCH_SMALL_VECTOR*)malloc(sizeof(BENCH_SMALL_VECTOR) * (size_t)count);
+            if (kept == NULL)
+            {
+                printf("Out of memory\n\n");
+                goto cleanup;
+            }
+        }
+        created[kind] = BenchCreateSmallVectors(kind, vectors[kind], kept, count);
+        if (created[kind] != count)
+        {
+            printf("Out of memory\n\n");
+            goto cleanup;
+        }
+        resident = BenchResidentBytes() - resident;
+
+        printf("%-16s %12.1f %14.1f\n", kinds[kind], (double)batch * rounds * 1e3 / (double)elapsed, (double)resident / count);
+    }
+    printf("\n");
+    retVal = 0;
+
+cleanup:
+    for (int kind = 0; kind < 3; kind++)
+    {
+        BenchDestroySmallVectors(kind, vectors[kind], created[kind]);
+        free(vectors[kind]);
+    }
+    free(kept);
+    free(smallVectors);
+    return retVal;
+}
+
+#define BENCH_MAPPED_PATH   "bench_mapped_vector.bin"
+
+// Fills Vector with Count random ints, inserted 1M at a time
+// Returns the bytes inserted per second, 0 if out of memory or disk
+double BenchFillVector(CC_VECTOR* Vector, int* Chunk, int Count)
+{
+    const int chunk = 1 << 20;
+    unsigned long long elapsed = 0;
+
+    for (int i = 0; i < Count; i += chunk)
+    {
+        unsigned long long start;
+        int count = Count - i < chunk ? Count - i : chunk;
+
+        BenchFillSortInput(Chunk, count, 0, (unsigned int)i);
+        start = BenchNow();
+        if (0 != VecInsertRange(Vector, Vector->Count, Chunk, count))
+        {
+            return 0;
+        }
+        elapsed += BenchNow() - start;
+    }
+    return (double)Count * sizeof(int) * 1e9 / (double)elapsed;
+}
+
+// Milliseconds VecSortEx takes, with SortMemory bytes for a mapped vector
+double BenchMappedSortTime(CC_VECTOR* Vector, size_t SortMemory)
+{
+    unsigned long long start;
+    int failed;
+
+    VecSetSortMemory(SortMemory);
+    start = BenchNow();
+    failed = VecSortEx(Vector, VEC_SORT_ASCENDING);
+    VecSetSortMemory(0);
+    return failed ? 0 : (double)(BenchNow() - start) / 1e6;
+}
+
+int BenchMappedVector()
+{
+    const int count = 1 << 26;
+    CC_VECTOR* memory = NULL;
+    CC_VECTOR* mapped = NULL;
+    int* chunk = (int*)malloc(sizeof(int) << 20);
+    unsigned long long start;
+    double memoryRate;
+    double mappedRate;
+    double syncTime;
+    double openTime;
+    double scanRate;
+    double sortTimes[2];
+    long long sum = 0;
+    int retVal = -1;
+
+    remove(BENCH_MAPPED_PATH);
+    if (chunk == NULL || 0 != VecCreate(&memory) || 0 != VecCreateMapped(&mapped, BENCH_MAPPED_PATH))
+    {
+        printf("Cannot create the vectors\n\n");
+        goto cleanup;
+    }
+
+    memoryRate = BenchFillVector(memory, chunk, count);
+    VecDestroy(&memory);
+    mappedRate = BenchFillVector(mapped, chunk, count);
+    start = BenchNow();
+    if (memoryRate == 0 || mappedRate == 0 || 0 != VecSync(mapped))
+    {
+        printf("Out of memory or disk\n\n");
+        goto cleanup;
+    }
+    syncTime = (double)(BenchNow() - start) / 1e6;
+    VecDestroy(&mapped);
+
+    //no load step, the pages come in when the scan touches them
+    start = BenchNow();
+    if (0 != VecCreateMapped(&mapped, BENCH_MAPPED_PATH) || count != VecGetCount(mapped))
+    {
+        printf("Cannot open the mapped vector again\n\n");
+        goto cleanup;
+    }
+    openTime = (double)(BenchNow() - start) / 1e3;
+    VecAdvise(mapped, VEC_ACCESS_SEQUENTIAL);
+    start = BenchNow();
+    VecSum(mapped, &sum);
+    scanRate = (double)count * sizeof(int) * 1e9 / (double)(BenchNow() - start);
+
+    //the external sort gets a sort memory of 1/8 of the data, 32 runs
+    sortTimes[0] = BenchMappedSortTime(mapped, 0);
+    for (int i = 0; i < count; i += 1 << 20)
+    {
+        BenchFillSortInput(mapped->Array + i, count - i < (1 << 20) ? count - i : 1 << 20, 0, (unsigned int)i);
+    }
+    sortTimes[1] = BenchMappedSortTime(mapped, (size_t)count * sizeof(int) / 8);
+    if (sortTimes[0] == 0 || sortTimes[1] == 0)
+    {
+        printf("Out of memory or disk\n\n");
+        goto cleanup;
+    }
+
+    printf("Vector of %d ints (%d MB) in memory and mapped from a file\n", count, (int)((size_t)count * sizeof(int) >> 20));
+    printf("append in memory %8.2f GB/s\n", memoryRate / 1e9);
+    printf("append mapped    %8.2f GB/s, VecSync %.1f ms\n", mappedRate / 1e9, syncTime);
+    printf("open again       %8.1f us, first scan %.2f GB/s (sum %lld)\n", openTime, scanRate / 1e9, sum);
+    printf("sort in memory   %8.1f ms\n", sortTimes[0]);
+    printf("external sort    %8.1f ms with %d MB of sort memory\n", sortTimes[1], (int)((size_t)count * sizeof(int) / 8 >> 20));
+    printf("\n");
+    retVal = 0;
+
+cleanup:
+    VecDestroy(&memory);
+    VecDestroy(&mapped);
+    remove(BENCH_MAPPED_PATH);
+    free(chunk);
+    return retVal;
+}
@@ -0,0 +1,86 @@
+#include "ccarena.h"
+#include <stdlib.h>
+#include <string.h>
+
+void ArInit(CC_ARENA* Arena)
+{
+    memset(Arena, 0, sizeof(*Arena));
+}
+
+int ArAlloc(CC_ARENA* Arena, size_t Size, char** Memory)
+{
+    if (Arena == NULL || Memory == NULL)
+    {
+        return -1;
+    }
+
+    if (Size > Arena->Left)
+    {
+        CC_ARENA_CHUNK* chunk;
+        //chunks double with the arena so a big table needs few of them
+        size_t chunkSize = Arena->Reserved < AR_MIN_CHUNK_SIZE ? AR_MIN_CHUNK_SIZE : Arena->Reserved;
+
+        if (chunkSize > AR_MAX_CHUNK_SIZE)
+        {
+            chunkSize = AR_MAX_CHUNK_SIZE;
+        }
+        if (chunkSize < Size)
+        {
+            chunkSize = Size;
+        }
+
+        chunk = (CC_ARENA_CHUNK*)malloc(sizeof(CC_ARENA_CHUNK) + chunkSize);
+        if (chunk == NULL)
+        {
+            return -1;
+        }
+        chunk->Next = Arena->Chunks;
+        chunk->Size = chunkSize;
+        Arena->Chunks = chunk;
+        Arena->Next = (char*)(chunk + 1);
+        Arena->Left = chunkSize;
+        Arena->Reserved += sizeof(CC_ARENA_CHUNK) + chunkSize;
+    }
+
+    *Memory = Arena->Next;
+    Arena->Next += Size;
+    Arena->Left -= Size;
+    Arena->Used += Size;
+    return 0;
+}
+
+int ArCopyString(CC_ARENA* Arena, const char* String, size_t Length, char** Copy)
+{
+    if (String == NULL || ArAlloc(Arena, Length + 1, Copy) != 0)
+    {
+        return -1;
+    }
+    memcpy(*Copy, String, Length);
+    (*Copy)[Length] = '\0';
+    return 0;
+}
+
+void ArRelease(CC_ARENA* Arena)
+{
+    ArFreeChunks(ArDetach(Arena));
+}
+
+CC_ARENA_CHUNK* ArDetach(CC_ARENA* Arena)
+{
+    CC_ARENA_CHUNK* chunks = Arena->Chunks;
+
+    ArInit(Arena);
+    return chunks;
+}
+
+void ArFreeChunks(void* Chunks)
+{
+    CC_ARENA_CHUNK* chunk = (CC_ARENA_CHUNK*)Chunks;
+
+    while (chunk != NULL)
+    {
+        CC_ARENA_CHUNK* next = chunk->Next;
+        free(chunk);
+        chunk = next;
+    }
+}
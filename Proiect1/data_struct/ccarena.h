@@ -0,0 +1,38 @@
+#pragma once
+#include <stddef.h>
+
+// Bump allocator for strings and other byte data. Allocations are packed one after
+// the other in big chunks and are never freed on their own, ArRelease gives back
+// every chunk at once. Memory is not aligned, use it for char data only.
+#define AR_MIN_CHUNK_SIZE   4096
+#define AR_MAX_CHUNK_SIZE   (1 << 20)
+
+typedef struct _CC_ARENA_CHUNK {
+    struct _CC_ARENA_CHUNK* Next;   //chunk allocated before this one
+    size_t Size;                    //usable bytes after the header
+} CC_ARENA_CHUNK;
+
+typedef struct _CC_ARENA {
+    CC_ARENA_CHUNK* Chunks; //most recent chunk first, NULL before the first allocation
+    char* Next;             //first free byte of the current chunk
+    size_t Left;            //free bytes left in the current chunk
+    size_t Used;            //bytes handed out by ArAlloc since the last ArRelease
+    size_t Reserved;        //bytes allocated for chunks, headers included
+} CC_ARENA;
+
+// Prepares an empty arena, nothing is allocated until the first ArAlloc
+void ArInit(CC_ARENA *Arena);
+
+// Returns -1 if the parameters are invalid or a new chunk could not be allocated
+int ArAlloc(CC_ARENA *Arena, size_t Size, char **Memory);
+
+// Copies Length bytes of String and a terminating '\0' into the arena
+int ArCopyString(CC_ARENA *Arena, const char *String, size_t Length, char **Copy);
+
+// Frees every chunk, the arena can be used again afterwards
+void ArRelease(CC_ARENA *Arena);
+
+// Empties the arena like ArRelease but returns its chunks instead of freeing them,
+// NULL if it had none. ArFreeChunks frees them later.
+CC_ARENA_CHUNK* ArDetach(CC_ARENA *Arena);
+void ArFreeChunks(void *Chunks);
@@ -0,0 +1,492 @@
+#include "ccconcurrenthashtable.h"
+#include "cchashtable_internal.h"
+#include <string.h>
+
+// Shard tables place keys with the low bits of the hash and tag them with the top 7,
+// the shard is picked with bits from the middle so it says nothing about either
+#define SHARD_INDEX(HashTable, Hash) ((int)((Hash) >> 32) & ((HashTable)->ShardCount - 1))
+
+// Hashes Key once and returns the shard it belongs to, all shards share the hash function
+static CC_HASH_TABLE_SHARD* GetShard(CC_CONCURRENT_HASH_TABLE* HashTable, char* Key, unsigned long long* Hash, unsigned int* Length)
+{
+    *Hash = HtpHashKey(HashTable->Shards[0].Shard.Table, Key, Length);
+    return &HashTable->Shards[SHARD_INDEX(HashTable, *Hash)].Shard;
+}
+
+// Retired memory of the shard tables waits in the table epoch
+static void RetireToEpoch(void* Context, void* Memory, CC_FREE_ROUTINE FreeRoutine)
+{
+    //out of memory with readers still inside: Memory is leaked, freeing it is not safe
+    EpRetire((CC_EPOCH*)Context, Memory, FreeRoutine);
+}
+
+// Lock-free lookup, returns 0 and the value of Key if it is in the table
+static int FindValueLockFree(CC_CONCURRENT_HASH_TABLE* HashTable, CC_HASH_TABLE_SHARD* Shard, char* Key, unsigned long long Hash, unsigned int Length, int* Value)
+{
+    NODEH* slot;
+    int token;
+    int retVal = -1;
+
+    token = EpEnter(&HashTable->Epoch);
+    slot = HtpFindKeyConcurrent(Shard->Table, Key, Hash, Length);
+    if (slot != NULL)
+    {
+        //a writer may be storing a new value, it does so with an atomic store
+        *Value = CcAtomicLoadInt((volatile int*)&slot->Data);
+        retVal = 0;
+    }
+    EpExit(&HashTable->Epoch, token);
+    return retVal;
+}
+
+int ChtCreate(CC_CONCURRENT_HASH_TABLE** HashTable, int ShardCount, CC_HASH_TABLE_OPTIONS* Options)
+{
+    CC_CONCURRENT_HASH_TABLE* table = NULL;
+    CC_HASH_TABLE_OPTIONS options = { 0 };
+    int shardCount = 1;
+
+    if (HashTable == NULL || ShardCount < 0 || ShardCount > CHT_MAX_SHARD_COUNT)
+    {
+        return -1;
+    }
+    if (Options != NULL)
+    {
+        options = *Options;
+    }
+
+    if (ShardCount == 0)
+    {
+        ShardCount = CHT_DEFAULT_SHARD_COUNT;
+    }
+    while (shardCount < ShardCount)
+    {
+        shardCount *= 2;
+    }
+    options.InitialCapacity = (options.InitialCapacity + shardCount - 1) / shardCount;
+    if (options.Flags & CHT_FLAG_LOCK_FREE_READS)
+    {
+        options.Flags |= HT_FLAG_OWN_KEYS;
+    }
+
+    table = (CC_CONCURRENT_HASH_TABLE*)malloc(sizeof(CC_CONCURRENT_HASH_TABLE));
+    if (table == NULL)
+    {
+        return -1;
+    }
+    table->ShardCount = 0;
+    table->Flags = options.Flags & CHT_FLAG_LOCK_FREE_READS;
+    options.Flags &= ~CHT_FLAG_LOCK_FREE_READS;
+    memset(&table->Epoch, 0, sizeof(table->Epoch));
+    if ((table->Flags & CHT_FLAG_LOCK_FREE_READS) && EpInit(&table->Epoch) != 0)
+    {
+        free(table);
+        return -1;
+    }
+    table->Shards = (CC_HASH_TABLE_SHARD_LINE*)CcAlignedAlloc(sizeof(CC_HASH_TABLE_SHARD_LINE) * (size_t)shardCount, CC_CACHE_LINE_SIZE);
+    if (table->Shards == NULL)
+    {
+        EpDestroy(&table->Epoch);
+        free(table);
+        return -1;
+    }
+    memset(table->Shards, 0, sizeof(CC_HASH_TABLE_SHARD_LINE) * (size_t)shardCount);
+
+    for (int i = 0; i < shardCount; i++)
+    {
+        CC_HASH_TABLE_SHARD* shard = &table->Shards[i].Shard;
+
+        if (HtCreateEx(&shard->Table, &options) != 0)
+        {
+            ChtDestroy(&table);
+            return -1;
+        }
+        if ((table->Flags & CHT_FLAG_LOCK_FREE_READS) && HtpEnableConcurrentReads(shard->Table, RetireToEpoch, &table->Epoch) != 0)
+        {
+            HtDestroy(&shard->Table);
+            ChtDestroy(&table);
+            return -1;
+        }
+        if (CcRwLockInit(&shard->Lock) != 0)
+        {
+            HtDestroy(&shard->Table);
+            ChtDestroy(&table);
+            return -1;
+        }
+        //ChtDestroy only cleans up the shards counted here
+        table->ShardCount = i + 1;
+    }
+
+    *HashTable = table;
+    return 0;
+}
+
+int ChtDestroy(CC_CONCURRENT_HASH_TABLE** HashTable)
+{
+    if (HashTable == NULL || *HashTable == NULL)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < (*HashTable)->ShardCount; i++)
+    {
+        CC_HASH_TABLE_SHARD* shard = &(*HashTable)->Shards[i].Shard;
+
+        HtDestroy(&shard->Table);
+        CcRwLockDestroy(&shard->Lock);
+    }
+    CcAlignedFree((*HashTable)->Shards);
+    //after the shards, destroying them may still retire memory
+    EpDestroy(&(*HashTable)->Epoch);
+    free(*HashTable);
+    *HashTable = NULL;
+    return 0;
+}
+
+int ChtSetKeyValue(CC_CONCURRENT_HASH_TABLE* HashTable, char* Key, int Value)
+{
+    CC_HASH_TABLE_SHARD* shard;
+    unsigned long long hash;
+    unsigned int length;
+    int retVal;
+
+    if (HashTable == NULL || Key == NULL)
+    {
+        return -1;
+    }
+
+    shard = GetShard(HashTable, Key, &hash, &length);
+    CcRwLockAcquireExclusive(&shard->Lock);
+    retVal = HtpSetKeyValue(shard->Table, Key, Value, hash, length);
+    CcRwLockReleaseExclusive(&shard->Lock);
+    return retVal;
+}
+
+int ChtGetKeyValue(CC_CONCURRENT_HASH_TABLE* HashTable, char* Key, int* Value)
+{
+    CC_HASH_TABLE_SHARD* shard;
+    NODEH* slot;
+    unsigned long long hash;
+    unsigned int length;
+    int retVal = -1;
+
+    if (HashTable == NULL || Key == NULL || Value == NULL)
+    {
+        return -1;
+    }
+
+    shard = GetShard(HashTable, Key, &hash, &length);
+    if (HashTable->Flags & CHT_FLAG_LOCK_FREE_READS)
+    {
+        return FindValueLockFree(HashTable, shard, Key, hash, length, Value);
+    }
+
+    //HtGetKeyValue may migrate slots, HtpFindKey never changes the shard
+    CcRwLockAcquireShared(&shard->Lock);
+    slot = HtpFindKey(shard->Table, Key, hash, length);
+    if (slot != NULL)
+    {
+        *Value = slot->Data;
+        retVal = 0;
+    }
+    CcRwLockReleaseShared(&shard->Lock);
+    return retVal;
+}
+
+int ChtRemoveKey(CC_CONCURRENT_HASH_TABLE* HashTable, char* Key)
+{
+    CC_HASH_TABLE_SHARD* shard;
+    unsigned long long hash;
+    unsigned int length;
+    int retVal;
+
+    if (HashTable == NULL || Key == NULL)
+    {
+        return -1;
+    }
+
+    shard = GetShard(HashTable, Key, &hash, &length);
+    CcRwLockAcquireExclusive(&shard->Lock);
+    retVal = HtpRemoveKey(shard->Table, Key, hash, length);
+    CcRwLockReleaseExclusive(&shard->Lock);
+    return retVal;
+}
+
+int ChtHasKey(CC_CONCURRENT_HASH_TABLE* HashTable, char* Key)
+{
+    CC_HASH_TABLE_SHARD* shard;
+    unsigned long long hash;
+    unsigned int length;
+    int retVal;
+
+    if (HashTable == NULL || Key == NULL)
+    {
+        return -1;
+    }
+
+    shard = GetShard(HashTable, Key, &hash, &length);
+    if (HashTable->Flags & CHT_FLAG_LOCK_FREE_READS)
+    {
+        int value;
+        return FindValueLockFree(HashTable, shard, Key, hash, length, &value) == 0;
+    }
+
+    CcRwLockAcquireShared(&shard->Lock);
+    retVal = HtpFindKey(shard->Table, Key, hash, length) != NULL;
+    CcRwLockReleaseShared(&shard->Lock);
+    return retVal;
+}
+
+int ChtGetOrInsert(CC_CONCURRENT_HASH_TABLE* HashTable, char* Key, int Value, int* Current)
+{
+    CC_HASH_TABLE_SHARD* shard;
+    NODEH* slot;
+    unsigned long long hash;
+    unsigned int length;
+    int inserted;
+    int retVal = 0;
+
+    if (HashTable == NULL || Key == NULL || Current == NULL)
+    {
+        return -1;
+    }
+
+    shard = GetShard(HashTable, Key, &hash, &length);
+
+    //most calls find the key, try that under the shared lock first
+    if (HashTable->Flags & CHT_FLAG_LOCK_FREE_READS)
+    {
+        if (FindValueLockFree(HashTable, shard, Key, hash, length, Current) == 0)
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        CcRwLockAcquireShared(&shard->Lock);
+        slot = HtpFindKey(shard->Table, Key, hash, length);
+        if (slot != NULL)
+        {
+            *Current = slot->Data;
+        }
+        CcRwLockReleaseShared(&shard->Lock);
+        if (slot != NULL)
+        {
+            return 1;
+        }
+    }
+
+    //another thread may have inserted Key in between, look again
+    CcRwLockAcquireExclusive(&shard->Lock);
+    slot = HtpFindOrInsertKey(shard->Table, Key, Value, hash, length, &inserted);
+    if (slot != NULL)
+    {
+        *Current = slot->Data;
+        retVal = !inserted;
+    }
+    else
+    {
+        retVal = -1;
+    }
+    CcRwLockReleaseExclusive(&shard->Lock);
+    return retVal;
+}
+
+int ChtUpsert(CC_CONCURRENT_HASH_TABLE* HashTable, char* Key, int Value)
+{
+    CC_HASH_TABLE_SHARD* shard;
+    NODEH* slot;
+    unsigned long long hash;
+    unsigned int length;
+    int inserted;
+    int retVal = -1;
+
+    if (HashTable == NULL || Key == NULL)
+    {
+        return -1;
+    }
+
+    shard = GetShard(HashTable, Key, &hash, &length);
+    CcRwLockAcquireExclusive(&shard->Lock);
+    slot = HtpFindOrInsertKey(shard->Table, Key, Value, hash, length, &inserted);
+    if (slot != NULL)
+    {
+        //lock-free readers load Data without the shard lock
+        CcAtomicStoreInt((volatile int*)&slot->Data, Value);
+        retVal = !inserted;
+    }
+    CcRwLockReleaseExclusive(&shard->Lock);
+    return retVal;
+}
+
+int ChtIncrementBy(CC_CONCURRENT_HASH_TABLE* HashTable, char* Key, int Delta, int* NewValue)
+{
+    CC_HASH_TABLE_SHARD* shard;
+    NODEH* slot;
+    unsigned long long hash;
+    unsigned int length;
+    int inserted;
+    int retVal = -1;
+
+    if (HashTable == NULL || Key == NULL)
+    {
+        return -1;
+    }
+
+    shard = GetShard(HashTable, Key, &hash, &length);
+    CcRwLockAcquireExclusive(&shard->Lock);
+    slot = HtpFindOrInsertKey(shard->Table, Key, Delta, hash, length, &inserted);
+    if (slot != NULL)
+    {
+        int value = inserted ? slot->Data : CcAtomicAddInt((volatile int*)&slot->Data, Delta);
+
+        if (NewValue != NULL)
+        {
+            *NewValue = value;
+        }
+        retVal = !inserted;
+    }
+    CcRwLockReleaseExclusive(&shard->Lock);
+    return retVal;
+}
+
+int ChtCompareAndSet(CC_CONCURRENT_HASH_TABLE* HashTable, char* Key, int* Expected, int Desired)
+{
+    CC_HASH_TABLE_SHARD* shard;
+    NODEH* slot;
+    unsigned long long hash;
+    unsigned int length;
+    int retVal = -1;
+
+    if (HashTable == NULL || Key == NULL || Expected == NULL)
+    {
+        return -1;
+    }
+
+    shard = GetShard(HashTable, Key, &hash, &length);
+    CcRwLockAcquireExclusive(&shard->Lock);
+    slot = HtpFindKey(shard->Table, Key, hash, length);
+    if (slot != NULL)
+    {
+        if (slot->Data == *Expected)
+        {
+            CcAtomicStoreInt((volatile int*)&slot->Data, Desired);
+            retVal = 0;
+        }
+        else
+        {
+            *Expected = slot->Data;
+            retVal = 1;
+        }
+    }
+    CcRwLockReleaseExclusive(&shard->Lock);
+    return retVal;
+}
+
+int ChtGetFirstKey(CC_CONCURRENT_HASH_TABLE* HashTable, CC_CONCURRENT_HASH_TABLE_ITERATOR** Iterator, char** Key)
+{
+    CC_CONCURRENT_HASH_TABLE_ITERATOR* iterator = NULL;
+
+    if (NULL == HashTable || NULL == Iterator || NULL == Key)
+    {
+        return -1;
+    }
+
+    iterator = (CC_CONCURRENT_HASH_TABLE_ITERATOR*)malloc(sizeof(CC_CONCURRENT_HASH_TABLE_ITERATOR));
+    if (NULL == iterator)
+    {
+        return -1;
+    }
+
+    memset(iterator, 0, sizeof(*iterator));
+    iterator->HashTable = HashTable;
+    iterator->Shard = 0;
+    iterator->Position.HashTable = HashTable->Shards[0].Shard.Table;
+    iterator->Position.Index = -1;
+    *Iterator = iterator;
+
+    return ChtGetNextKey(iterator, Key);
+}
+
+int ChtGetNextKey(CC_CONCURRENT_HASH_TABLE_ITERATOR* Iterator, char** Key)
+{
+    CC_CONCURRENT_HASH_TABLE* hashTable;
+
+    if (Iterator == NULL || Key == NULL || Iterator->HashTable == NULL)
+    {
+        return -1;
+    }
+
+    hashTable = Iterator->HashTable;
+    while (Iterator->Shard < hashTable->ShardCount)
+    {
+        CC_HASH_TABLE_SHARD* shard = &hashTable->Shards[Iterator->Shard].Shard;
+        int retVal;
+
+        //HtGetNextKey only reads the shard, unlike HtGetFirstKey
+        CcRwLockAcquireShared(&shard->Lock);
+        retVal = HtGetNextKey(&Iterator->Position, Key);
+        CcRwLockReleaseShared(&shard->Lock);
+        if (retVal != -2)
+        {
+            return retVal;
+        }
+
+        Iterator->Shard += 1;
+        if (Iterator->Shard < hashTable->ShardCount)
+        {
+            Iterator->Position.HashTable = hashTable->Shards[Iterator->Shard].Shard.Table;
+            Iterator->Position.Index = -1;
+            Iterator->Position.Current = NULL;
+        }
+    }
+    return -2;
+}
+
+int ChtReleaseIterator(CC_CONCURRENT_HASH_TABLE_ITERATOR** Iterator)
+{
+    if (Iterator == NULL)
+    {
+        return -1;
+    }
+    free(*Iterator);
+    *Iterator = NULL;
+    return 0;
+}
+
+int ChtClear(CC_CONCURRENT_HASH_TABLE* HashTable)
+{
+    if (HashTable == NULL)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < HashTable->ShardCount; i++)
+    {
+        CC_HASH_TABLE_SHARD* shard = &HashTable->Shards[i].Shard;
+
+        CcRwLockAcquireExclusive(&shard->Lock);
+        HtClear(shard->Table);
+        CcRwLockReleaseExclusive(&shard->Lock);
+    }
+    return 0;
+}
+
+int ChtGetKeyCount(CC_CONCURRENT_HASH_TABLE* HashTable)
+{
+    int count = 0;
+
+    if (HashTable == NULL)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < HashTable->ShardCount; i++)
+    {
+        CC_HASH_TABLE_SHARD* shard = &HashTable->Shards[i].Shard;
+
+        CcRwLockAcquireShared(&shard->Lock);
+        count += HtGetKeyCount(shard->Table);
+        CcRwLockReleaseShared(&shard->Lock);
+    }
+    return count;
+}
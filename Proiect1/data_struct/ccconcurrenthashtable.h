@@ -0,0 +1,85 @@
+#pragma once
+#include "cchashtable.h"
+#include "ccplatform.h"
+#include "ccepoch.h"
+
+// Thread-safe hash table. The key space is split into ShardCount CC_HASH_TABLEs picked
+// by the key hash, each with its own reader-writer lock, so threads working on different
+// shards never wait for each other. Lookups take the shard lock shared, changes take it
+// exclusive. Every shard sits on its own cache lines, taking one lock does not
+// invalidate the line of the neighbouring shard.
+#define CHT_DEFAULT_SHARD_COUNT 64
+#define CHT_MAX_SHARD_COUNT     4096
+
+// Flag for CC_HASH_TABLE_OPTIONS.Flags. Lookups (ChtGetKeyValue, ChtHasKey and the
+// check done by ChtGetOrInsert) take no lock at all and are wait-free: they only
+// register in an epoch (ccepoch.h) while they read. Writers still lock their shard,
+// publish new slot arrays with atomic stores and retire the old arrays and key chunks
+// to the epoch, which frees them once every reader has moved on. Implies
+// HT_FLAG_OWN_KEYS and turns HT_FLAG_INCREMENTAL_REHASH off. Deleted slots are only
+// reused after the next rehash, so tables with many removals rehash more often.
+#define CHT_FLAG_LOCK_FREE_READS    0x10000
+
+typedef struct _CC_HASH_TABLE_SHARD {
+    CC_RWLOCK Lock;
+    CC_HASH_TABLE* Table;
+} CC_HASH_TABLE_SHARD;
+
+// A shard padded to a whole number of cache lines
+typedef union _CC_HASH_TABLE_SHARD_LINE {
+    CC_HASH_TABLE_SHARD Shard;
+    char Padding[(sizeof(CC_HASH_TABLE_SHARD) + CC_CACHE_LINE_SIZE - 1) / CC_CACHE_LINE_SIZE * CC_CACHE_LINE_SIZE];
+} CC_HASH_TABLE_SHARD_LINE;
+
+typedef struct _CC_CONCURRENT_HASH_TABLE {
+    CC_HASH_TABLE_SHARD_LINE* Shards;   //cache line aligned array of ShardCount shards
+    int ShardCount;                     //power of two
+    int Flags;                          //CHT_FLAG_* values
+    CC_EPOCH Epoch;                     //readers and retired memory, CHT_FLAG_LOCK_FREE_READS only
+} CC_CONCURRENT_HASH_TABLE;
+
+typedef struct _CC_CONCURRENT_HASH_TABLE_ITERATOR {
+    CC_CONCURRENT_HASH_TABLE* HashTable;    // set by call to ChtGetFirstKey
+    int Shard;                              //shard being iterated
+    CC_HASH_TABLE_ITERATOR Position;        //position inside that shard
+} CC_CONCURRENT_HASH_TABLE_ITERATOR;
+
+// ShardCount is rounded up to a power of two, 0 for CHT_DEFAULT_SHARD_COUNT.
+// Options are applied to every shard and can be NULL, InitialCapacity is for the
+// whole table and Flags may also hold CHT_FLAG_* values.
+int ChtCreate(CC_CONCURRENT_HASH_TABLE **HashTable, int ShardCount, CC_HASH_TABLE_OPTIONS *Options);
+
+// No other thread may use HashTable during or after the call
+int ChtDestroy(CC_CONCURRENT_HASH_TABLE **HashTable);
+
+// Same results as the Ht* functions with the same name
+int ChtSetKeyValue(CC_CONCURRENT_HASH_TABLE *HashTable, char *Key, int Value);
+int ChtGetKeyValue(CC_CONCURRENT_HASH_TABLE *HashTable, char *Key, int *Value);
+int ChtRemoveKey(CC_CONCURRENT_HASH_TABLE *HashTable, char *Key);
+int ChtHasKey(CC_CONCURRENT_HASH_TABLE *HashTable, char *Key);
+
+// Atomic versions of HtGetOrInsert and HtCompareAndSet, no other thread can change Key
+// between the check and the update
+int ChtGetOrInsert(CC_CONCURRENT_HASH_TABLE *HashTable, char *Key, int Value, int *Current);
+int ChtCompareAndSet(CC_CONCURRENT_HASH_TABLE *HashTable, char *Key, int *Expected, int Desired);
+
+// Atomic versions of HtUpsert and HtIncrementBy, the update happens in one probe under
+// the lock of the shard. There is no ChtGetValuePtr: the value could be moved or freed
+// by another thread as soon as the lock is released.
+int ChtUpsert(CC_CONCURRENT_HASH_TABLE *HashTable, char *Key, int Value);
+int ChtIncrementBy(CC_CONCURRENT_HASH_TABLE *HashTable, char *Key, int Delta, int *NewValue);
+
+// Iteration locks one shard at a time. Keys added or removed by other threads while
+// iterating may or may not be returned, and a key can be returned twice if its shard
+// grows in the meantime. With HT_FLAG_OWN_KEYS the returned key points into the table
+// and is only valid until another thread changes the shard.
+// Return values are the ones of HtGetFirstKey and HtGetNextKey
+int ChtGetFirstKey(CC_CONCURRENT_HASH_TABLE *HashTable, CC_CONCURRENT_HASH_TABLE_ITERATOR **Iterator, char **Key);
+int ChtGetNextKey(CC_CONCURRENT_HASH_TABLE_ITERATOR *Iterator, char **Key);
+int ChtReleaseIterator(CC_CONCURRENT_HASH_TABLE_ITERATOR **Iterator);
+
+// Clears the shards one after the other
+int ChtClear(CC_CONCURRENT_HASH_TABLE *HashTable);
+
+// Sum of the shard counts, exact only if no other thread changes the table meanwhile
+int ChtGetKeyCount(CC_CONCURRENT_HASH_TABLE *HashTable);
@@ -0,0 +1,201 @@
+#include "ccepoch.h"
+#include <stdlib.h>
+#include <string.h>
+
+static volatile long gNextStripe = 0;
+static CC_THREAD_LOCAL int gThreadStripe = -1;
+
+// Threads get stripes round robin the first time they read
+static int GetThreadStripe(void)
+{
+    if (gThreadStripe < 0)
+    {
+        gThreadStripe = (int)((unsigned long)CcAtomicIncrement(&gNextStripe) % EP_STRIPE_COUNT);
+    }
+    return gThreadStripe;
+}
+
+int EpInit(CC_EPOCH* Epoch)
+{
+    if (Epoch == NULL)
+    {
+        return -1;
+    }
+
+    memset(Epoch, 0, sizeof(*Epoch));
+    Epoch->Stripes = (CC_EPOCH_STRIPE_LINE*)CcAlignedAlloc(sizeof(CC_EPOCH_STRIPE_LINE) * EP_STRIPE_COUNT, CC_CACHE_LINE_SIZE);
+    if (Epoch->Stripes == NULL)
+    {
+        return -1;
+    }
+    memset(Epoch->Stripes, 0, sizeof(CC_EPOCH_STRIPE_LINE) * EP_STRIPE_COUNT);
+
+    if (CcRwLockInit(&Epoch->Lock) != 0)
+    {
+        CcAlignedFree(Epoch->Stripes);
+        Epoch->Stripes = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void EpDestroy(CC_EPOCH* Epoch)
+{
+    CC_EPOCH_RETIRED* retired;
+
+    if (Epoch == NULL || Epoch->Stripes == NULL)
+    {
+        return;
+    }
+
+    retired = Epoch->Retired;
+    while (retired != NULL)
+    {
+        CC_EPOCH_RETIRED* next = retired->Next;
+        retired->FreeRoutine(retired->Memory);
+        free(retired);
+        retired = next;
+    }
+
+    CcRwLockDestroy(&Epoch->Lock);
+    CcAlignedFree(Epoch->Stripes);
+    memset(Epoch, 0, sizeof(*Epoch));
+}
+
+int EpEnter(CC_EPOCH* Epoch)
+{
+    int stripe = GetThreadStripe();
+    //a stale epoch is fine, it only holds the next advance back
+    int parity = (int)(CcAtomicLoad(&Epoch->Epoch) & 1);
+
+    //full barrier: the writer either sees this reader or the reader sees what the writer unpublished
+    CcAtomicIncrement(&Epoch->Stripes[stripe].Stripe.Active[parity]);
+    return stripe * 2 + parity;
+}
+
+void EpExit(CC_EPOCH* Epoch, int Token)
+{
+    CcAtomicDecrement(&Epoch->Stripes[Token / 2].Stripe.Active[Token % 2]);
+}
+
+// Advances the epoch by one if no reader of the previous parity is left, Lock must be held
+static void TryAdvance(CC_EPOCH* Epoch)
+{
+    long epoch = CcAtomicLoad(&Epoch->Epoch);
+    int parity = (int)((epoch - 1) & 1);
+
+    for (int i = 0; i < EP_STRIPE_COUNT; i++)
+    {
+        if (CcAtomicLoad(&Epoch->Stripes[i].Stripe.Active[parity]) != 0)
+        {
+            return;
+        }
+    }
+    CcAtomicCompareExchange(&Epoch->Epoch, epoch + 1, epoch);
+}
+
+// Frees what was retired at least two epochs ago, Lock must be held
+static void FreeRetired(CC_EPOCH* Epoch)
+{
+    long epoch = CcAtomicLoad(&Epoch->Epoch);
+    CC_EPOCH_RETIRED** link = &Epoch->Retired;
+
+    while (*link != NULL)
+    {
+        CC_EPOCH_RETIRED* retired = *link;
+
+        //unsigned difference, the epoch may wrap around
+        if ((unsigned long)(epoch - retired->Epoch) >= 2)
+        {
+            *link = retired->Next;
+            retired->FreeRoutine(retired->Memory);
+            free(retired);
+            Epoch->RetiredCount -= 1;
+        }
+        else
+        {
+            link = &retired->Next;
+        }
+    }
+}
+
+int EpRetire(CC_EPOCH* Epoch, void* Memory, CC_FREE_ROUTINE FreeRoutine)
+{
+    CC_EPOCH_RETIRED* retired;
+
+    if (Epoch == NULL || FreeRoutine == NULL)
+    {
+        return -1;
+    }
+    if (Memory == NULL)
+    {
+        return 0;
+    }
+
+    retired = (CC_EPOCH_RETIRED*)malloc(sizeof(CC_EPOCH_RETIRED));
+    if (retired == NULL)
+    {
+        //no node to remember it: wait for the readers without the lock and free it now
+        if (EpSynchronize(Epoch) != 0)
+        {
+            return -1;
+        }
+        FreeRoutine(Memory);
+        return 0;
+    }
+
+    CcRwLockAcquireExclusive(&Epoch->Lock);
+    //the caller unpublished Memory before this fence, readers counted after it cannot see it
+    CcFullFence();
+    retired->Memory = Memory;
+    retired->FreeRoutine = FreeRoutine;
+    retired->Epoch = CcAtomicLoad(&Epoch->Epoch);
+    retired->Next = Epoch->Retired;
+    Epoch->Retired = retired;
+    Epoch->RetiredCount += 1;
+    TryAdvance(Epoch);
+    FreeRetired(Epoch);
+    CcRwLockReleaseExclusive(&Epoch->Lock);
+    return 0;
+}
+
+int EpSynchronize(CC_EPOCH* Epoch)
+{
+    long epoch;
+
+    if (Epoch == NULL)
+    {
+        return -1;
+    }
+
+    //same as a retired node: two advances after this fence no earlier reader is left
+    CcFullFence();
+    epoch = CcAtomicLoad(&Epoch->Epoch);
+    for (int i = 0; i < EP_SYNCHRONIZE_ATTEMPTS; i++)
+    {
+        //the lock is only held for one try, other writers retire and collect in between
+        CcRwLockAcquireExclusive(&Epoch->Lock);
+        TryAdvance(Epoch);
+        FreeRetired(Epoch);
+        CcRwLockReleaseExclusive(&Epoch->Lock);
+
+        if ((unsigned long)(CcAtomicLoad(&Epoch->Epoch) - epoch) >= 2)
+        {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void EpCollect(CC_EPOCH* Epoch)
+{
+    if (Epoch == NULL)
+    {
+        return;
+    }
+
+    CcRwLockAcquireExclusive(&Epoch->Lock);
+    TryAdvance(Epoch);
+    FreeRetired(Epoch);
+    CcRwLockReleaseExclusive(&Epoch->Lock);
+}
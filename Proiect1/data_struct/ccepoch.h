@@ -0,0 +1,68 @@
+#pragma once
+#include "ccplatform.h"
+#include "common.h"
+
+// Epoch based reclamation. Readers wrap every access to shared memory between
+// EpEnter and EpExit, writers unpublish memory and pass it to EpRetire instead of
+// freeing it. Retired memory is freed once every reader that could still see it
+// has left.
+//
+// The domain has a global epoch and, for each parity of it, a count of the readers
+// that entered while the epoch had that parity. The counts are striped over
+// EP_STRIPE_COUNT cache lines picked by thread, so readers on different cores do not
+// write the same line. The epoch only moves from E to E + 1 when no reader of parity
+// E - 1 is left, so a reader holds the epoch back to at most one step after the one
+// it saw, and memory retired in epoch E is freed from epoch E + 2 on.
+// EpEnter and EpExit are wait-free, two atomic increments and no loop.
+#define EP_STRIPE_COUNT 64
+
+// Times EpSynchronize tries to advance the epoch before it gives up on the readers
+#define EP_SYNCHRONIZE_ATTEMPTS (1 << 16)
+
+typedef struct _CC_EPOCH_STRIPE {
+    volatile long Active[2];    //readers inside, by epoch parity
+} CC_EPOCH_STRIPE;
+
+typedef union _CC_EPOCH_STRIPE_LINE {
+    CC_EPOCH_STRIPE Stripe;
+    char Padding[CC_CACHE_LINE_SIZE];
+} CC_EPOCH_STRIPE_LINE;
+
+typedef struct _CC_EPOCH_RETIRED {
+    struct _CC_EPOCH_RETIRED* Next;
+    void* Memory;
+    CC_FREE_ROUTINE FreeRoutine;
+    long Epoch;                 //epoch when it was retired
+} CC_EPOCH_RETIRED;
+
+typedef struct _CC_EPOCH {
+    CC_EPOCH_STRIPE_LINE* Stripes;  //cache line aligned, EP_STRIPE_COUNT of them
+    volatile long Epoch;
+    CC_RWLOCK Lock;                 //guards Retired, taken exclusive by writers only
+    CC_EPOCH_RETIRED* Retired;      //most recent first
+    int RetiredCount;
+} CC_EPOCH;
+
+int EpInit(CC_EPOCH *Epoch);
+
+// Frees everything still retired, no reader may be inside
+void EpDestroy(CC_EPOCH *Epoch);
+
+// Returns the token to pass to EpExit
+int EpEnter(CC_EPOCH *Epoch);
+void EpExit(CC_EPOCH *Epoch, int Token);
+
+// Frees Memory with FreeRoutine once no reader can reach it. Memory must already be
+// unreachable for readers entering from now on. Without memory to remember it, waits
+// with EpSynchronize and frees it right away.
+// Returns -1 if the parameters are invalid or if that wait failed, Memory is then
+// not freed
+int EpRetire(CC_EPOCH *Epoch, void *Memory, CC_FREE_ROUTINE FreeRoutine);
+
+// Waits until every reader inside when it was called has left, the caller must not
+// be inside itself.
+// Returns -1 if the readers were still inside after EP_SYNCHRONIZE_ATTEMPTS tries
+int EpSynchronize(CC_EPOCH *Epoch);
+
+// Moves the epoch forward if the readers allow it and frees what became safe to free
+void EpCollect(CC_EPOCH *Epoch);
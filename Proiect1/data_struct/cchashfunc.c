@@ -0,0 +1,301 @@
+#ifdef _MSC_VER
+#define _CRT_RAND_S
+#endif
+#include "cchashfunc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+static unsigned long long Read64(const unsigned char* Data)
+{
+    unsigned long long value;
+    memcpy(&value, Data, sizeof(value));
+    return value;
+}
+
+static unsigned long long Read32(const unsigned char* Data)
+{
+    unsigned int value;
+    memcpy(&value, Data, sizeof(value));
+    return value;
+}
+
+static unsigned long long Rotl64(unsigned long long Value, int Bits)
+{
+    return (Value << Bits) | (Value >> (64 - Bits));
+}
+
+// Full 64x64 -> 128 bit multiply, Low and High get the two halves
+static void Multiply128(unsigned long long A, unsigned long long B, unsigned long long* Low, unsigned long long* High)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    *Low = _umul128(A, B, High);
+#elif defined(__SIZEOF_INT128__)
+    unsigned __int128 product = (unsigned __int128)A * B;
+    *Low = (unsigned long long)product;
+    *High = (unsigned long long)(product >> 64);
+#else
+    unsigned long long aLow = A & 0xFFFFFFFF, aHigh = A >> 32;
+    unsigned long long bLow = B & 0xFFFFFFFF, bHigh = B >> 32;
+    unsigned long long lowLow = aLow * bLow, lowHigh = aLow * bHigh;
+    unsigned long long highLow = aHigh * bLow, highHigh = aHigh * bHigh;
+    unsigned long long middle = (lowLow >> 32) + (lowHigh & 0xFFFFFFFF) + (highLow & 0xFFFFFFFF);
+
+    *Low = (lowLow & 0xFFFFFFFF) | (middle << 32);
+    *High = highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+#endif
+}
+
+static unsigned long long WyMix(unsigned long long A, unsigned long long B)
+{
+    unsigned long long low, high;
+    Multiply128(A, B, &low, &high);
+    return low ^ high;
+}
+
+static const unsigned long long gWySecret[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+unsigned long long HfWyHash(const void* Data, size_t Length, unsigned long long Seed)
+{
+    const unsigned char* p = (const unsigned char*)Data;
+    unsigned long long a, b;
+    size_t left = Length;
+
+    Seed ^= WyMix(Seed ^ gWySecret[0], gWySecret[1]);
+
+    if (Length <= 16)
+    {
+        if (Length >= 4)
+        {
+            //two overlapping reads cover every length from 4 to 16
+            size_t shift = (Length >> 3) << 2;
+            a = (Read32(p) << 32) | Read32(p + shift);
+            b = (Read32(p + Length - 4) << 32) | Read32(p + Length - 4 - shift);
+        }
+        else if (Length > 0)
+        {
+            a = ((unsigned long long)p[0] << 16) | ((unsigned long long)p[Length >> 1] << 8) | p[Length - 1];
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        if (left > 48)
+        {
+            unsigned long long seed1 = Seed, seed2 = Seed;
+            do
+            {
+                Seed = WyMix(Read64(p) ^ gWySecret[1], Read64(p + 8) ^ Seed);
+                seed1 = WyMix(Read64(p + 16) ^ gWySecret[2], Read64(p + 24) ^ seed1);
+                seed2 = WyMix(Read64(p + 32) ^ gWySecret[3], Read64(p + 40) ^ seed2);
+                p += 48;
+                left -= 48;
+            } while (left > 48);
+            Seed ^= seed1 ^ seed2;
+        }
+        while (left > 16)
+        {
+            Seed = WyMix(Read64(p) ^ gWySecret[1], Read64(p + 8) ^ Seed);
+            p += 16;
+            left -= 16;
+        }
+        //the last 16 bytes, may overlap what was already mixed
+        a = Read64(p + left - 16);
+        b = Read64(p + left - 8);
+    }
+
+    a ^= gWySecret[1];
+    b ^= Seed;
+    Multiply128(a, b, &a, &b);
+    return WyMix(a ^ gWySecret[0] ^ Length, b ^ gWySecret[1]);
+}
+
+#define XX_PRIME1 0x9E3779B185EBCA87ULL
+#define XX_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define XX_PRIME3 0x165667B19E3779F9ULL
+#define XX_PRIME4 0x85EBCA77C2B2AE63ULL
+#define XX_PRIME5 0x27D4EB2F165667C5ULL
+
+static unsigned long long XxRound(unsigned long long Accumulator, unsigned long long Input)
+{
+    Accumulator += Input * XX_PRIME2;
+    Accumulator = Rotl64(Accumulator, 31);
+    return Accumulator * XX_PRIME1;
+}
+
+static unsigned long long XxMergeRound(unsigned long long Accumulator, unsigned long long Value)
+{
+    Accumulator ^= XxRound(0, Value);
+    return Accumulator * XX_PRIME1 + XX_PRIME4;
+}
+
+unsigned long long HfXxHash64(const void* Data, size_t Length, unsigned long long Seed)
+{
+    const unsigned char* p = (const unsigned char*)Data;
+    const unsigned char* end = p + Length;
+    unsigned long long hash;
+
+    if (Length >= 32)
+    {
+        const unsigned char* limit = end - 32;
+        unsigned long long v1 = Seed + XX_PRIME1 + XX_PRIME2;
+        unsigned long long v2 = Seed + XX_PRIME2;
+        unsigned long long v3 = Seed;
+        unsigned long long v4 = Seed - XX_PRIME1;
+
+        do
+        {
+            v1 = XxRound(v1, Read64(p));
+            v2 = XxRound(v2, Read64(p + 8));
+            v3 = XxRound(v3, Read64(p + 16));
+            v4 = XxRound(v4, Read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = Rotl64(v1, 1) + Rotl64(v2, 7) + Rotl64(v3, 12) + Rotl64(v4, 18);
+        hash = XxMergeRound(hash, v1);
+        hash = XxMergeRound(hash, v2);
+        hash = XxMergeRound(hash, v3);
+        hash = XxMergeRound(hash, v4);
+    }
+    else
+    {
+        hash = Seed + XX_PRIME5;
+    }
+
+    hash += (unsigned long long)Length;
+
+    while (p + 8 <= end)
+    {
+        hash ^= XxRound(0, Read64(p));
+        hash = Rotl64(hash, 27) * XX_PRIME1 + XX_PRIME4;
+        p += 8;
+    }
+    if (p + 4 <= end)
+    {
+        hash ^= Read32(p) * XX_PRIME1;
+        hash = Rotl64(hash, 23) * XX_PRIME2 + XX_PRIME3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        hash ^= (*p) * XX_PRIME5;
+        hash = Rotl64(hash, 11) * XX_PRIME1;
+        p++;
+    }
+
+    hash ^= hash >> 33;
+    hash *= XX_PRIME2;
+    hash ^= hash >> 29;
+    hash *= XX_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+#define SIP_ROUND(V0, V1, V2, V3)                                  \
+    do                                                              \
+    {                                                               \
+        V0 += V1; V1 = Rotl64(V1, 13); V1 ^= V0; V0 = Rotl64(V0, 32); \
+        V2 += V3; V3 = Rotl64(V3, 16); V3 ^= V2;                    \
+        V0 += V3; V3 = Rotl64(V3, 21); V3 ^= V0;                    \
+        V2 += V1; V1 = Rotl64(V1, 17); V1 ^= V2; V2 = Rotl64(V2, 32); \
+    } while (0)
+
+unsigned long long HfSipHash(const void* Data, size_t Length, unsigned long long Seed)
+{
+    const unsigned char* p = (const unsigned char*)Data;
+    const unsigned char* end = p + (Length & ~(size_t)7);
+    //the 128-bit key is derived from Seed, both halves stay secret with it
+    unsigned long long k0 = Seed;
+    unsigned long long k1 = Rotl64(Seed, 32) ^ XX_PRIME1;
+    unsigned long long v0 = k0 ^ 0x736f6d6570736575ULL;
+    unsigned long long v1 = k1 ^ 0x646f72616e646f6dULL;
+    unsigned long long v2 = k0 ^ 0x6c7967656e657261ULL;
+    unsigned long long v3 = k1 ^ 0x7465646279746573ULL;
+    unsigned long long last = (unsigned long long)Length << 56;
+
+    for (; p != end; p += 8)
+    {
+        unsigned long long word = Read64(p);
+        v3 ^= word;
+        SIP_ROUND(v0, v1, v2, v3);
+        v0 ^= word;
+    }
+
+    switch (Length & 7)
+    {
+    case 7: last |= (unsigned long long)p[6] << 48; //fall through
+    case 6: last |= (unsigned long long)p[5] << 40; //fall through
+    case 5: last |= (unsigned long long)p[4] << 32; //fall through
+    case 4: last |= (unsigned long long)p[3] << 24; //fall through
+    case 3: last |= (unsigned long long)p[2] << 16; //fall through
+    case 2: last |= (unsigned long long)p[1] << 8;  //fall through
+    case 1: last |= (unsigned long long)p[0];
+        break;
+    default:
+        break;
+    }
+
+    v3 ^= last;
+    SIP_ROUND(v0, v1, v2, v3);
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+unsigned long long HfDjb2(const void* Data, size_t Length, unsigned long long Seed)
+{
+    const unsigned char* p = (const unsigned char*)Data;
+    unsigned long long hash = 5381 ^ Seed;
+
+    for (size_t i = 0; i < Length; i++)
+    {
+        hash = ((hash << 5) + hash) + p[i];
+    }
+
+    //murmur3 fmix64, djb2 alone leaves the low bits badly distributed
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+unsigned long long HfMakeSeed(void)
+{
+    unsigned long long seed = 0;
+
+#ifdef _MSC_VER
+    unsigned int low, high;
+    if (rand_s(&low) == 0 && rand_s(&high) == 0)
+    {
+        seed = ((unsigned long long)high << 32) | low;
+    }
+#else
+    FILE* random = fopen("/dev/urandom", "rb");
+    if (random != NULL)
+    {
+        if (fread(&seed, sizeof(seed), 1, random) != 1)
+        {
+            seed = 0;
+        }
+        fclose(random);
+    }
+#endif
+    return seed;
+}
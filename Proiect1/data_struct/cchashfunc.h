@@ -0,0 +1,23 @@
+#pragma once
+#include <stddef.h>
+
+// 64-bit hash functions that can be plugged into CC_HASH_TABLE through
+// CC_HASH_TABLE_OPTIONS. Seed changes the whole output, so two tables with
+// different seeds place the same keys differently.
+typedef unsigned long long (*CC_HASH_FUNCTION)(const void *Data, size_t Length, unsigned long long Seed);
+
+// wyhash style multiply-mix hash, the default: fastest on short and medium keys
+unsigned long long HfWyHash(const void *Data, size_t Length, unsigned long long Seed);
+
+// xxHash64 style hash, four independent lanes, good on long keys
+unsigned long long HfXxHash64(const void *Data, size_t Length, unsigned long long Seed);
+
+// SipHash-1-3 keyed with Seed. Slower, but as long as Seed stays secret an attacker
+// cannot build keys that collide, use it for tables filled from untrusted input
+unsigned long long HfSipHash(const void *Data, size_t Length, unsigned long long Seed);
+
+// djb2 followed by a 64-bit finalizer, kept for comparison with the old HashFunction
+unsigned long long HfDjb2(const void *Data, size_t Length, unsigned long long Seed);
+
+// Returns a random value to be used as a secret Seed, 0 if no random source is available
+unsigned long long HfMakeSeed(void);
@@ -1,24 +1,49 @@
 #include "cchashtable.h"
+#include "cchashtable_internal.h"
+#include "ccplatform.h"
 #include "common.h"
 #include <stdio.h>
+#include <string.h>
 
-int HashFunction(char* Key)
+#define IS_FULL_CONTROL(Control) ((Control) < HT_CTRL_EMPTY)
+#define HASH_CONTROL(Hash) ((unsigned char)((Hash) >> 57))
+
+// Slot Position of Array, in insertion order mode it is found through the index array
+#define SLOT_AT(Array, Position) \
+    ((Array)->Index != NULL ? &(Array)->Slots[(Array)->Index[Position]] : &(Array)->Slots[Position])
+
+#ifdef HT_ENABLE_COUNTERS
+#define COUNT_OPERATION(HashTable, Counter) ((HashTable)->Counters.Counter += 1)
+#else
+#define COUNT_OPERATION(HashTable, Counter) ((void)0)
+#endif
+
+// KeyLength of the entries removed from the dense array of an insertion ordered table
+#define ENTRY_REMOVED 0xFFFFFFFFu
+
+// Keys only get compared when both the full hash and the length match. The fence keeps
+// a lock-free reader from reading the slot before the control byte that matched.
+#define SLOT_HAS_KEY(Slots, Slot, Key, Hash, Length) \
+    (CcAcquireFence(), (Slot)->Hash == (Hash) && (Slot)->KeyLength == (Length) && memcmp(SLOT_KEY(Slots, Slot), (Key), (Length)) == 0)
+
+unsigned long long HtpHashKey(CC_HASH_TABLE* HashTable, char* Key, unsigned int* Length)
 {
-    int hash = 5381;
-    int itr;
+    size_t length = strlen(Key);
 
-    while (itr = *Key++)
-    {
-        hash = ((hash << 5) + hash) + itr;
-    }
-    return hash % SIZE_OF_HASH_TABLE;
+    *Length = (unsigned int)length;
+    return HashTable->HashRoutine(Key, length, HashTable->Seed);
+}
+
+unsigned int HashFunction(char* Key)
+{
+    return (unsigned int)HfWyHash(Key, strlen(Key), 0);
 }
 
 int EqualStrings(char* String1, char* String2)
 {
     int iter1, iter2;
     iter1 = iter2 = 0;
-    while (String1[iter1] != NULL && String2[iter2] != NULL && String1[iter1] == String2[iter2])
+    while (String1[iter1] != '\0' && String2[iter2] != '\0' && String1[iter1] == String2[iter2])
     {
         iter1++;
         iter2++;
@@ -30,350 +55,2142 @@ int EqualStrings(char* String1, char* String2)
     return 1;
 }
 
-int HtCreate(CC_HASH_TABLE** HashTable)
+// Copy of the CC_HASH_TABLE_SLOTS fields that lock-free readers need, kept in front
+// of the slots so a single pointer load gives them a consistent view of the array
+typedef struct _SLOTS_HEADER {
+    int Capacity;
+    unsigned int InlineLimit;
+} SLOTS_HEADER;
+
+// Keeps the slots 16 byte aligned after the header
+#define SLOTS_HEADER_SIZE 16
+#define SLOTS_HEADER(Slots) ((SLOTS_HEADER*)((char*)(Slots) - SLOTS_HEADER_SIZE))
+
+// Header, slots, control bytes and the occupancy bitmap share one allocation.
+// Slots->Slots is set last, once the array is ready for readers.
+// In insertion order mode the slots are 4 byte positions in the dense array, which
+// is allocated on its own by ResizeEntries and starts empty.
+static int AllocSlots(CC_HASH_TABLE* HashTable, CC_HASH_TABLE_SLOTS* Slots, int Capacity)
 {
-    if (HashTable == NULL)
+    int ordered = (HashTable->Flags & HT_FLAG_INSERTION_ORDER) != 0;
+    //rounded up to 16 bytes, the control bytes stay aligned like the header keeps the slots
+    size_t slotBytes = ordered ? ((sizeof(unsigned int) * (size_t)Capacity + 15) & ~(size_t)15) : sizeof(NODEH) * (size_t)Capacity;
+    //Capacity + HT_GROUP_WIDTH is a multiple of 8, the bitmap stays aligned
+    size_t controlBytes = (size_t)Capacity + HT_GROUP_WIDTH;
+    size_t bitmapBytes = sizeof(unsigned long long) * (((size_t)Capacity + 63) / 64);
+    char* block;
+
+    block = (char*)malloc(SLOTS_HEADER_SIZE + slotBytes + controlBytes + bitmapBytes);
+    if (block == NULL)
     {
         return -1;
     }
-    CC_HASH_TABLE* hash;
-    hash = NULL;
-    hash = (CC_HASH_TABLE*)malloc(sizeof(CC_HASH_TABLE));
-
-    if (hash == NULL)
+    Slots->Control = (unsigned char*)block + SLOTS_HEADER_SIZE + slotBytes;
+    memset(Slots->Control, HT_CTRL_EMPTY, controlBytes);
+    Slots->Occupied = (unsigned long long*)(Slots->Control + controlBytes);
+    memset(Slots->Occupied, 0, bitmapBytes);
+    Slots->Capacity = Capacity;
+    Slots->Used = 0;
+    Slots->InlineLimit = (HashTable->Flags & HT_FLAG_OWN_KEYS) ? HT_INLINE_KEY_LENGTH + 1 : 0;
+    ((SLOTS_HEADER*)block)->Capacity = Capacity;
+    ((SLOTS_HEADER*)block)->InlineLimit = Slots->InlineLimit;
+    Slots->EntryCapacity = 0;
+    if (ordered)
     {
-        return -1;
+        //no lock-free readers in this mode, nothing to publish
+        Slots->Index = (unsigned int*)(block + SLOTS_HEADER_SIZE);
+        Slots->Slots = NULL;
+        return 0;
     }
-    hash->Count = 0;
+    Slots->Index = NULL;
+    CcAtomicStorePointer((void* volatile*)&Slots->Slots, block + SLOTS_HEADER_SIZE);
+    return 0;
+}
+
+static int MinInt(int A, int B)
+{
+    return A < B ? A : B;
+}
+
+static int MaxInt(int A, int B)
+{
+    return A > B ? A : B;
+}
+
+// Remixes the key hash for the frozen table and the filter, the control bytes and the slot index
+// already took the bits of Hash that a bad hash function would have mixed best
+static unsigned long long FrozenMix(unsigned long long Hash)
+{
+    Hash ^= Hash >> 30;
+    Hash *= 0xbf58476d1ce4e5b9ULL;
+    Hash ^= Hash >> 27;
+    Hash *= 0x94d049bb133111ebULL;
+    Hash ^= Hash >> 31;
+    return Hash;
+}
+
+// Maps a 32-bit value to [0, Range) with a multiply instead of a division
+static unsigned int FastRange(unsigned int Value, unsigned int Range)
+{
+    return (unsigned int)(((unsigned long long)Value * Range) >> 32);
+}
 
+// Makes room for Count entries in the dense array of an insertion ordered table
+static int ResizeEntries(CC_HASH_TABLE_SLOTS* Slots, int Count)
+{
+    NODEH* entries = (NODEH*)realloc(Slots->Slots, sizeof(NODEH) * (size_t)Count);
 
-    for (int i = 0; i < SIZE_OF_HASH_TABLE; i++)
+    if (entries == NULL)
     {
-        hash->Table[i] = NULL;
+        return -1;
     }
-    *HashTable = hash;
+    Slots->Slots = entries;
+    Slots->EntryCapacity = Count;
     return 0;
 }
 
-int HtDestroy(CC_HASH_TABLE** HashTable)
+// Frees the array, or hands it to RetireRoutine when lock-free readers may still use it
+static void FreeSlots(CC_HASH_TABLE* HashTable, CC_HASH_TABLE_SLOTS* Slots)
 {
-    int retValue = 0;
-    if (HashTable == NULL)
+    NODEH* slots = Slots->Slots;
+    unsigned int* index = Slots->Index;
+
+    CcAtomicStorePointer((void* volatile*)&Slots->Slots, NULL);
+    Slots->Control = NULL;
+    Slots->Occupied = NULL;
+    Slots->Index = NULL;
+    Slots->Capacity = 0;
+    Slots->Used = 0;
+    Slots->EntryCapacity = 0;
+
+    if (index != NULL)
     {
-        return -1;
+        //insertion order mode, never read without the table lock
+        free(slots);
+        free(SLOTS_HEADER(index));
+        return;
+    }
+    if (slots == NULL)
+    {
+        return;
+    }
+
+    if (HashTable->RetireRoutine != NULL)
+    {
+        HashTable->RetireRoutine(HashTable->RetireContext, SLOTS_HEADER(slots), free);
+    }
+    else
+    {
+        free(SLOTS_HEADER(slots));
     }
-    for (int i = 0; i < SIZE_OF_HASH_TABLE; i++)
+}
+
+// Makes NewTable the array that receives keys, lock-free readers switch to it at once
+static void SetTable(CC_HASH_TABLE* HashTable, CC_HASH_TABLE_SLOTS* NewTable)
+{
+    HashTable->Table.Control = NewTable->Control;
+    HashTable->Table.Occupied = NewTable->Occupied;
+    HashTable->Table.Capacity = NewTable->Capacity;
+    HashTable->Table.Used = NewTable->Used;
+    HashTable->Table.InlineLimit = NewTable->InlineLimit;
+    HashTable->Table.Index = NewTable->Index;
+    HashTable->Table.EntryCapacity = NewTable->EntryCapacity;
+    CcAtomicStorePointer((void* volatile*)&HashTable->Table.Slots, NewTable->Slots);
+}
+
+// Gives back the chunks of Keys, same rules as FreeSlots
+static void ReleaseKeys(CC_HASH_TABLE* HashTable, CC_ARENA* Keys)
+{
+    if (HashTable->RetireRoutine != NULL)
     {
-        if ((*HashTable)->Table[i])
+        CC_ARENA_CHUNK* chunks = ArDetach(Keys);
+        if (chunks != NULL)
         {
-            retValue = DestroyNodes((*HashTable)->Table[i]);
-            if (retValue == -1)
-            {
-                return -1;
-            }
+            HashTable->RetireRoutine(HashTable->RetireContext, chunks, ArFreeChunks);
         }
     }
-    free(*HashTable);
-    return 0;
+    else
+    {
+        ArRelease(Keys);
+    }
 }
 
-int HtSetKeyValue(CC_HASH_TABLE* HashTable, char* Key, int Value)
+// The first group is mirrored after the last one so a group load never wraps around.
+// Every control byte change goes through here, so the occupancy bitmap follows them.
+static void SetControl(CC_HASH_TABLE_SLOTS* Slots, unsigned int Index, unsigned char Control)
 {
-    if (HashTable == NULL || Key == NULL)
+    Slots->Control[Index] = Control;
+    if (Index < HT_GROUP_WIDTH)
     {
-        return -1;
+        Slots->Control[(unsigned int)Slots->Capacity + Index] = Control;
     }
-    for (int i = 0; i < SIZE_OF_HASH_TABLE; i++)
+    if (IS_FULL_CONTROL(Control))
     {
-        if (HashTable->Table[i])
-        {
-            NODEH* temp;
-            temp = HashTable->Table[i];
+        Slots->Occupied[Index / 64] |= 1ULL << (Index % 64);
+    }
+    else
+    {
+        Slots->Occupied[Index / 64] &= ~(1ULL << (Index % 64));
+    }
+}
+
+// Each FindSlot* returns the index of the slot holding Key or -1 if Key is not in Slots.
+// Groups are probed in order starting with the one holding Hash & mask. The array is
+// never full, so the probe always ends on a group with an empty slot.
+static int FindSlotScalar(CC_HASH_TABLE_SLOTS* Slots, char* Key, unsigned long long Hash, unsigned int Length)
+{
+    unsigned int mask = (unsigned int)Slots->Capacity - 1;
+    unsigned int group = (unsigned int)Hash & mask & ~(unsigned int)(HT_GROUP_WIDTH - 1);
+    unsigned char control = HASH_CONTROL(Hash);
+
+    for (int probes = 0; probes < Slots->Capacity; probes += HT_GROUP_WIDTH)
+    {
+        int sawEmpty = 0;
 
-            while (temp)
+        for (unsigned int i = group; i < group + HT_GROUP_WIDTH; i++)
+        {
+            if (Slots->Control[i] == control && SLOT_HAS_KEY(Slots, SLOT_AT(Slots, i), Key, Hash, Length))
             {
-                if (EqualStrings(temp->Key, Key) == 1)
-                {
-                    return -1;
-                }
-                temp = temp->Next;
+                return (int)i;
             }
+            sawEmpty |= Slots->Control[i] == HT_CTRL_EMPTY;
+        }
+        if (sawEmpty)
+        {
+            return -1;
         }
+        group = (group + HT_GROUP_WIDTH) & mask;
     }
+    return -1;
+}
 
-    int hashKey;
-    hashKey = HashFunction(Key);
+#ifdef CC_X86
+static int FindSlotSse2(CC_HASH_TABLE_SLOTS* Slots, char* Key, unsigned long long Hash, unsigned int Length)
+{
+    unsigned int mask = (unsigned int)Slots->Capacity - 1;
+    unsigned int group = (unsigned int)Hash & mask & ~(unsigned int)(HT_GROUP_WIDTH - 1);
+    __m128i control = _mm_set1_epi8((char)HASH_CONTROL(Hash));
+    __m128i empty = _mm_set1_epi8((char)HT_CTRL_EMPTY);
 
-    if (HashTable->Table[hashKey] == NULL)
+    for (int probes = 0; probes < Slots->Capacity; probes += HT_GROUP_WIDTH)
     {
-        NODEH* temp;
-        temp = (NODEH*)malloc(sizeof(NODEH));
-        if (temp == NULL)
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(Slots->Control + group));
+        unsigned int matches = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, control));
+
+        while (matches != 0)
+        {
+            unsigned int index = group + CcCountTrailingZeros(matches);
+            if (SLOT_HAS_KEY(Slots, SLOT_AT(Slots, index), Key, Hash, Length))
+            {
+                return (int)index;
+            }
+            matches &= matches - 1;
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, empty)) != 0)
         {
             return -1;
         }
-        temp->Data = Value;
-        temp->Next = NULL;
-        temp->Key = Key;
-        HashTable->Table[hashKey] = temp;
-        HashTable->Count += 1;
-        return 0;
+        group = (group + HT_GROUP_WIDTH) & mask;
     }
-    else
+    return -1;
+}
+
+// Checks two groups per step, the second one may be the mirror of the first group
+CC_TARGET_AVX2
+static int FindSlotAvx2(CC_HASH_TABLE_SLOTS* Slots, char* Key, unsigned long long Hash, unsigned int Length)
+{
+    unsigned int mask = (unsigned int)Slots->Capacity - 1;
+    unsigned int group = (unsigned int)Hash & mask & ~(unsigned int)(HT_GROUP_WIDTH - 1);
+    __m256i control = _mm256_set1_epi8((char)HASH_CONTROL(Hash));
+    __m256i empty = _mm256_set1_epi8((char)HT_CTRL_EMPTY);
+
+    for (int probes = 0; probes < Slots->Capacity; probes += 2 * HT_GROUP_WIDTH)
     {
-        NODEH* temp;
-        NODEH* iterate;
-        temp = (NODEH*)malloc(sizeof(NODEH));
-        if (temp == NULL)
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)(Slots->Control + group));
+        unsigned int matches = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, control));
+
+        while (matches != 0)
         {
-            return -1;
+            unsigned int index = (group + CcCountTrailingZeros(matches)) & mask;
+            if (SLOT_HAS_KEY(Slots, SLOT_AT(Slots, index), Key, Hash, Length))
+            {
+                return (int)index;
+            }
+            matches &= matches - 1;
         }
-        iterate = HashTable->Table[hashKey];
-        while (iterate->Next)
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, empty)) != 0)
         {
-            iterate = iterate->Next;
+            return -1;
         }
-        temp->Data = Value;
-        temp->Next = NULL;
-        temp->Key = Key;
-        iterate->Next = temp;
-        HashTable->Count += 1;
-
-        return 0;
+        group = (group + 2 * HT_GROUP_WIDTH) & mask;
     }
+    return -1;
 }
+#endif
 
-int HtGetKeyValue(CC_HASH_TABLE* HashTable, char* Key, int* Value)
+static int FindSlot(CC_HASH_TABLE* HashTable, CC_HASH_TABLE_SLOTS* Slots, char* Key, unsigned long long Hash, unsigned int Length)
 {
-    if (HashTable == NULL || Key == NULL)
+    if (Slots->Capacity == 0)
     {
         return -1;
     }
-    int hashResult;
-    hashResult = HashFunction(Key);
 
-    if (HashTable->Table[hashResult] == NULL)
+#ifdef CC_X86
+    if (HashTable->SimdLevel >= CC_SIMD_AVX2)
     {
-        //not in table
-        return -1;
+        return FindSlotAvx2(Slots, Key, Hash, Length);
+    }
+    if (HashTable->SimdLevel >= CC_SIMD_SSE2)
+    {
+        return FindSlotSse2(Slots, Key, Hash, Length);
+    }
+#endif
+    return FindSlotScalar(Slots, Key, Hash, Length);
+}
+
+// Puts a key that is known not to be in Slots on the first free slot of its probe,
+// the stored hash is reused so keys are never hashed again when the table grows.
+// Without ReuseDeleted only empty slots are taken, a lock-free reader may still be
+// reading the key that was deleted from a slot.
+// In insertion order mode the key is appended to the dense array, which must have
+// room for it. Deleted slots are never reused there, so Used stays the number of
+// entries taken in the dense array.
+// Returns where the key was put
+static NODEH* PlaceSlot(CC_HASH_TABLE_SLOTS* Slots, NODEH* Slot, int ReuseDeleted)
+{
+    unsigned int mask;
+    unsigned int index;
+    NODEH* placed;
+
+    if (Slots->Index != NULL)
+    {
+        ReuseDeleted = 0;
+    }
+
+    mask = (unsigned int)Slots->Capacity - 1;
+    index = (unsigned int)Slot->Hash & mask & ~(unsigned int)(HT_GROUP_WIDTH - 1);
+    while (IS_FULL_CONTROL(Slots->Control[index]) || (!ReuseDeleted && Slots->Control[index] == HT_CTRL_DELETED))
+    {
+        index = (index + 1) & mask;
+    }
+
+    if (Slots->Index != NULL)
+    {
+        placed = &Slots->Slots[Slots->Used];
+        Slots->Index[index] = (unsigned int)Slots->Used;
+        Slots->Used += 1;
     }
     else
     {
-        NODEH* iterator;
-        iterator = HashTable->Table[hashResult];
-        while (iterator)
+        if (Slots->Control[index] == HT_CTRL_EMPTY)
         {
-            if (EqualStrings(iterator->Key, Key) == 1)
-            {
-                *Value = iterator->Data;
-                return 0;
-            }
-            iterator = iterator->Next;
+            //a deleted slot is already counted in Used
+            Slots->Used += 1;
         }
-        return -1;
+        placed = &Slots->Slots[index];
     }
+    *placed = *Slot;
+    //readers that see the control byte must see the slot too
+    CcReleaseFence();
+    SetControl(Slots, index, HASH_CONTROL(Slot->Hash));
+    return placed;
 }
 
-int HtRemoveKey(CC_HASH_TABLE* HashTable, char* Key)
+#define BLOOM_BLOCK_BITS (HT_BLOOM_BLOCK_WORDS * 64)
+
+// Odd multipliers picking the bit of each word of a filter block, the ones of the
+// split block Bloom filter of Parquet
+static const unsigned int gBloomSalts[HT_BLOOM_BLOCK_WORDS] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du, 0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+};
+
+// The block comes from the high half of the remixed hash, the bits from the low half
+static unsigned long long* BloomBlock(CC_HASH_TABLE_BLOOM* Bloom, unsigned long long Mixed)
 {
-    if (HashTable == NULL || Key == NULL)
+    return Bloom->Blocks + (size_t)FastRange((unsigned int)(Mixed >> 32), (unsigned int)Bloom->BlockCount) * HT_BLOOM_BLOCK_WORDS;
+}
+
+static void BloomAdd(CC_HASH_TABLE_BLOOM* Bloom, unsigned long long Hash)
+{
+    unsigned long long mixed = FrozenMix(Hash);
+    unsigned long long* block = BloomBlock(Bloom, mixed);
+
+    for (int i = 0; i < HT_BLOOM_BLOCK_WORDS; i++)
     {
-        return -1;
+        block[i] |= 1ULL << (((unsigned int)mixed * gBloomSalts[i]) >> 26);
     }
+}
 
-    for (int i = 0; i < SIZE_OF_HASH_TABLE; i++)
-    {
-        if (HashTable->Table[i])
-        {
-            NODEH* temp;
-            NODEH* precedent;
-            temp = HashTable->Table[i];
-            precedent = NULL;
-            while (temp)
-            {
-                if (EqualStrings(temp->Key, Key) == 1)
-                {
-                    if (precedent)
-                    {
-                        precedent->Next = temp->Next;
-                        HashTable->Count -= 1;
-                        free(temp);
-                        return 0;
-                    }
-                    else if (precedent == NULL && temp->Next == NULL)
-                    {
-                        HashTable->Count -= 1;
-                        free(HashTable->Table[i]);
-                        HashTable->Table[i] = NULL;
-                        return 0;
-                    }
-                    else if (precedent == NULL && temp->Next != NULL)
-                    {
-                        temp = temp->Next;
-                        free(HashTable->Table[i]);
-                        HashTable->Table[i] = temp;
-                        HashTable->Count -= 1;
-                        return 0;
-                    }
+// Returns 0 only if no key with Hash was added to the filter
+static int BloomMayContain(CC_HASH_TABLE_BLOOM* Bloom, unsigned long long Hash)
+{
+    unsigned long long mixed = FrozenMix(Hash);
+    unsigned long long* block = BloomBlock(Bloom, mixed);
+    unsigned long long missing = 0;
 
-                }
-                precedent = temp;
-                temp = temp->Next;
-            }
-        }
+    //no early exit, the compiler turns the 8 words into a few vector operations
+    for (int i = 0; i < HT_BLOOM_BLOCK_WORDS; i++)
+    {
+        missing |= ~block[i] & (1ULL << (((unsigned int)mixed * gBloomSalts[i]) >> 26));
     }
-    return -1;
+    return missing == 0;
 }
 
-int HtHasKey(CC_HASH_TABLE* HashTable, char* Key)
+static void FreeBloom(CC_HASH_TABLE_BLOOM* Bloom)
 {
-    if (HashTable == NULL || Key == NULL)
+    CcAlignedFree(Bloom->Blocks);
+    Bloom->Blocks = NULL;
+    Bloom->BlockCount = 0;
+    Bloom->KeyLimit = 0;
+    Bloom->Added = 0;
+}
+
+// Sizes the filter for twice the keys of the table, at least ExpectedKeyCount, and adds
+// every key to it. Without memory for it the filter is dropped and lookups go to the
+// slots until the next insert builds it again.
+static void RebuildBloom(CC_HASH_TABLE* HashTable)
+{
+    CC_HASH_TABLE_BLOOM* bloom = &HashTable->Bloom;
+    CC_HASH_TABLE_SLOTS* arrays[2] = { &HashTable->Table, &HashTable->Old };
+    int keyLimit = MaxInt(bloom->ExpectedKeyCount, MaxInt(HashTable->Count * 2, HT_INITIAL_CAPACITY));
+    int blockCount = (int)(((long long)keyLimit * HT_BLOOM_BITS_PER_KEY + BLOOM_BLOCK_BITS - 1) / BLOOM_BLOCK_BITS);
+    size_t bytes = (size_t)blockCount * HT_BLOOM_BLOCK_WORDS * sizeof(unsigned long long);
+
+    if (bloom->Blocks == NULL || bloom->BlockCount != blockCount)
     {
-        return -1;
+        FreeBloom(bloom);
+        //a block per cache line
+        bloom->Blocks = (unsigned long long*)CcAlignedAlloc(bytes, 64);
+        if (bloom->Blocks == NULL)
+        {
+            return;
+        }
+        bloom->BlockCount = blockCount;
     }
+    memset(bloom->Blocks, 0, bytes);
+    bloom->KeyLimit = keyLimit;
+    bloom->Added = HashTable->Count;
 
-    for (int i = 0; i < SIZE_OF_HASH_TABLE; i++)
+    for (int a = 0; a < 2; a++)
     {
-        if (HashTable->Table[i])
+        CC_HASH_TABLE_SLOTS* slots = arrays[a];
+
+        if (slots->Index != NULL)
         {
-            NODEH* temp;
-            temp = HashTable->Table[i];
-            while (temp)
+            for (int i = 0; i < slots->Used; i++)
             {
-                if (EqualStrings(temp->Key, Key) == 1)
+                if (slots->Slots[i].KeyLength != ENTRY_REMOVED)
                 {
-                    return 1;
+                    BloomAdd(bloom, slots->Slots[i].Hash);
                 }
-                temp = temp->Next;
+            }
+            continue;
+        }
+        for (int i = 0; i < slots->Capacity; i++)
+        {
+            if (IS_FULL_CONTROL(slots->Control[i]))
+            {
+                BloomAdd(bloom, slots->Slots[i].Hash);
             }
         }
     }
-    return 0;
 }
 
-int HtGetFirstKey(CC_HASH_TABLE* HashTable, CC_HASH_TABLE_ITERATOR** Iterator, char** Key)
+// Bits set in Value
+static unsigned int PopCount64(unsigned long long Value)
 {
-    CC_HASH_TABLE_ITERATOR* iterator = NULL;
+    Value = Value - ((Value >> 1) & 0x5555555555555555ULL);
+    Value = (Value & 0x3333333333333333ULL) + ((Value >> 2) & 0x3333333333333333ULL);
+    Value = (Value + (Value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (unsigned int)((Value * 0x0101010101010101ULL) >> 56);
+}
 
-    CC_UNREFERENCED_PARAMETER(Key);
+// A missing key gets through a block when its bit is set in every word, the chance of
+// that is the product of the fractions of bits set in the words
+static double BloomFalsePositiveRate(CC_HASH_TABLE_BLOOM* Bloom)
+{
+    double total = 0;
 
-    if (NULL == HashTable)
+    for (int i = 0; i < Bloom->BlockCount; i++)
     {
-        return -1;
+        double rate = 1;
+
+        for (int j = 0; j < HT_BLOOM_BLOCK_WORDS; j++)
+        {
+            rate *= PopCount64(Bloom->Blocks[(size_t)i * HT_BLOOM_BLOCK_WORDS + j]) / 64.0;
+        }
+        total += rate;
     }
-    if (NULL == Iterator)
+    return Bloom->BlockCount == 0 ? 0 : total / Bloom->BlockCount;
+}
+
+// Moves up to MaxSlots slots of the old array into the new one
+static void MigrateSlots(CC_HASH_TABLE* HashTable, int MaxSlots)
+{
+    int end;
+
+    if (HashTable->Old.Slots == NULL)
     {
-        return -1;
+        return;
     }
-    if (NULL == Key)
+
+    //keys are moving, an iteration started before cannot go on anyway
+    HashTable->Iterating = 0;
+    end = HashTable->MigrateIndex + MaxSlots;
+    if (end > HashTable->Old.Capacity)
     {
-        return -1;
+        end = HashTable->Old.Capacity;
     }
 
-    iterator = (CC_HASH_TABLE_ITERATOR*)malloc(sizeof(CC_HASH_TABLE_ITERATOR));
-    if (NULL == iterator)
+    for (int i = HashTable->MigrateIndex; i < end && HashTable->OldCount > 0; i++)
     {
-        return -1;
+        NODEH* slot = &HashTable->Old.Slots[i];
+
+        if (!IS_FULL_CONTROL(HashTable->Old.Control[i]))
+        {
+            continue;
+        }
+
+        PlaceSlot(&HashTable->Table, slot, 1);
+        //keep the probe chains of the keys not migrated yet intact
+        SetControl(&HashTable->Old, (unsigned int)i, HT_CTRL_DELETED);
+        HashTable->OldCount -= 1;
     }
+    HashTable->MigrateIndex = end;
 
-    memset(iterator, 0, sizeof(*iterator));
+    if (HashTable->OldCount == 0)
+    {
+        FreeSlots(HashTable, &HashTable->Old);
+        HashTable->MigrateIndex = 0;
+    }
+}
 
-    iterator->HashTable = HashTable;
-    for (int i = 0; i < SIZE_OF_HASH_TABLE; i++)
+// Migration work of the calls that only look keys up. While an iteration is running they
+// leave the keys where they are, so every key is returned once.
+static void MigrateOnLookup(CC_HASH_TABLE* HashTable, int MaxSlots)
+{
+    if (!HashTable->Iterating)
     {
-        if (HashTable->Table[i])
-        {
-            iterator->Index = i;
-            iterator->Current = HashTable->Table[i];
-            *Iterator = iterator;
-            *Key = HashTable->Table[i]->Key;
-            return 0;
-        }
+        MigrateSlots(HashTable, MaxSlots);
     }
+}
 
-    *Iterator = iterator;
-    return -2;
+static void FinishMigration(CC_HASH_TABLE* HashTable)
+{
+    if (HashTable->Old.Slots != NULL)
+    {
+        MigrateSlots(HashTable, HashTable->Old.Capacity);
+    }
 }
 
-int HtGetNextKey(CC_HASH_TABLE_ITERATOR* Iterator, char** Key)
+// Moves every key into a new slot array of NewCapacity slots, dropping deleted slots.
+// When removed keys take more than half of the key arena, the live keys are copied
+// into a new one on the way. In insertion order mode the dense array is walked in
+// order, so the keys keep their order and the holes left by removed keys are packed.
+static int Rehash(CC_HASH_TABLE* HashTable, int NewCapacity)
 {
-    if (Iterator == NULL || Key == NULL)
+    CC_HASH_TABLE_SLOTS newTable;
+    CC_HASH_TABLE_SLOTS oldTable;
+    CC_ARENA newKeys;
+    CC_ARENA oldKeys;
+    int compact = HashTable->DeadKeyBytes > HashTable->Keys.Used / 2;
+    int ordered = HashTable->Table.Index != NULL;
+    int end = ordered ? HashTable->Table.Used : HashTable->Table.Capacity;
+
+    if (AllocSlots(HashTable, &newTable, NewCapacity) != 0)
     {
         return -1;
     }
-
-    if (Iterator->Current->Next)
+    //half again the keys, leaves room to grow before the dense array is reallocated
+    if (ordered && ResizeEntries(&newTable, MinInt(HashTable->Count + HashTable->Count / 2 + 1, NewCapacity / 8 * 7)) != 0)
     {
-        //next in hashtable from collision
-        Iterator->Current = Iterator->Current->Next;
-        *Key = Iterator->Current->Key;
-        return 0;
+        free(SLOTS_HEADER(newTable.Index));
+        return -1;
     }
-    else
+    ArInit(&newKeys);
+
+    for (int i = 0; i < end; i++)
     {
-        for (int i = Iterator->Index + 1; i < SIZE_OF_HASH_TABLE; i++)
+        NODEH slot = HashTable->Table.Slots[i];
+
+        if (ordered ? slot.KeyLength == ENTRY_REMOVED : !IS_FULL_CONTROL(HashTable->Table.Control[i]))
+        {
+            continue;
+        }
+
+        if (compact && slot.KeyLength >= newTable.InlineLimit
+            && ArCopyString(&newKeys, slot.Key.Pointer, slot.KeyLength, &slot.Key.Pointer) != 0)
         {
-            if (Iterator->HashTable->Table[i])
+            ArRelease(&newKeys);
+            if (ordered)
+            {
+                free(newTable.Slots);
+                free(SLOTS_HEADER(newTable.Index));
+            }
+            else
             {
-                Iterator->Current = Iterator->HashTable->Table[i];
-                Iterator->Index = i;
-                *Key = Iterator->Current->Key;
-                return 0;
+                free(SLOTS_HEADER(newTable.Slots));
             }
+            return -1;
         }
+        PlaceSlot(&newTable, &slot, 1);
     }
-    return -2;
+
+    //the old slots and keys go only after the new ones are published
+    HashTable->ResizeCount += 1;
+    oldTable = HashTable->Table;
+    SetTable(HashTable, &newTable);
+    FreeSlots(HashTable, &oldTable);
+    if (compact)
+    {
+        oldKeys = HashTable->Keys;
+        HashTable->Keys = newKeys;
+        HashTable->DeadKeyBytes = 0;
+        ReleaseKeys(HashTable, &oldKeys);
+    }
+    //drop the removed keys from the filter too
+    if (HashTable->Bloom.Blocks != NULL && HashTable->Bloom.Added > HashTable->Count)
+    {
+        RebuildBloom(HashTable);
+    }
+    return 0;
 }
 
-int HtReleaseIterator(CC_HASH_TABLE_ITERATOR** Iterator)
+// Swaps in an empty array of NewCapacity slots, the keys are moved later by MigrateSlots
+static int StartMigration(CC_HASH_TABLE* HashTable, int NewCapacity)
 {
-    if (Iterator == NULL)
+    CC_HASH_TABLE_SLOTS newTable;
+
+    if (AllocSlots(HashTable, &newTable, NewCapacity) != 0)
     {
         return -1;
     }
-    free(*Iterator);
-    *Iterator = NULL;
+
+    HashTable->ResizeCount += 1;
+    HashTable->Old = HashTable->Table;
+    HashTable->OldCount = HashTable->Count;
+    HashTable->MigrateIndex = 0;
+    HashTable->Table = newTable;
+
+    if (HashTable->OldCount == 0)
+    {
+        FreeSlots(HashTable, &HashTable->Old);
+    }
+    if (HashTable->Bloom.Blocks != NULL && HashTable->Bloom.Added > HashTable->Count)
+    {
+        RebuildBloom(HashTable);
+    }
     return 0;
 }
 
-int DestroyNodes(NODEH* Start)
+// Room for one more entry in the dense array of an insertion ordered table, it grows
+// by half so it never holds much more than the keys. Slots has room for the key, so
+// the array never needs more than 7/8 of its capacity.
+static int ReserveEntry(CC_HASH_TABLE_SLOTS* Slots)
 {
-    int result;
-    if (Start == NULL)
+    if (Slots->Used < Slots->EntryCapacity)
     {
         return 0;
     }
-    result = DestroyNodes(Start->Next);
-    free(Start);
-    Start = NULL;
-    return result;
+    return ResizeEntries(Slots, MinInt(Slots->EntryCapacity + Slots->EntryCapacity / 2 + HT_GROUP_WIDTH / 2, Slots->Capacity / 8 * 7));
 }
 
-int HtClear(CC_HASH_TABLE* HashTable)
+// Makes room for one more key, keeping occupied + deleted slots under 7/8 of the capacity
+static int ReserveSlot(CC_HASH_TABLE* HashTable)
 {
-    if (HashTable == NULL)
+    int newCapacity;
+
+    if (HashTable->Table.Capacity == 0)
     {
-        return -1;
+        if (AllocSlots(HashTable, &HashTable->Table, HT_INITIAL_CAPACITY) != 0)
+        {
+            return -1;
+        }
     }
-    HashTable->Count = 0;
-
-    for (int i = 0; i < SIZE_OF_HASH_TABLE; i++)
+    //keys still in Old will land in Table, count them too
+    else if ((HashTable->Table.Used + HashTable->OldCount + 1) * 8 > HashTable->Table.Capacity * 7)
     {
-        if (HashTable->Table[i])
+        //a migration is always done long before the next growth, this is only a safety net
+        FinishMigration(HashTable);
+
+        //mostly deleted slots: rehashing in place is enough to reclaim them
+        newCapacity = HashTable->Table.Capacity;
+        if ((HashTable->Count + 1) * 2 > HashTable->Table.Capacity)
+        {
+            newCapacity *= 2;
+        }
+
+        if (HashTable->Flags & HT_FLAG_INCREMENTAL_REHASH)
+        {
+            return StartMigration(HashTable, newCapacity);
+        }
+        if (Rehash(HashTable, newCapacity) != 0)
         {
-            int result;
-            result = DestroyNodes(HashTable->Table[i]);
-            HashTable->Table[i] = NULL;
+            return -1;
         }
     }
+
+    if (HashTable->Table.Index != NULL)
+    {
+        return ReserveEntry(&HashTable->Table);
+    }
     return 0;
 }
 
-int HtGetKeyCount(CC_HASH_TABLE* HashTable)
+// Looks Key up in both arrays, returns the index of the slot holding it or -1
+static int FindKeySlot(CC_HASH_TABLE* HashTable, char* Key, unsigned long long Hash, unsigned int Length, CC_HASH_TABLE_SLOTS** Slots)
 {
-    if (HashTable == NULL)
+    int index;
+
+    *Slots = &HashTable->Table;
+    if (HashTable->Count == 0)
+    {
+        return -1;
+    }
+    //most misses end here, on one cache line of the filter
+    if (HashTable->Bloom.Blocks != NULL && !BloomMayContain(&HashTable->Bloom, Hash))
+    {
+        return -1;
+    }
+
+    index = FindSlot(HashTable, &HashTable->Table, Key, Hash, Length);
+    if (index == -1)
+    {
+        *Slots = &HashTable->Old;
+        index = FindSlot(HashTable, &HashTable->Old, Key, Hash, Length);
+    }
+    return index;
+}
+
+// Entry of a key of the bucket with this Displacement. The bucket comes from the low
+// half of Mixed and the position from the high half, so they are independent.
+static unsigned int FrozenPosition(unsigned long long Mixed, unsigned int Displacement, unsigned int Count)
+{
+    unsigned long long step = (Mixed * 0x9E3779B97F4A7C15ULL) | 1;
+
+    return FastRange((unsigned int)((Mixed + Displacement * step) >> 32), Count);
+}
+
+// Key of a frozen entry, a loaded snapshot has offsets where the others have pointers
+static char* FrozenKey(CC_HASH_TABLE_FROZEN* Frozen, NODEH* Entry)
+{
+    unsigned long long offset;
+
+    if (Entry->KeyLength < Frozen->InlineLimit)
+    {
+        return Entry->Key.Inline;
+    }
+    if (Frozen->Strings == NULL)
+    {
+        return Entry->Key.Pointer;
+    }
+    memcpy(&offset, Entry->Key.Inline, sizeof(offset));
+    return Frozen->Strings + offset;
+}
+
+// Frees the arrays of a frozen table or unmaps its snapshot
+static void FreeFrozen(CC_HASH_TABLE_FROZEN* Frozen)
+{
+    if (Frozen->Mapping != NULL)
+    {
+        CcUnmapFile(Frozen->Mapping, Frozen->MappingSize);
+    }
+    else
+    {
+        free(Frozen->Entries);
+        free(Frozen->Displacements);
+    }
+    memset(Frozen, 0, sizeof(*Frozen));
+}
+
+// One displacement load and one key compare
+static NODEH* FindFrozenKey(CC_HASH_TABLE* HashTable, char* Key, unsigned long long Hash, unsigned int Length)
+{
+    CC_HASH_TABLE_FROZEN* frozen = &HashTable->Frozen;
+    unsigned long long mixed = FrozenMix(Hash);
+    unsigned int bucket = FastRange((unsigned int)mixed, (unsigned int)frozen->BucketCount);
+    NODEH* entry = &frozen->Entries[FrozenPosition(mixed, frozen->Displacements[bucket], (unsigned int)HashTable->Count)];
+
+    return entry->Hash == Hash && entry->KeyLength == Length && memcmp(FrozenKey(frozen, entry), Key, Length) == 0 ? entry : NULL;
+}
+
+// Same as FindKeySlot, returns the slot holding Key or NULL
+static NODEH* FindKey(CC_HASH_TABLE* HashTable, char* Key, unsigned long long Hash, unsigned int Length, CC_HASH_TABLE_SLOTS** Slots)
+{
+    int index;
+
+    if (HashTable->Flags & HT_FLAG_FROZEN)
+    {
+        *Slots = &HashTable->Table;
+        if (HashTable->Count == 0 || (HashTable->Bloom.Blocks != NULL && !BloomMayContain(&HashTable->Bloom, Hash)))
+        {
+            return NULL;
+        }
+        return FindFrozenKey(HashTable, Key, Hash, Length);
+    }
+
+    index = FindKeySlot(HashTable, Key, Hash, Length, Slots);
+
+    return index == -1 ? NULL : SLOT_AT(*Slots, index);
+}
+
+int HtCreate(CC_HASH_TABLE** HashTable)
+{
+    return HtCreateEx(HashTable, NULL);
+}
+
+int HtCreateEx(CC_HASH_TABLE** HashTable, CC_HASH_TABLE_OPTIONS* Options)
+{
+    if (HashTable == NULL)
+    {
+        return -1;
+    }
+    if (Options != NULL && (Options->InitialCapacity < 0 || Options->InitialCapacity > (1 << 30) || Options->ExpectedKeyCount < 0))
+    {
+        return -1;
+    }
+
+    CC_HASH_TABLE* hash;
+    hash = NULL;
+    hash = (CC_HASH_TABLE*)malloc(sizeof(CC_HASH_TABLE));
+
+    if (hash == NULL)
+    {
+        return -1;
+    }
+    memset(hash, 0, sizeof(*hash));
+    ArInit(&hash->Keys);
+    hash->SimdLevel = CcGetSimdLevel();
+    hash->HashRoutine = HfWyHash;
+
+    if (Options != NULL)
+    {
+        //only HtFreeze makes a table frozen
+        hash->Flags = Options->Flags & ~HT_FLAG_FROZEN;
+        if (hash->Flags & HT_FLAG_INSERTION_ORDER)
+        {
+            hash->Flags &= ~HT_FLAG_INCREMENTAL_REHASH;
+        }
+        hash->Seed = Options->Seed;
+        hash->Bloom.ExpectedKeyCount = Options->ExpectedKeyCount;
+        if (Options->HashRoutine != NULL)
+        {
+            hash->HashRoutine = Options->HashRoutine;
+        }
+
+        if (Options->InitialCapacity > 0)
+        {
+            int capacity = HT_INITIAL_CAPACITY;
+            while (capacity < Options->InitialCapacity)
+            {
+                capacity *= 2;
+            }
+            if (AllocSlots(hash, &hash->Table, capacity) != 0)
+            {
+                free(hash);
+                return -1;
+            }
+            if (hash->Table.Index != NULL && ResizeEntries(&hash->Table, capacity / 8 * 7) != 0)
+            {
+                FreeSlots(hash, &hash->Table);
+                free(hash);
+                return -1;
+            }
+        }
+    }
+
+    *HashTable = hash;
+    return 0;
+}
+
+int HtDestroy(CC_HASH_TABLE** HashTable)
+{
+    if (HashTable == NULL || *HashTable == NULL)
+    {
+        return -1;
+    }
+    FreeSlots(*HashTable, &(*HashTable)->Table);
+    FreeSlots(*HashTable, &(*HashTable)->Old);
+    FreeFrozen(&(*HashTable)->Frozen);
+    FreeBloom(&(*HashTable)->Bloom);
+    ArRelease(&(*HashTable)->Keys);
+    free(*HashTable);
+    *HashTable = NULL;
+    return 0;
+}
+
+// Returns the slot of Key whose hash and length were already computed, Key is inserted
+// with Value first if it is not in the table. Inserted receives 1 if it was.
+// Returns NULL on error or if Key is missing from a frozen table.
+static NODEH* FindOrInsertKey(CC_HASH_TABLE* HashTable, char* Key, int Value, unsigned long long Hash, unsigned int Length, int* Inserted)
+{
+    CC_HASH_TABLE_SLOTS* slots;
+    NODEH* found;
+    NODEH slot;
+
+    *Inserted = 0;
+    found = FindKey(HashTable, Key, Hash, Length, &slots);
+    if (found != NULL)
+    {
+        return found;
+    }
+    if (HashTable->Flags & HT_FLAG_FROZEN)
+    {
+        return NULL;
+    }
+
+    if (ReserveSlot(HashTable) != 0)
+    {
+        return NULL;
+    }
+
+    slot.Key.Pointer = Key;
+    if (Length < HashTable->Table.InlineLimit)
+    {
+        memcpy(slot.Key.Inline, Key, (size_t)Length + 1);
+    }
+    else if ((HashTable->Flags & HT_FLAG_OWN_KEYS) && ArCopyString(&HashTable->Keys, Key, Length, &slot.Key.Pointer) != 0)
+    {
+        return NULL;
+    }
+    slot.Data = Value;
+    slot.KeyLength = Length;
+    slot.Hash = Hash;
+    found = PlaceSlot(&HashTable->Table, &slot, HashTable->RetireRoutine == NULL);
+    HashTable->Count += 1;
+    COUNT_OPERATION(HashTable, Inserts);
+    *Inserted = 1;
+
+    if (HashTable->Flags & HT_FLAG_BLOOM_FILTER)
+    {
+        //built on the first insert, and again for more keys once it is full
+        if (HashTable->Bloom.Blocks == NULL || HashTable->Bloom.Added >= HashTable->Bloom.KeyLimit)
+        {
+            RebuildBloom(HashTable);
+        }
+        else
+        {
+            BloomAdd(&HashTable->Bloom, Hash);
+            HashTable->Bloom.Added += 1;
+        }
+    }
+    return found;
+}
+
+// Inserts Key whose hash and length were already computed, fails if Key is in the table
+static int InsertKey(CC_HASH_TABLE* HashTable, char* Key, int Value, unsigned long long Hash, unsigned int Length)
+{
+    int inserted;
+
+    return FindOrInsertKey(HashTable, Key, Value, Hash, Length, &inserted) != NULL && inserted ? 0 : -1;
+}
+
+// Prefetches the first control group and slots every array may probe for Hash
+static void PrefetchKey(CC_HASH_TABLE* HashTable, unsigned long long Hash)
+{
+    CC_HASH_TABLE_SLOTS* arrays[2] = { &HashTable->Table, &HashTable->Old };
+
+    if (HashTable->Bloom.Blocks != NULL)
+    {
+        CcPrefetch(BloomBlock(&HashTable->Bloom, FrozenMix(Hash)));
+    }
+
+    if (HashTable->Flags & HT_FLAG_FROZEN)
+    {
+        //the entry depends on the displacement, only its load can start early
+        if (HashTable->Count != 0)
+        {
+            unsigned int bucket = FastRange((unsigned int)FrozenMix(Hash), (unsigned int)HashTable->Frozen.BucketCount);
+            CcPrefetch(&HashTable->Frozen.Displacements[bucket]);
+        }
+        return;
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (arrays[i]->Capacity != 0)
+        {
+            unsigned int group = (unsigned int)Hash & (unsigned int)(arrays[i]->Capacity - 1) & ~(unsigned int)(HT_GROUP_WIDTH - 1);
+            CcPrefetch(arrays[i]->Control + group);
+            if (arrays[i]->Index != NULL)
+            {
+                CcPrefetch(arrays[i]->Index + group);
+            }
+            else
+            {
+                CcPrefetch(arrays[i]->Slots + group);
+            }
+        }
+    }
+}
+
+NODEH* HtpFindKey(CC_HASH_TABLE* HashTable, char* Key, unsigned long long Hash, unsigned int Length)
+{
+    CC_HASH_TABLE_SLOTS* slots;
+
+    return FindKey(HashTable, Key, Hash, Length, &slots);
+}
+
+NODEH* HtpFindKeyConcurrent(CC_HASH_TABLE* HashTable, char* Key, unsigned long long Hash, unsigned int Length)
+{
+    CC_HASH_TABLE_SLOTS slots;
+    int index;
+
+    //everything about the array comes from the one published pointer
+    slots.Slots = (NODEH*)CcAtomicLoadPointer((void* volatile*)&HashTable->Table.Slots);
+    if (slots.Slots == NULL)
+    {
+        return NULL;
+    }
+    slots.Capacity = SLOTS_HEADER(slots.Slots)->Capacity;
+    slots.InlineLimit = SLOTS_HEADER(slots.Slots)->InlineLimit;
+    slots.Control = (unsigned char*)(slots.Slots + slots.Capacity);
+    slots.Occupied = NULL;
+    slots.Index = NULL;
+    slots.Used = 0;
+    slots.EntryCapacity = 0;
+
+    index = FindSlot(HashTable, &slots, Key, Hash, Length);
+    return index == -1 ? NULL : &slots.Slots[index];
+}
+
+int HtpEnableConcurrentReads(CC_HASH_TABLE* HashTable, CC_RETIRE_ROUTINE RetireRoutine, void* RetireContext)
+{
+    //the dense array of insertion order mode is reallocated in place, readers could not follow it
+    if (HashTable == NULL || RetireRoutine == NULL || HashTable->Count != 0 || (HashTable->Flags & (HT_FLAG_INSERTION_ORDER | HT_FLAG_FROZEN)))
+    {
+        return -1;
+    }
+
+    //readers look in Table only, keys must never be on their way out of Old
+    HashTable->Flags &= ~HT_FLAG_INCREMENTAL_REHASH;
+    HashTable->RetireRoutine = RetireRoutine;
+    HashTable->RetireContext = RetireContext;
+    return 0;
+}
+
+int HtpSetKeyValue(CC_HASH_TABLE* HashTable, char* Key, int Value, unsigned long long Hash, unsigned int Length)
+{
+    MigrateSlots(HashTable, HT_MIGRATE_SLOTS);
+    return InsertKey(HashTable, Key, Value, Hash, Length);
+}
+
+NODEH* HtpFindOrInsertKey(CC_HASH_TABLE* HashTable, char* Key, int Value, unsigned long long Hash, unsigned int Length, int* Inserted)
+{
+    MigrateSlots(HashTable, HT_MIGRATE_SLOTS);
+    return FindOrInsertKey(HashTable, Key, Value, Hash, Length, Inserted);
+}
+
+int HtpRemoveKey(CC_HASH_TABLE* HashTable, char* Key, unsigned long long Hash, unsigned int Length)
+{
+    CC_HASH_TABLE_SLOTS* slots;
+    int index;
+
+    if (HashTable->Flags & HT_FLAG_FROZEN)
+    {
+        return -1;
+    }
+
+    MigrateSlots(HashTable, HT_MIGRATE_SLOTS);
+
+    index = FindKeySlot(HashTable, Key, Hash, Length, &slots);
+    if (index == -1)
+    {
+        return -1;
+    }
+
+    if (slots->Index != NULL)
+    {
+        //the entry stays as a hole in the dense array until the next rehash
+        slots->Slots[slots->Index[index]].KeyLength = ENTRY_REMOVED;
+    }
+    SetControl(slots, (unsigned int)index, HT_CTRL_DELETED);
+    HashTable->Count -= 1;
+    COUNT_OPERATION(HashTable, Removes);
+    if ((HashTable->Flags & HT_FLAG_OWN_KEYS) && Length >= slots->InlineLimit)
+    {
+        HashTable->DeadKeyBytes += (size_t)Length + 1;
+    }
+    if (slots == &HashTable->Old)
+    {
+        HashTable->OldCount -= 1;
+        if (HashTable->OldCount == 0)
+        {
+            FreeSlots(HashTable, &HashTable->Old);
+            HashTable->MigrateIndex = 0;
+        }
+    }
+    return 0;
+}
+
+int HtSetKeyValue(CC_HASH_TABLE* HashTable, char* Key, int Value)
+{
+    unsigned long long hash;
+    unsigned int length;
+
+    if (HashTable == NULL || Key == NULL)
+    {
+        return -1;
+    }
+
+    hash = HtpHashKey(HashTable, Key, &length);
+    return HtpSetKeyValue(HashTable, Key, Value, hash, length);
+}
+
+int HtGetKeyValue(CC_HASH_TABLE* HashTable, char* Key, int* Value)
+{
+    CC_HASH_TABLE_SLOTS* slots;
+    NODEH* slot;
+    unsigned long long hash;
+    unsigned int length;
+
+    if (HashTable == NULL || Key == NULL || Value == NULL)
+    {
+        return -1;
+    }
+
+    MigrateOnLookup(HashTable, HT_MIGRATE_SLOTS);
+
+    hash = HtpHashKey(HashTable, Key, &length);
+    slot = FindKey(HashTable, Key, hash, length, &slots);
+    if (slot == NULL)
+    {
+        //not in table
+        COUNT_OPERATION(HashTable, Misses);
+        return -1;
+    }
+
+    COUNT_OPERATION(HashTable, Hits);
+    *Value = slot->Data;
+    return 0;
+}
+
+int HtRemoveKey(CC_HASH_TABLE* HashTable, char* Key)
+{
+    unsigned long long hash;
+    unsigned int length;
+
+    if (HashTable == NULL || Key == NULL)
+    {
+        return -1;
+    }
+
+    hash = HtpHashKey(HashTable, Key, &length);
+    return HtpRemoveKey(HashTable, Key, hash, length);
+}
+
+int HtHasKey(CC_HASH_TABLE* HashTable, char* Key)
+{
+    CC_HASH_TABLE_SLOTS* slots;
+    unsigned long long hash;
+    unsigned int length;
+
+    if (HashTable == NULL || Key == NULL)
+    {
+        return -1;
+    }
+
+    hash = HtpHashKey(HashTable, Key, &length);
+    if (FindKey(HashTable, Key, hash, length, &slots) == NULL)
+    {
+        COUNT_OPERATION(HashTable, Misses);
+        return 0;
+    }
+    COUNT_OPERATION(HashTable, Hits);
+    return 1;
+}
+
+int HtGetOrInsert(CC_HASH_TABLE* HashTable, char* Key, int Value, int* Current)
+{
+    NODEH* slot;
+    unsigned long long hash;
+    unsigned int length;
+    int inserted;
+
+    if (HashTable == NULL || Key == NULL || Current == NULL)
+    {
+        return -1;
+    }
+
+    hash = HtpHashKey(HashTable, Key, &length);
+    slot = HtpFindOrInsertKey(HashTable, Key, Value, hash, length, &inserted);
+    if (slot == NULL)
+    {
+        return -1;
+    }
+    *Current = slot->Data;
+    return !inserted;
+}
+
+int HtUpsert(CC_HASH_TABLE* HashTable, char* Key, int Value)
+{
+    NODEH* slot;
+    unsigned long long hash;
+    unsigned int length;
+    int inserted;
+
+    if (HashTable == NULL || Key == NULL || (HashTable->Flags & HT_FLAG_FROZEN))
+    {
+        return -1;
+    }
+
+    hash = HtpHashKey(HashTable, Key, &length);
+    slot = HtpFindOrInsertKey(HashTable, Key, Value, hash, length, &inserted);
+    if (slot == NULL)
+    {
+        return -1;
+    }
+    slot->Data = Value;
+    return !inserted;
+}
+
+int HtIncrementBy(CC_HASH_TABLE* HashTable, char* Key, int Delta, int* NewValue)
+{
+    NODEH* slot;
+    unsigned long long hash;
+    unsigned int length;
+    int inserted;
+
+    if (HashTable == NULL || Key == NULL || (HashTable->Flags & HT_FLAG_FROZEN))
+    {
+        return -1;
+    }
+
+    hash = HtpHashKey(HashTable, Key, &length);
+    slot = HtpFindOrInsertKey(HashTable, Key, Delta, hash, length, &inserted);
+    if (slot == NULL)
+    {
+        return -1;
+    }
+    if (!inserted)
+    {
+        slot->Data += Delta;
+    }
+    if (NewValue != NULL)
+    {
+        *NewValue = slot->Data;
+    }
+    return !inserted;
+}
+
+int HtGetValuePtr(CC_HASH_TABLE* HashTable, char* Key, int** Value)
+{
+    CC_HASH_TABLE_SLOTS* slots;
+    NODEH* slot;
+    unsigned long long hash;
+    unsigned int length;
+
+    if (HashTable == NULL || Key == NULL || Value == NULL || (HashTable->Flags & HT_FLAG_FROZEN))
+    {
+        return -1;
+    }
+
+    //no migration here, the pointer would go stale right away with incremental rehash
+    hash = HtpHashKey(HashTable, Key, &length);
+    slot = FindKey(HashTable, Key, hash, length, &slots);
+    if (slot == NULL)
+    {
+        return -1;
+    }
+    *Value = &slot->Data;
+    return 0;
+}
+
+int HtCompareAndSet(CC_HASH_TABLE* HashTable, char* Key, int* Expected, int Desired)
+{
+    NODEH* slot;
+    unsigned long long hash;
+    unsigned int length;
+
+    if (HashTable == NULL || Key == NULL || Expected == NULL || (HashTable->Flags & HT_FLAG_FROZEN))
+    {
+        return -1;
+    }
+
+    hash = HtpHashKey(HashTable, Key, &length);
+    slot = HtpFindKey(HashTable, Key, hash, length);
+    if (slot == NULL)
+    {
+        return -1;
+    }
+
+    if (slot->Data != *Expected)
+    {
+        *Expected = slot->Data;
+        return 1;
+    }
+    slot->Data = Desired;
+    return 0;
+}
+
+int HtGetKeyValueMany(CC_HASH_TABLE* HashTable, char** Keys, int Count, int* Values, int* Results)
+{
+    unsigned long long hashes[HT_BATCH_SIZE];
+    unsigned int lengths[HT_BATCH_SIZE];
+    int found = 0;
+
+    if (HashTable == NULL || Keys == NULL || Values == NULL || Results == NULL || Count < 0)
+    {
+        return -1;
+    }
+
+    for (int start = 0; start < Count; start += HT_BATCH_SIZE)
+    {
+        int batch = Count - start < HT_BATCH_SIZE ? Count - start : HT_BATCH_SIZE;
+
+        //same amount of migration work as batch single-key calls
+        MigrateOnLookup(HashTable, batch * HT_MIGRATE_SLOTS);
+
+        //hash everything and start the loads first, the probes below then overlap their misses
+        for (int i = 0; i < batch; i++)
+        {
+            if (Keys[start + i] != NULL)
+            {
+                hashes[i] = HtpHashKey(HashTable, Keys[start + i], &lengths[i]);
+                PrefetchKey(HashTable, hashes[i]);
+            }
+        }
+
+        for (int i = 0; i < batch; i++)
+        {
+            CC_HASH_TABLE_SLOTS* slots;
+            NODEH* slot = NULL;
+
+            if (Keys[start + i] != NULL)
+            {
+                slot = FindKey(HashTable, Keys[start + i], hashes[i], lengths[i], &slots);
+            }
+
+            if (slot == NULL)
+            {
+                COUNT_OPERATION(HashTable, Misses);
+                Results[start + i] = -1;
+            }
+            else
+            {
+                COUNT_OPERATION(HashTable, Hits);
+                Values[start + i] = slot->Data;
+                Results[start + i] = 0;
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+int HtSetKeyValueMany(CC_HASH_TABLE* HashTable, char** Keys, int* Values, int Count, int* Results)
+{
+    unsigned long long hashes[HT_BATCH_SIZE];
+    unsigned int lengths[HT_BATCH_SIZE];
+    int inserted = 0;
+
+    if (HashTable == NULL || Keys == NULL || Values == NULL || Results == NULL || Count < 0)
+    {
+        return -1;
+    }
+
+    for (int start = 0; start < Count; start += HT_BATCH_SIZE)
+    {
+        int batch = Count - start < HT_BATCH_SIZE ? Count - start : HT_BATCH_SIZE;
+
+        MigrateSlots(HashTable, batch * HT_MIGRATE_SLOTS);
+
+        for (int i = 0; i < batch; i++)
+        {
+            if (Keys[start + i] != NULL)
+            {
+                hashes[i] = HtpHashKey(HashTable, Keys[start + i], &lengths[i]);
+                PrefetchKey(HashTable, hashes[i]);
+            }
+        }
+
+        //keys go in one by one, so duplicates inside a batch fail like they do with HtSetKeyValue
+        for (int i = 0; i < batch; i++)
+        {
+            if (Keys[start + i] == NULL)
+            {
+                Results[start + i] = -1;
+                continue;
+            }
+
+            Results[start + i] = InsertKey(HashTable, Keys[start + i], Values[start + i], hashes[i], lengths[i]);
+            if (Results[start + i] == 0)
+            {
+                inserted++;
+            }
+        }
+    }
+    return inserted;
+}
+
+// Index of the first occupied slot at or after From, -1 if there is none.
+// The bitmap gives 64 slots per word, empty stretches are skipped a word at a time.
+static int NextOccupiedSlot(CC_HASH_TABLE_SLOTS* Slots, int From)
+{
+    int wordCount = (Slots->Capacity + 63) / 64;
+    int word = From / 64;
+    unsigned long long bits;
+
+    if (From >= Slots->Capacity)
+    {
+        return -1;
+    }
+
+    bits = Slots->Occupied[word] & (~0ULL << (From % 64));
+    while (bits == 0)
+    {
+        word++;
+        if (word >= wordCount)
+        {
+            return -1;
+        }
+        bits = Slots->Occupied[word];
+    }
+    return word * 64 + (int)CcCountTrailingZeros64(bits);
+}
+
+int HtGetFirstKey(CC_HASH_TABLE* HashTable, CC_HASH_TABLE_ITERATOR** Iterator, char** Key)
+{
+    CC_HASH_TABLE_ITERATOR* iterator = NULL;
+
+    if (NULL == HashTable)
+    {
+        return -1;
+    }
+    if (NULL == Iterator)
+    {
+        return -1;
+    }
+    if (NULL == Key)
+    {
+        return -1;
+    }
+
+    iterator = (CC_HASH_TABLE_ITERATOR*)malloc(sizeof(CC_HASH_TABLE_ITERATOR));
+    if (NULL == iterator)
+    {
+        return -1;
+    }
+
+    *Iterator = iterator;
+    return HtInitIterator(HashTable, iterator, Key);
+}
+
+int HtInitIterator(CC_HASH_TABLE* HashTable, CC_HASH_TABLE_ITERATOR* Iterator, char** Key)
+{
+    if (NULL == HashTable || NULL == Iterator || NULL == Key)
+    {
+        return -1;
+    }
+
+    memset(Iterator, 0, sizeof(*Iterator));
+
+    //the keys left in Old are walked where they are, see MigrateOnLookup
+    HashTable->Iterating = HashTable->Old.Slots != NULL;
+
+    Iterator->HashTable = HashTable;
+    Iterator->Index = -1;
+
+    return HtGetNextKey(Iterator, Key);
+}
+
+int HtGetNextKey(CC_HASH_TABLE_ITERATOR* Iterator, char** Key)
+{
+    CC_HASH_TABLE* hashTable;
+    CC_HASH_TABLE_SLOTS* slots;
+    int from;
+    int index = -1;
+
+    if (Iterator == NULL || Key == NULL || Iterator->HashTable == NULL)
+    {
+        return -1;
+    }
+
+    hashTable = Iterator->HashTable;
+    from = Iterator->Index + 1;
+
+    if (hashTable->Flags & HT_FLAG_FROZEN)
+    {
+        //the entries are packed, every one of them holds a key
+        if (from < hashTable->Count)
+        {
+            Iterator->Index = from;
+            Iterator->Current = &hashTable->Frozen.Entries[from];
+            *Key = FrozenKey(&hashTable->Frozen, Iterator->Current);
+            return 0;
+        }
+        Iterator->Index = hashTable->Count;
+        Iterator->Current = NULL;
+        return -2;
+    }
+
+    if (hashTable->Table.Index != NULL)
+    {
+        //insertion order mode, the dense array only has holes where keys were removed
+        slots = &hashTable->Table;
+        while (from < slots->Used && slots->Slots[from].KeyLength == ENTRY_REMOVED)
+        {
+            from++;
+        }
+        if (from < slots->Used)
+        {
+            Iterator->Index = from;
+            Iterator->Current = &slots->Slots[from];
+            *Key = SLOT_KEY(slots, Iterator->Current);
+            return 0;
+        }
+        Iterator->Index = slots->Used;
+        Iterator->Current = NULL;
+        return -2;
+    }
+
+    //indexes go over Table first and then over Old
+    slots = &hashTable->Table;
+    if (from < hashTable->Table.Capacity)
+    {
+        index = NextOccupiedSlot(slots, from);
+    }
+    if (index == -1 && hashTable->Old.Slots != NULL)
+    {
+        //the slots below the migration cursor were moved to Table already
+        slots = &hashTable->Old;
+        from = from > hashTable->Table.Capacity ? from - hashTable->Table.Capacity : 0;
+        index = NextOccupiedSlot(slots, MaxInt(from, hashTable->MigrateIndex));
+    }
+
+    if (index != -1)
+    {
+        Iterator->Index = index + (slots == &hashTable->Old ? hashTable->Table.Capacity : 0);
+        Iterator->Current = &slots->Slots[index];
+        *Key = SLOT_KEY(slots, Iterator->Current);
+        return 0;
+    }
+
+    Iterator->Index = hashTable->Table.Capacity + hashTable->Old.Capacity;
+    Iterator->Current = NULL;
+    hashTable->Iterating = 0;
+    return -2;
+}
+
+int HtReleaseIterator(CC_HASH_TABLE_ITERATOR** Iterator)
+{
+    if (Iterator == NULL)
+    {
+        return -1;
+    }
+    if (*Iterator != NULL && (*Iterator)->HashTable != NULL)
+    {
+        (*Iterator)->HashTable->Iterating = 0;
+    }
+    free(*Iterator);
+    *Iterator = NULL;
+    return 0;
+}
+
+// Finds a displacement for every bucket, biggest buckets first while most entries are
+// still free. Keys are grouped by bucket in Order, bucket b has the keys from
+// Order[Starts[b]] to Order[Starts[b + 1]]. Positions receives the entry of every key.
+// Returns -1 if a bucket has two keys with the same hash, no displacement separates them.
+static int PlaceBuckets(NODEH* Keys, int Count, int* Order, int* Starts, int BucketCount, unsigned int* Displacements, unsigned int* Positions)
+{
+    unsigned long long* taken = NULL;
+    int* buckets = NULL;
+    int* sizeStarts = NULL;
+    int maxSize = 0;
+    int retVal = -1;
+
+    for (int b = 0; b < BucketCount; b++)
+    {
+        maxSize = MaxInt(maxSize, Starts[b + 1] - Starts[b]);
+    }
+
+    taken = (unsigned long long*)calloc(((size_t)Count + 63) / 64, sizeof(unsigned long long));
+    buckets = (int*)malloc(sizeof(int) * (size_t)BucketCount);
+    sizeStarts = (int*)calloc((size_t)maxSize + 2, sizeof(int));
+    if (taken == NULL || buckets == NULL || sizeStarts == NULL)
+    {
+        goto cleanup;
+    }
+
+    //counting sort of the buckets by size, biggest first
+    for (int b = 0; b < BucketCount; b++)
+    {
+        sizeStarts[maxSize - (Starts[b + 1] - Starts[b]) + 1]++;
+    }
+    for (int size = 1; size <= maxSize + 1; size++)
+    {
+        sizeStarts[size] += sizeStarts[size - 1];
+    }
+    for (int b = 0; b < BucketCount; b++)
+    {
+        buckets[sizeStarts[maxSize - (Starts[b + 1] - Starts[b])]++] = b;
+    }
+
+    for (int i = 0; i < BucketCount; i++)
+    {
+        int b = buckets[i];
+        int first = Starts[b];
+        int size = Starts[b + 1] - first;
+        unsigned int displacement = 0;
+
+        if (size == 0)
+        {
+            //sorted last, the remaining buckets are empty too
+            Displacements[b] = 0;
+            continue;
+        }
+        for (int j = first + 1; j < first + size; j++)
+        {
+            for (int k = first; k < j; k++)
+            {
+                if (Keys[Order[j]].Hash == Keys[Order[k]].Hash)
+                {
+                    goto cleanup;
+                }
+            }
+        }
+
+        for (;;)
+        {
+            int placed = 0;
+
+            //keys of the bucket are marked as they go, a clash undoes the marks
+            while (placed < size)
+            {
+                unsigned long long mixed = FrozenMix(Keys[Order[first + placed]].Hash);
+                unsigned int position = FrozenPosition(mixed, displacement, (unsigned int)Count);
+
+                if (taken[position / 64] & (1ULL << (position % 64)))
+                {
+                    break;
+                }
+                taken[position / 64] |= 1ULL << (position % 64);
+                Positions[first + placed] = position;
+                placed++;
+            }
+            if (placed == size)
+            {
+                break;
+            }
+            while (placed > 0)
+            {
+                placed--;
+                taken[Positions[first + placed] / 64] &= ~(1ULL << (Positions[first + placed] % 64));
+            }
+
+            displacement++;
+            if (displacement == 0)
+            {
+                goto cleanup;
+            }
+        }
+        Displacements[b] = displacement;
+    }
+    retVal = 0;
+
+cleanup:
+    free(taken);
+    free(buckets);
+    free(sizeStarts);
+    return retVal;
+}
+
+// Builds the frozen form of HashTable in Frozen, HashTable keeps its slots
+static int BuildFrozen(CC_HASH_TABLE* HashTable, CC_HASH_TABLE_FROZEN* Frozen)
+{
+    CC_HASH_TABLE_ITERATOR iterator;
+    NODEH* keys = NULL;
+    NODEH* entries = NULL;
+    unsigned int* displacements = NULL;
+    unsigned int* positions = NULL;
+    int* order = NULL;
+    int* starts = NULL;
+    int bucketCount;
+    int count;
+    char* key;
+    int retVal = -1;
+
+    count = HashTable->Count;
+    bucketCount = count / HT_FREEZE_BUCKET_SIZE + 1;
+    keys = (NODEH*)malloc(sizeof(NODEH) * (size_t)MaxInt(count, 1));
+    entries = (NODEH*)malloc(sizeof(NODEH) * (size_t)MaxInt(count, 1));
+    positions = (unsigned int*)malloc(sizeof(unsigned int) * (size_t)MaxInt(count, 1));
+    order = (int*)malloc(sizeof(int) * (size_t)MaxInt(count, 1));
+    displacements = (unsigned int*)malloc(sizeof(unsigned int) * (size_t)bucketCount);
+    starts = (int*)calloc((size_t)bucketCount + 1, sizeof(int));
+    if (keys == NULL || entries == NULL || positions == NULL || order == NULL || displacements == NULL || starts == NULL)
+    {
+        goto cleanup;
+    }
+
+    //the entries keep the key storage of the slots, inline copies or arena pointers
+    count = 0;
+    for (int status = HtInitIterator(HashTable, &iterator, &key); status == 0; status = HtGetNextKey(&iterator, &key))
+    {
+        keys[count++] = *iterator.Current;
+    }
+
+    //group the keys by bucket
+    for (int i = 0; i < count; i++)
+    {
+        starts[FastRange((unsigned int)FrozenMix(keys[i].Hash), (unsigned int)bucketCount) + 1]++;
+    }
+    for (int b = 0; b < bucketCount; b++)
+    {
+        starts[b + 1] += starts[b];
+    }
+    for (int i = 0; i < count; i++)
+    {
+        order[starts[FastRange((unsigned int)FrozenMix(keys[i].Hash), (unsigned int)bucketCount)]++] = i;
+    }
+    for (int b = bucketCount; b > 0; b--)
+    {
+        starts[b] = starts[b - 1];
+    }
+    starts[0] = 0;
+
+    if (PlaceBuckets(keys, count, order, starts, bucketCount, displacements, positions) != 0)
+    {
+        goto cleanup;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        entries[positions[i]] = keys[order[i]];
+    }
+
+    memset(Frozen, 0, sizeof(*Frozen));
+    Frozen->Entries = entries;
+    Frozen->Displacements = displacements;
+    Frozen->BucketCount = bucketCount;
+    Frozen->InlineLimit = HashTable->Table.InlineLimit;
+    entries = NULL;
+    displacements = NULL;
+    retVal = 0;
+
+cleanup:
+    free(keys);
+    free(entries);
+    free(positions);
+    free(order);
+    free(displacements);
+    free(starts);
+    return retVal;
+}
+
+int HtFreeze(CC_HASH_TABLE* HashTable)
+{
+    CC_HASH_TABLE_FROZEN frozen;
+
+    if (HashTable == NULL || HashTable->RetireRoutine != NULL)
+    {
+        return -1;
+    }
+    if (HashTable->Flags & HT_FLAG_FROZEN)
+    {
+        return 0;
+    }
+
+    if (BuildFrozen(HashTable, &frozen) != 0)
+    {
+        return -1;
+    }
+
+    //the key arena stays, the entries point into it
+    FreeSlots(HashTable, &HashTable->Table);
+    FreeSlots(HashTable, &HashTable->Old);
+    HashTable->OldCount = 0;
+    HashTable->MigrateIndex = 0;
+    HashTable->Iterating = 0;
+    HashTable->Frozen = frozen;
+    HashTable->Flags |= HT_FLAG_FROZEN;
+    return 0;
+}
+
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+
+// Snapshot file layout, every offset is from the start of the file:
+//  SNAPSHOT_HEADER
+//  BucketCount unsigned int displacements
+//  Count NODEH entries, 8 byte aligned
+//  key section, the keys longer than HT_INLINE_KEY_LENGTH with their terminators
+// An entry with a long key holds its offset in the key section in the first 8 bytes
+// of Key.Inline. NODEH is 32 bytes in 32 and 64-bit builds, they read the same files.
+typedef struct _SNAPSHOT_HEADER {
+    char Magic[8];                  //SNAPSHOT_MAGIC, no terminator
+    unsigned int Version;           //HT_SNAPSHOT_VERSION
+    unsigned int ByteOrder;         //SNAPSHOT_BYTE_ORDER as the writer stored it
+    unsigned long long FileSize;
+    unsigned long long Checksum;    //HfXxHash64 of everything after the header
+    unsigned long long Seed;
+    unsigned int HashId;            //index of the hash function in gSnapshotHashes
+    int Count;
+    int BucketCount;
+    unsigned int Reserved;
+    unsigned long long DisplacementsOffset;
+    unsigned long long EntriesOffset;
+    unsigned long long StringsOffset;
+} SNAPSHOT_HEADER;
+
+static const char gSnapshotMagic[8] = { 'C', 'C', 'H', 'T', 'S', 'N', 'A', 'P' };
+
+// A file stores the index of its hash function, never change the order
+static const CC_HASH_FUNCTION gSnapshotHashes[] = { HfWyHash, HfXxHash64, HfSipHash, HfDjb2 };
+
+#define SNAPSHOT_ALIGN(Offset) (((Offset) + 7) & ~7ULL)
+
+static int WriteFile(const char* Path, const char* Data, size_t Size)
+{
+    FILE* file;
+    int retVal = 0;
+
+#ifdef _MSC_VER
+    if (0 != fopen_s(&file, Path, "wb"))
+    {
+        return -1;
+    }
+#else
+    file = fopen(Path, "wb");
+    if (file == NULL)
+    {
+        return -1;
+    }
+#endif
+    if (fwrite(Data, 1, Size, file) != Size)
+    {
+        retVal = -1;
+    }
+    if (fclose(file) != 0)
+    {
+        retVal = -1;
+    }
+    return retVal;
+}
+
+int HtSaveSnapshot(CC_HASH_TABLE* HashTable, const char* Path)
+{
+    CC_HASH_TABLE_FROZEN built;
+    CC_HASH_TABLE_FROZEN* frozen;
+    SNAPSHOT_HEADER header;
+    unsigned int hashId = 0;
+    unsigned long long stringsSize = 0;
+    char* image = NULL;
+    NODEH* entries;
+    char* strings;
+    int retVal = -1;
+
+    if (HashTable == NULL || Path == NULL)
+    {
+        return -1;
+    }
+    while (hashId < sizeof(gSnapshotHashes) / sizeof(gSnapshotHashes[0]) && gSnapshotHashes[hashId] != HashTable->HashRoutine)
+    {
+        hashId++;
+    }
+    if (hashId == sizeof(gSnapshotHashes) / sizeof(gSnapshotHashes[0]))
+    {
+        return -1;
+    }
+
+    memset(&built, 0, sizeof(built));
+    frozen = &HashTable->Frozen;
+    if (!(HashTable->Flags & HT_FLAG_FROZEN))
+    {
+        if (BuildFrozen(HashTable, &built) != 0)
+        {
+            return -1;
+        }
+        frozen = &built;
+    }
+
+    for (int i = 0; i < HashTable->Count; i++)
+    {
+        if (frozen->Entries[i].KeyLength > HT_INLINE_KEY_LENGTH)
+        {
+            stringsSize += (unsigned long long)frozen->Entries[i].KeyLength + 1;
+        }
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.Magic, gSnapshotMagic, sizeof(header.Magic));
+    header.Version = HT_SNAPSHOT_VERSION;
+    header.ByteOrder = SNAPSHOT_BYTE_ORDER;
+    header.Seed = HashTable->Seed;
+    header.HashId = hashId;
+    header.Count = HashTable->Count;
+    header.BucketCount = frozen->BucketCount;
+    header.DisplacementsOffset = SNAPSHOT_ALIGN(sizeof(SNAPSHOT_HEADER));
+    header.EntriesOffset = SNAPSHOT_ALIGN(header.DisplacementsOffset + sizeof(unsigned int) * (unsigned long long)header.BucketCount);
+    header.StringsOffset = header.EntriesOffset + sizeof(NODEH) * (unsigned long long)header.Count;
+    header.FileSize = header.StringsOffset + stringsSize;
+    if (header.FileSize > (size_t)-1)
+    {
+        goto cleanup;
+    }
+
+    //the whole file is built in memory, the checksum needs all of it anyway
+    image = (char*)calloc(1, (size_t)header.FileSize);
+    if (image == NULL)
+    {
+        goto cleanup;
+    }
+    memcpy(image + header.DisplacementsOffset, frozen->Displacements, sizeof(unsigned int) * (size_t)header.BucketCount);
+    entries = (NODEH*)(image + header.EntriesOffset);
+    strings = image + header.StringsOffset;
+    stringsSize = 0;
+    for (int i = 0; i < HashTable->Count; i++)
+    {
+        NODEH* entry = &frozen->Entries[i];
+        char* key = FrozenKey(frozen, entry);
+
+        //the image is zeroed, unused inline bytes stay 0 so equal tables give equal files
+        if (entry->KeyLength <= HT_INLINE_KEY_LENGTH)
+        {
+            memcpy(entries[i].Key.Inline, key, entry->KeyLength);
+        }
+        else
+        {
+            memcpy(entries[i].Key.Inline, &stringsSize, sizeof(stringsSize));
+            memcpy(strings + stringsSize, key, entry->KeyLength);
+            stringsSize += (unsigned long long)entry->KeyLength + 1;
+        }
+        entries[i].Data = entry->Data;
+        entries[i].KeyLength = entry->KeyLength;
+        entries[i].Hash = entry->Hash;
+    }
+
+    header.Checksum = HfXxHash64(image + sizeof(SNAPSHOT_HEADER), (size_t)header.FileSize - sizeof(SNAPSHOT_HEADER), 0);
+    memcpy(image, &header, sizeof(header));
+    retVal = WriteFile(Path, image, (size_t)header.FileSize);
+
+cleanup:
+    free(image);
+    free(built.Entries);
+    free(built.Displacements);
+    return retVal;
+}
+
+// Everything a lookup relies on must be inside the file
+static int CheckSnapshotHeader(const SNAPSHOT_HEADER* Header, size_t Size)
+{
+    if (memcmp(Header->Magic, gSnapshotMagic, sizeof(Header->Magic)) != 0
+        || Header->Version != HT_SNAPSHOT_VERSION
+        || Header->ByteOrder != SNAPSHOT_BYTE_ORDER
+        || Header->FileSize != Size
+        || Header->HashId >= sizeof(gSnapshotHashes) / sizeof(gSnapshotHashes[0])
+        || Header->Count < 0 || Header->Count > (1 << 30)
+        || Header->BucketCount <= 0 || Header->BucketCount > Header->Count / HT_FREEZE_BUCKET_SIZE + 1)
+    {
+        return -1;
+    }
+    if (Header->DisplacementsOffset < sizeof(SNAPSHOT_HEADER)
+        || Header->EntriesOffset % 8 != 0
+        || Header->EntriesOffset < Header->DisplacementsOffset + sizeof(unsigned int) * (unsigned long long)Header->BucketCount
+        || Header->StringsOffset != Header->EntriesOffset + sizeof(NODEH) * (unsigned long long)Header->Count
+        || Header->StringsOffset > Size)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+// Every key an entry points to must be inside the key section and end with its
+// terminator, the checksum is optional but reading past the mapping is not
+static int CheckSnapshotEntries(const SNAPSHOT_HEADER* Header, const char* Mapping, size_t Size)
+{
+    const NODEH* entries = (const NODEH*)(Mapping + Header->EntriesOffset);
+    const char* strings = Mapping + Header->StringsOffset;
+    unsigned long long stringsSize = Size - Header->StringsOffset;
+
+    for (int i = 0; i < Header->Count; i++)
+    {
+        unsigned long long length = entries[i].KeyLength;
+        unsigned long long offset;
+
+        if (length <= HT_INLINE_KEY_LENGTH)
+        {
+            if (entries[i].Key.Inline[length] != '\0')
+            {
+                return -1;
+            }
+            continue;
+        }
+        memcpy(&offset, entries[i].Key.Inline, sizeof(offset));
+        if (offset > stringsSize || length + 1 > stringsSize - offset || strings[offset + length] != '\0')
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int HtLoadSnapshot(CC_HASH_TABLE** HashTable, const char* Path, int Flags)
+{
+    CC_HASH_TABLE_OPTIONS options;
+    SNAPSHOT_HEADER header;
+    CC_HASH_TABLE* table = NULL;
+    void* mapping;
+    size_t size;
+
+    if (HashTable == NULL || Path == NULL || sizeof(NODEH) != 32)
+    {
+        return -1;
+    }
+    if (CcMapFile(Path, &mapping, &size) != 0)
+    {
+        return -1;
+    }
+
+    if (size < sizeof(SNAPSHOT_HEADER))
+    {
+        goto error;
+    }
+    memcpy(&header, mapping, sizeof(header));
+    if (CheckSnapshotHeader(&header, size) != 0 || CheckSnapshotEntries(&header, (char*)mapping, size) != 0)
+    {
+        goto error;
+    }
+    if ((Flags & HT_SNAPSHOT_VERIFY)
+        && header.Checksum != HfXxHash64((char*)mapping + sizeof(SNAPSHOT_HEADER), size - sizeof(SNAPSHOT_HEADER), 0))
+    {
+        goto error;
+    }
+
+    memset(&options, 0, sizeof(options));
+    options.HashRoutine = gSnapshotHashes[header.HashId];
+    options.Seed = header.Seed;
+    if (HtCreateEx(&table, &options) != 0)
+    {
+        goto error;
+    }
+
+    //nothing is copied, the table reads the mapping
+    table->Frozen.Displacements = (unsigned int*)((char*)mapping + header.DisplacementsOffset);
+    table->Frozen.Entries = (NODEH*)((char*)mapping + header.EntriesOffset);
+    table->Frozen.Strings = (char*)mapping + header.StringsOffset;
+    table->Frozen.BucketCount = header.BucketCount;
+    table->Frozen.InlineLimit = HT_INLINE_KEY_LENGTH + 1;
+    table->Frozen.Mapping = mapping;
+    table->Frozen.MappingSize = size;
+    table->Count = header.Count;
+    table->Flags |= HT_FLAG_FROZEN;
+    *HashTable = table;
+    return 0;
+
+error:
+    CcUnmapFile(mapping, size);
+    return -1;
+}
+
+int HtClear(CC_HASH_TABLE* HashTable)
+{
+    if (HashTable == NULL)
+    {
+        return -1;
+    }
+
+    //give the slot arrays and the key chunks back, an empty table does not keep any memory
+    FreeSlots(HashTable, &HashTable->Table);
+    FreeSlots(HashTable, &HashTable->Old);
+    FreeFrozen(&HashTable->Frozen);
+    HashTable->Flags &= ~HT_FLAG_FROZEN;
+    FreeBloom(&HashTable->Bloom);
+    ReleaseKeys(HashTable, &HashTable->Keys);
+    HashTable->DeadKeyBytes = 0;
+    HashTable->OldCount = 0;
+    HashTable->MigrateIndex = 0;
+    HashTable->Iterating = 0;
+    HashTable->Count = 0;
+    return 0;
+}
+
+int HtGetKeyCount(CC_HASH_TABLE* HashTable)
+{
+    if (HashTable == NULL)
     {
         return -1;
     }
     return HashTable->Count;
 }
+
+// Adds the bytes, deleted slots and probe distances of one slot array to Stats
+static void AddSlotStats(CC_HASH_TABLE_SLOTS* Slots, CC_HASH_TABLE_STATS* Stats)
+{
+    unsigned int mask = (unsigned int)Slots->Capacity - 1;
+
+    if (Slots->Capacity == 0)
+    {
+        return;
+    }
+
+    //same layout as AllocSlots
+    Stats->Capacity += Slots->Capacity;
+    Stats->SlotBytes += SLOTS_HEADER_SIZE + (size_t)Slots->Capacity + HT_GROUP_WIDTH
+        + sizeof(unsigned long long) * (((size_t)Slots->Capacity + 63) / 64);
+    if (Slots->Index != NULL)
+    {
+        Stats->SlotBytes += (sizeof(unsigned int) * (size_t)Slots->Capacity + 15) & ~(size_t)15;
+        Stats->NodeBytes += sizeof(NODEH) * (size_t)Slots->EntryCapacity;
+    }
+    else
+    {
+        Stats->SlotBytes += sizeof(NODEH) * (size_t)Slots->Capacity;
+    }
+
+    for (unsigned int i = 0; i < (unsigned int)Slots->Capacity; i++)
+    {
+        unsigned int home;
+        int distance;
+
+        if (Slots->Control[i] == HT_CTRL_DELETED)
+        {
+            Stats->Tombstones += 1;
+        }
+        if (!IS_FULL_CONTROL(Slots->Control[i]))
+        {
+            continue;
+        }
+
+        //probes go one group at a time from the group the hash picks
+        home = (unsigned int)SLOT_AT(Slots, i)->Hash & mask & ~(unsigned int)(HT_GROUP_WIDTH - 1);
+        distance = (int)(((i & ~(unsigned int)(HT_GROUP_WIDTH - 1)) - home) & mask) / HT_GROUP_WIDTH;
+        Stats->MaxProbeDistance = MaxInt(Stats->MaxProbeDistance, distance);
+        Stats->ProbeHistogram[MinInt(distance, HT_STATS_PROBE_BUCKETS - 1)] += 1;
+    }
+}
+
+int HtGetStats(CC_HASH_TABLE* HashTable, CC_HASH_TABLE_STATS* Stats)
+{
+    if (HashTable == NULL || Stats == NULL)
+    {
+        return -1;
+    }
+
+    memset(Stats, 0, sizeof(*Stats));
+    Stats->Count = HashTable->Count;
+    Stats->ResizeCount = HashTable->ResizeCount;
+    Stats->KeyBytes = HashTable->Keys.Reserved;
+    Stats->Counters = HashTable->Counters;
+
+    if (HashTable->Flags & HT_FLAG_FROZEN)
+    {
+        //every key is found on the first entry looked at
+        Stats->Capacity = HashTable->Count;
+        Stats->ProbeHistogram[0] = HashTable->Count;
+        Stats->NodeBytes = HashTable->Frozen.Mapping != NULL ? HashTable->Frozen.MappingSize
+            : sizeof(NODEH) * (size_t)HashTable->Count + sizeof(unsigned int) * (size_t)HashTable->Frozen.BucketCount;
+    }
+    else
+    {
+        AddSlotStats(&HashTable->Table, Stats);
+        AddSlotStats(&HashTable->Old, Stats);
+    }
+    Stats->LoadFactor = Stats->Capacity == 0 ? 0 : (double)Stats->Count / Stats->Capacity;
+
+    if (HashTable->Bloom.Blocks != NULL)
+    {
+        Stats->FilterBytes = (size_t)HashTable->Bloom.BlockCount * HT_BLOOM_BLOCK_WORDS * sizeof(unsigned long long);
+        Stats->FilterBitsPerKey = HashTable->Count == 0 ? 0 : (double)HashTable->Bloom.BlockCount * BLOOM_BLOCK_BITS / HashTable->Count;
+        Stats->FilterFalsePositiveRate = BloomFalsePositiveRate(&HashTable->Bloom);
+    }
+    return 0;
+}
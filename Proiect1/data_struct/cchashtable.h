@@ -1,22 +1,190 @@
 #pragma once
 #include "common.h"
+#include "cchashfunc.h"
+#include "ccarena.h"
 
-#define SIZE_OF_HASH_TABLE 4096
+// Open addressing table in the style of a Swiss table. Every slot has a control
+// byte holding either HT_CTRL_EMPTY, HT_CTRL_DELETED or the top 7 bits of the key
+// hash. Lookups compare a whole group of HT_GROUP_WIDTH control bytes at once
+// (SSE2, or two groups with AVX2, picked at runtime) and only compare keys whose
+// control byte matches. Capacity is always a power of two and the slot array is
+// only allocated on the first insert, then doubled whenever occupied + deleted
+// slots go over 7/8 of it.
+#define HT_INITIAL_CAPACITY 16
+#define HT_GROUP_WIDTH      16
+
+#define HT_CTRL_EMPTY       0x80
+#define HT_CTRL_DELETED     0xFE
+
+// With HT_FLAG_INCREMENTAL_REHASH the table does not move every key at once when it
+// grows. The old slot array is kept next to the new one and every HtSetKeyValue,
+// HtGetKeyValue and HtRemoveKey moves at most HT_MIGRATE_SLOTS slots out of it.
+// The iterators walk both arrays, and the lookups made before the iteration ends
+// move nothing, so a walk neither moves keys nor returns one twice.
+#define HT_FLAG_INCREMENTAL_REHASH  0x1
+#define HT_MIGRATE_SLOTS            8
+
+// With HT_FLAG_OWN_KEYS the table keeps its own copy of every key, the caller's string
+// can be freed right after HtSetKeyValue. Keys of up to HT_INLINE_KEY_LENGTH chars are
+// copied into the slot itself, longer ones are packed in a CC_ARENA that HtClear and
+// HtDestroy free chunk by chunk. Bytes of removed keys are reclaimed when the table is
+// rehashed (not in incremental mode) or cleared.
+// Keys returned by the iterator point into the table and stay valid until it is modified.
+#define HT_FLAG_OWN_KEYS            0x2
+#define HT_INLINE_KEY_LENGTH        15
+
+// With HT_FLAG_INSERTION_ORDER the keys are kept in a dense array in the order they
+// were inserted and the slot array only holds the index of each key in it, 4 bytes
+// per slot instead of a whole NODEH. Iteration walks the dense array, so it returns
+// the keys in insertion order and never touches an empty slot. A removed key leaves
+// a hole in the dense array until the next rehash packs it. Incremental rehash is not
+// available in this mode, HT_FLAG_INCREMENTAL_REHASH is ignored.
+#define HT_FLAG_INSERTION_ORDER     0x4
+
+// Set by HtFreeze, the table is then a minimal perfect hash table (CHD without the
+// compression step). The keys are packed in an array of exactly Count entries and
+// every bucket of about HT_FREEZE_BUCKET_SIZE keys has a displacement that sends each
+// of its keys to a different entry. A lookup hashes the key, reads the displacement
+// of its bucket and compares the one entry it points to, there is no probing at all.
+#define HT_FLAG_FROZEN              0x8
+#define HT_FREEZE_BUCKET_SIZE       4
+
+// HtSaveSnapshot writes the frozen form of a table to a file that HtLoadSnapshot maps
+// and queries in place, loading only checks each entry once and copies nothing. The file
+// holds a header, the displacements, the entries and the long keys packed one after
+// the other. Entries keep keys of up to HT_INLINE_KEY_LENGTH chars inline and the
+// offset of the others in the key section instead of a pointer. Files are in the byte
+// order of the machine that wrote them, loading one from the other byte order fails.
+#define HT_SNAPSHOT_VERSION         1
+
+// HtLoadSnapshot flag: check the checksum of the whole file, which reads all of it.
+// Without it the header and the key bounds of every entry are still checked, so a
+// damaged file cannot make lookups read past the mapping, but it can give wrong values.
+#define HT_SNAPSHOT_VERIFY          0x1
+
+// With HT_FLAG_BLOOM_FILTER a blocked Bloom filter sits in front of the slots, so
+// looking up a missing key usually reads one cache line of the filter and never
+// touches the table. Every key sets one bit in each of the HT_BLOOM_BLOCK_WORDS words
+// of a single 64 byte block. The filter gets HT_BLOOM_BITS_PER_KEY bits for each of
+// the ExpectedKeyCount keys of the options, about 1% false positives when full. When
+// more keys than that were added to it, or the table is rehashed after removals, it is
+// rebuilt from the keys left for twice their number. Removed keys stay in the filter
+// until then, which only makes it answer maybe more often.
+#define HT_FLAG_BLOOM_FILTER        0x10
+#define HT_BLOOM_BITS_PER_KEY       10
+#define HT_BLOOM_BLOCK_WORDS        8
+
+// Number of keys hashed and prefetched together by the *Many functions
+#define HT_BATCH_SIZE               16
+
+// Buckets of the probe distance histogram of HtGetStats, the last one takes every
+// key at least HT_STATS_PROBE_BUCKETS - 1 groups away from its home group
+#define HT_STATS_PROBE_BUCKETS      8
+
+// Build data_struct with HT_ENABLE_COUNTERS defined to count the operations of every
+// table, see CC_HASH_TABLE_COUNTERS. Without it the counters stay 0 and cost nothing.
+
+typedef struct _CC_HASH_TABLE_OPTIONS {
+    int Flags;              //HT_FLAG_* values
+    int InitialCapacity;    //rounded up to a power of two, 0 to allocate on first insert
+    CC_HASH_FUNCTION HashRoutine;   //one of the Hf* functions or a custom one, NULL for HfWyHash
+    unsigned long long Seed;        //passed to HashRoutine, keep it secret with HfSipHash
+    int ExpectedKeyCount;   //HT_FLAG_BLOOM_FILTER only: keys the filter is sized for, 0 to follow the table
+} CC_HASH_TABLE_OPTIONS;
+
+typedef struct _CC_HASH_TABLE_SLOTS {
+    NODEH* Slots;           //slot array, NULL when not allocated. The dense key array in insertion order mode
+    unsigned char* Control; //Capacity control bytes followed by a copy of the first group
+    int Capacity;           //number of slots, 0 or a power of two
+    int Used;               //number of keys + number of deleted slots
+    unsigned long long* Occupied;   //one bit per slot, set for the slots holding a key
+    unsigned int InlineLimit;   //keys shorter than this are in NODEH_KEY.Inline, 0 if keys are not owned
+    unsigned int* Index;    //insertion order mode only: position in Slots of the key of every slot
+    int EntryCapacity;      //insertion order mode only: room in Slots, the first Used entries are taken
+} CC_HASH_TABLE_SLOTS;
+
+typedef struct _CC_HASH_TABLE_FROZEN {
+    NODEH* Entries;             //the keys, at the positions their bucket displacement gives
+    unsigned int* Displacements;    //one per bucket
+    int BucketCount;
+    unsigned int InlineLimit;   //same as CC_HASH_TABLE_SLOTS.InlineLimit
+    char* Strings;              //loaded snapshot only: key section the long key offsets are relative to
+    void* Mapping;              //loaded snapshot only: the mapped file
+    size_t MappingSize;
+} CC_HASH_TABLE_FROZEN;
+
+typedef struct _CC_HASH_TABLE_BLOOM {
+    unsigned long long* Blocks; //BlockCount blocks of HT_BLOOM_BLOCK_WORDS words, NULL when not built
+    int BlockCount;
+    int KeyLimit;               //keys the filter was sized for, it is rebuilt once that many were added
+    int Added;                  //keys added since the filter was built, removed ones included
+    int ExpectedKeyCount;       //from the options, the smallest KeyLimit
+} CC_HASH_TABLE_BLOOM;
+
+// Cumulative, HtClear does not reset them. Only the Ht* calls count, the lookups done
+// by CC_CONCURRENT_HASH_TABLE under its shared locks do not.
+typedef struct _CC_HASH_TABLE_COUNTERS {
+    unsigned long long Hits;    //HtGetKeyValue, HtHasKey and HtGetKeyValueMany keys found
+    unsigned long long Misses;  //same calls, keys not found
+    unsigned long long Inserts; //keys added by any call
+    unsigned long long Removes; //keys removed
+} CC_HASH_TABLE_COUNTERS;
+
+// Filled by HtGetStats
+typedef struct _CC_HASH_TABLE_STATS {
+    int Count;                  //number of keys
+    int Capacity;               //slots, of both arrays during an incremental rehash. Entries of a frozen table
+    double LoadFactor;          //Count / Capacity
+    size_t SlotBytes;           //slot arrays with their control bytes and occupancy bitmaps
+    size_t NodeBytes;           //dense array of insertion order mode, entries and displacements (or the whole file) of a frozen table
+    size_t KeyBytes;            //key arena of HT_FLAG_OWN_KEYS, removed keys included
+    int Tombstones;             //deleted slots waiting for the next rehash
+    int MaxProbeDistance;       //groups between the farthest key and its home group
+    int ProbeHistogram[HT_STATS_PROBE_BUCKETS];  //number of keys at each probe distance
+    int ResizeCount;            //rehashes since the table was created, the ones that only dropped deleted slots included
+    size_t FilterBytes;         //HT_FLAG_BLOOM_FILTER only, 0 otherwise
+    double FilterBitsPerKey;    //filter bits for each key in the table
+    double FilterFalsePositiveRate; //chance that the filter lets a missing key through, from the bits set
+    CC_HASH_TABLE_COUNTERS Counters;    //HT_ENABLE_COUNTERS only, 0 otherwise
+} CC_HASH_TABLE_STATS;
+
+// Called instead of FreeRoutine(Memory) for memory that lock-free readers may still be
+// reading, see cchashtable_internal.h
+typedef void (*CC_RETIRE_ROUTINE)(void *Context, void *Memory, CC_FREE_ROUTINE FreeRoutine);
 
 typedef struct _CC_HASH_TABLE {
-    NODEH* Table[SIZE_OF_HASH_TABLE];
-    int Count;
+    CC_HASH_TABLE_SLOTS Table;  //slots that receive new keys
+    CC_HASH_TABLE_SLOTS Old;    //slots still being migrated, only in incremental mode
+    int OldCount;               //number of keys left in Old
+    int MigrateIndex;           //first slot of Old that was not migrated yet
+    int Iterating;              //an iteration over Old is running, lookups do not migrate
+    int Count;                  //number of keys
+    int Flags;
+    int SimdLevel;              //CC_SIMD_* level used to scan the control bytes
+    CC_HASH_FUNCTION HashRoutine;
+    unsigned long long Seed;
+    CC_ARENA Keys;              //copies of the long keys, HT_FLAG_OWN_KEYS only
+    size_t DeadKeyBytes;        //bytes of Keys used by removed keys
+    CC_RETIRE_ROUTINE RetireRoutine;    //NULL unless lock-free readers are allowed
+    void* RetireContext;
+    CC_HASH_TABLE_FROZEN Frozen;    //HT_FLAG_FROZEN only
+    CC_HASH_TABLE_BLOOM Bloom;      //HT_FLAG_BLOOM_FILTER only
+    int ResizeCount;                //number of Rehash and StartMigration calls
+    CC_HASH_TABLE_COUNTERS Counters;    //HT_ENABLE_COUNTERS only
 } CC_HASH_TABLE;
 
 typedef struct _CC_HASH_TABLE_ITERATOR
 {
     CC_HASH_TABLE *HashTable; // set by call to HtGetFirstKey
-    int Index; //index in hashtable
-    NODEH* Current; //current node in hashtable
+    int Index; //index of the current slot in hashtable, or of the entry in insertion order mode
+    NODEH* Current; //current slot in hashtable
 
 } CC_HASH_TABLE_ITERATOR;
 
 int HtCreate(CC_HASH_TABLE **HashTable);
+
+// Same as HtCreate, Options can be NULL for the defaults
+int HtCreateEx(CC_HASH_TABLE **HashTable, CC_HASH_TABLE_OPTIONS *Options);
 int HtDestroy(CC_HASH_TABLE **HashTable);
 
 // Returns -1 if Key already exist in HashTable or the parameters are invalid
@@ -28,6 +196,49 @@ int HtGetKeyValue(CC_HASH_TABLE *HashTable, char *Key, int *Value);
 // Returns -1 if Key does not exist in HashTable or the parameters are invalid
 int HtRemoveKey(CC_HASH_TABLE *HashTable, char *Key);
 
+// Inserts Key with Value unless it is already in HashTable, Current receives the value
+// Key has in HashTable after the call
+//  Returns:
+//       0  - Key was inserted
+//       1  - Key was already in HashTable and was left unchanged
+//      -1  - Error or invalid parameter
+int HtGetOrInsert(CC_HASH_TABLE *HashTable, char *Key, int Value, int *Current);
+
+// Sets the value of Key to Desired only if it currently is *Expected
+//  Returns:
+//       0  - The value was replaced
+//       1  - The value was different, *Expected receives it
+//      -1  - Key does not exist in HashTable or invalid parameter
+int HtCompareAndSet(CC_HASH_TABLE *HashTable, char *Key, int *Expected, int Desired);
+
+// Sets the value of Key to Value, inserting Key if it is not in HashTable
+//  Returns:
+//       0  - Key was inserted
+//       1  - Key was already in HashTable, its value was replaced
+//      -1  - Error, invalid parameter or frozen table
+int HtUpsert(CC_HASH_TABLE *HashTable, char *Key, int Value);
+
+// Adds Delta to the value of Key, a missing Key is inserted with the value Delta.
+// NewValue can be NULL, otherwise it receives the value after the update.
+// Same return values as HtUpsert
+int HtIncrementBy(CC_HASH_TABLE *HashTable, char *Key, int Delta, int *NewValue);
+
+// Value receives a pointer to the value of Key, read and written in place it saves
+// the lookups of a get followed by a set. The pointer stays valid until a key is
+// added to or removed from HashTable, it is cleared or destroyed. With
+// HT_FLAG_INCREMENTAL_REHASH any other call on HashTable can move the key too.
+// Returns -1 if Key does not exist in HashTable, the table is frozen or the parameters are invalid
+int HtGetValuePtr(CC_HASH_TABLE *HashTable, char *Key, int **Value);
+
+// Batch versions of HtGetKeyValue and HtSetKeyValue, Keys[i] gets the same result as a
+// single-key call made in order would give. Results[i] receives that call's return value
+// (0 or -1) and, for HtGetKeyValueMany, Values[i] the value when the key was found.
+// The keys of a batch are hashed and their slots prefetched before any of them is
+// probed, so the cache misses of the lookups overlap.
+// Returns the number of keys found / inserted or -1 if the parameters are invalid
+int HtGetKeyValueMany(CC_HASH_TABLE *HashTable, char **Keys, int Count, int *Values, int *Results);
+int HtSetKeyValueMany(CC_HASH_TABLE *HashTable, char **Keys, int *Values, int Count, int *Results);
+
 //  Returns:
 //       1  - HashTable contains Key
 //       0  - HashTable does not contain Key
@@ -35,12 +246,19 @@ int HtRemoveKey(CC_HASH_TABLE *HashTable, char *Key);
 int HtHasKey(CC_HASH_TABLE *HashTable, char *Key);
 
 // Initializes the iterator and gets the first key in the hash table
+// An incremental rehash in progress is not finished, the keys still in the old array are
+// returned from there. Looking keys up while iterating does not move them around, any
+// change to the table does.
 // Returns:
 //       -1 - Error or invalid parameter
 //       -2 - No keys in the hash table
 //      >=0 - Success
 int HtGetFirstKey(CC_HASH_TABLE *HashTable, CC_HASH_TABLE_ITERATOR **Iterator, char **Key);
 
+// Same as HtGetFirstKey with an iterator owned by the caller, usually on the stack.
+// Nothing is allocated, the iterator does not have to be released.
+int HtInitIterator(CC_HASH_TABLE *HashTable, CC_HASH_TABLE_ITERATOR *Iterator, char **Key);
+
 // Returns the next key in the hash table contained in the iterator
 // Iterator saves the state of the iteration
 // Returns:
@@ -51,11 +269,36 @@ int HtGetNextKey(CC_HASH_TABLE_ITERATOR *Iterator, char **Key);
 
 int HtReleaseIterator(CC_HASH_TABLE_ITERATOR **Iterator);
 
+// Rebuilds HashTable as an immutable minimal perfect hash table, see HT_FLAG_FROZEN.
+// HtGetKeyValue, HtHasKey, the *Many lookups and the iterators keep working, every
+// function that changes the table fails, except HtClear which empties it and makes it
+// mutable again. Iteration order is the order of the packed entries, insertion order
+// is not kept. Fails and leaves HashTable unchanged if two keys have the same 64-bit
+// hash, which the Hf* functions make practically impossible.
+int HtFreeze(CC_HASH_TABLE *HashTable);
+
+// Saves HashTable, frozen or not, to the file at Path. The table is not changed.
+// Returns -1 if the file cannot be written or the table uses a custom HashRoutine,
+// only the Hf* functions can be found again when the file is loaded.
+int HtSaveSnapshot(CC_HASH_TABLE *HashTable, const char *Path);
+
+// Creates a frozen table on a snapshot mapped read-only from Path, Flags are HT_SNAPSHOT_*
+// values. The keys returned by the iterator point into the mapping and must not be
+// changed. HtDestroy and HtClear unmap the file.
+// Returns -1 if the file cannot be mapped or is not a valid snapshot
+int HtLoadSnapshot(CC_HASH_TABLE **HashTable, const char *Path, int Flags);
+
 // Removes every element in the hash table
 int HtClear(CC_HASH_TABLE *HashTable);
 
 // Returns the number of keys in the HashTable, or -1 in case of error
 int HtGetKeyCount(CC_HASH_TABLE *HashTable);
 
-int HashFunction(char* Key);
+// Fills Stats with the current state of HashTable. Walks every slot and the whole
+// filter, meant for dashboards and tuning, not for hot paths.
+// Returns -1 if the parameters are invalid
+int HtGetStats(CC_HASH_TABLE *HashTable, CC_HASH_TABLE_STATS *Stats);
+
+// Hash used by tables created with the default options, truncated to 32 bits
+unsigned int HashFunction(char* Key);
 int EqualStrings(char* String1, char* String2);
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+#include "cchashtable.h"
+
+// Functions shared by the containers built on top of CC_HASH_TABLE, not part of the
+// public API. They take the key hash and length computed by HtpHashKey, so a caller
+// that already needed the hash (to pick a shard for example) does not hash twice.
+
+// Short owned keys live in the slot, every other key is behind Key.Pointer
+#define SLOT_KEY(Slots, Slot) \
+    ((Slot)->KeyLength < (Slots)->InlineLimit ? (Slot)->Key.Inline : (Slot)->Key.Pointer)
+
+// Hashes Key with the table hash function and returns its length in Length
+unsigned long long HtpHashKey(CC_HASH_TABLE *HashTable, char *Key, unsigned int *Length);
+
+// Returns the slot holding Key or NULL. Never changes the table, not even to migrate
+// slots, so it can run next to other readers.
+NODEH* HtpFindKey(CC_HASH_TABLE *HashTable, char *Key, unsigned long long Hash, unsigned int Length);
+
+// Lock-free version of HtpFindKey, can run while another thread changes the table
+// as long as the table was set up with HtpEnableConcurrentReads. The slot stays
+// readable until the memory retired after the call is freed.
+NODEH* HtpFindKeyConcurrent(CC_HASH_TABLE *HashTable, char *Key, unsigned long long Hash, unsigned int Length);
+
+// Lets HtpFindKeyConcurrent run next to one writer. Slot arrays and key chunks are
+// published with release stores and passed to RetireRoutine instead of being freed,
+// deleted slots are not reused until the next rehash and incremental rehash is turned
+// off. Keys must be owned by the table (HT_FLAG_OWN_KEYS), otherwise the caller must
+// not free a removed key while readers may still compare it.
+// Returns -1 if HashTable is not empty or the parameters are invalid
+int HtpEnableConcurrentReads(CC_HASH_TABLE *HashTable, CC_RETIRE_ROUTINE RetireRoutine, void *RetireContext);
+
+// Same as HtSetKeyValue and HtRemoveKey
+int HtpSetKeyValue(CC_HASH_TABLE *HashTable, char *Key, int Value, unsigned long long Hash, unsigned int Length);
+
+// Returns the slot of Key after inserting it with Value if it was missing, Inserted
+// receives 1 if it was. One probe for both the lookup and the insert.
+// Returns NULL on error or if Key is missing from a frozen table
+NODEH* HtpFindOrInsertKey(CC_HASH_TABLE *HashTable, char *Key, int Value, unsigned long long Hash, unsigned int Length, int *Inserted);
+int HtpRemoveKey(CC_HASH_TABLE *HashTable, char *Key, unsigned long long Hash, unsigned int Length);
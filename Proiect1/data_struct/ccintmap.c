@@ -0,0 +1,341 @@
+#include "ccintmap.h"
+#include "common.h"
+#include <string.h>
+
+#define IS_FULL_CONTROL(Control) ((Control) < IM_CTRL_EMPTY)
+
+// 2^64 / golden ratio, consecutive keys end up spread over the whole table
+#define FIBONACCI_MULTIPLIER 0x9E3779B97F4A7C15ULL
+
+static unsigned long long HashKey(long long Key)
+{
+    return (unsigned long long)Key * FIBONACCI_MULTIPLIER;
+}
+
+// The 7 bits right below the ones that picked the slot
+static unsigned char HashControl(CC_INT_MAP* Map, unsigned long long Hash)
+{
+    return (unsigned char)((Hash >> (Map->Shift - 7)) & 0x7F);
+}
+
+// Keys, values and control bytes share one allocation, keys first for their alignment
+static int AllocSlots(CC_INT_MAP* Map, int Capacity)
+{
+    size_t keyBytes = sizeof(long long) * (size_t)Capacity;
+    size_t valueBytes = sizeof(int) * (size_t)Capacity;
+    char* block;
+    int shift = 64;
+
+    block = (char*)malloc(keyBytes + valueBytes + (size_t)Capacity);
+    if (block == NULL)
+    {
+        return -1;
+    }
+    for (int capacity = Capacity; capacity > 1; capacity /= 2)
+    {
+        shift--;
+    }
+
+    Map->Keys = (long long*)block;
+    Map->Values = (int*)(block + keyBytes);
+    Map->Control = (unsigned char*)(block + keyBytes + valueBytes);
+    memset(Map->Control, IM_CTRL_EMPTY, (size_t)Capacity);
+    Map->Capacity = Capacity;
+    Map->Shift = shift;
+    Map->Used = 0;
+    return 0;
+}
+
+static void FreeSlots(CC_INT_MAP* Map)
+{
+    free(Map->Keys);
+    Map->Keys = NULL;
+    Map->Values = NULL;
+    Map->Control = NULL;
+    Map->Capacity = 0;
+    Map->Used = 0;
+}
+
+// Returns the slot holding Key or -1. The map is never full, the probe always
+// ends on an empty slot.
+static int FindSlot(CC_INT_MAP* Map, long long Key)
+{
+    unsigned long long hash;
+    unsigned int mask;
+    unsigned int index;
+    unsigned char control;
+
+    if (Map->Count == 0)
+    {
+        return -1;
+    }
+
+    hash = HashKey(Key);
+    control = HashControl(Map, hash);
+    mask = (unsigned int)Map->Capacity - 1;
+    index = (unsigned int)(hash >> Map->Shift);
+    while (Map->Control[index] != IM_CTRL_EMPTY)
+    {
+        if (Map->Control[index] == control && Map->Keys[index] == Key)
+        {
+            return (int)index;
+        }
+        index = (index + 1) & mask;
+    }
+    return -1;
+}
+
+// Puts a key that is known not to be in Map on the first free slot of its probe
+static void PlaceSlot(CC_INT_MAP* Map, long long Key, int Value)
+{
+    unsigned long long hash = HashKey(Key);
+    unsigned int mask = (unsigned int)Map->Capacity - 1;
+    unsigned int index = (unsigned int)(hash >> Map->Shift);
+
+    while (IS_FULL_CONTROL(Map->Control[index]))
+    {
+        index = (index + 1) & mask;
+    }
+
+    if (Map->Control[index] == IM_CTRL_EMPTY)
+    {
+        //a deleted slot is already counted in Used
+        Map->Used += 1;
+    }
+    Map->Keys[index] = Key;
+    Map->Values[index] = Value;
+    Map->Control[index] = HashControl(Map, hash);
+}
+
+// Moves every key into new arrays of NewCapacity slots, dropping deleted slots
+static int Rehash(CC_INT_MAP* Map, int NewCapacity)
+{
+    CC_INT_MAP old = *Map;
+
+    if (AllocSlots(Map, NewCapacity) != 0)
+    {
+        *Map = old;
+        return -1;
+    }
+
+    for (int i = 0; i < old.Capacity; i++)
+    {
+        if (IS_FULL_CONTROL(old.Control[i]))
+        {
+            PlaceSlot(Map, old.Keys[i], old.Values[i]);
+        }
+    }
+    free(old.Keys);
+    return 0;
+}
+
+// Makes room for one more key, keeping occupied + deleted slots under 3/4 of the capacity.
+// Linear probing clusters sooner than the group probing of CC_HASH_TABLE, hence the lower limit.
+static int ReserveSlot(CC_INT_MAP* Map)
+{
+    int newCapacity;
+
+    if (Map->Capacity == 0)
+    {
+        return AllocSlots(Map, IM_INITIAL_CAPACITY);
+    }
+    if ((Map->Used + 1) * 4 <= Map->Capacity * 3)
+    {
+        return 0;
+    }
+
+    //mostly deleted slots: rehashing in place is enough to reclaim them
+    newCapacity = Map->Capacity;
+    if ((Map->Count + 1) * 2 > Map->Capacity)
+    {
+        newCapacity *= 2;
+    }
+    return Rehash(Map, newCapacity);
+}
+
+int ImCreate(CC_INT_MAP** Map)
+{
+    CC_INT_MAP* map;
+
+    if (Map == NULL)
+    {
+        return -1;
+    }
+
+    map = (CC_INT_MAP*)malloc(sizeof(CC_INT_MAP));
+    if (map == NULL)
+    {
+        return -1;
+    }
+    memset(map, 0, sizeof(*map));
+
+    *Map = map;
+    return 0;
+}
+
+int ImDestroy(CC_INT_MAP** Map)
+{
+    if (Map == NULL || *Map == NULL)
+    {
+        return -1;
+    }
+    FreeSlots(*Map);
+    free(*Map);
+    *Map = NULL;
+    return 0;
+}
+
+int ImSetKeyValue(CC_INT_MAP* Map, long long Key, int Value)
+{
+    if (Map == NULL)
+    {
+        return -1;
+    }
+    if (FindSlot(Map, Key) != -1)
+    {
+        return -1;
+    }
+    if (ReserveSlot(Map) != 0)
+    {
+        return -1;
+    }
+
+    PlaceSlot(Map, Key, Value);
+    Map->Count += 1;
+    return 0;
+}
+
+int ImGetKeyValue(CC_INT_MAP* Map, long long Key, int* Value)
+{
+    int index;
+
+    if (Map == NULL || Value == NULL)
+    {
+        return -1;
+    }
+
+    index = FindSlot(Map, Key);
+    if (index == -1)
+    {
+        return -1;
+    }
+    *Value = Map->Values[index];
+    return 0;
+}
+
+int ImRemoveKey(CC_INT_MAP* Map, long long Key)
+{
+    int index;
+
+    if (Map == NULL)
+    {
+        return -1;
+    }
+
+    index = FindSlot(Map, Key);
+    if (index == -1)
+    {
+        return -1;
+    }
+    //keep the probe chains going through this slot intact
+    Map->Control[index] = IM_CTRL_DELETED;
+    Map->Count -= 1;
+    return 0;
+}
+
+int ImHasKey(CC_INT_MAP* Map, long long Key)
+{
+    if (Map == NULL)
+    {
+        return -1;
+    }
+    return FindSlot(Map, Key) != -1;
+}
+
+int ImGetFirstKey(CC_INT_MAP* Map, CC_INT_MAP_ITERATOR** Iterator, long long* Key)
+{
+    CC_INT_MAP_ITERATOR* iterator = NULL;
+
+    if (NULL == Map || NULL == Iterator || NULL == Key)
+    {
+        return -1;
+    }
+
+    iterator = (CC_INT_MAP_ITERATOR*)malloc(sizeof(CC_INT_MAP_ITERATOR));
+    if (NULL == iterator)
+    {
+        return -1;
+    }
+
+    *Iterator = iterator;
+    return ImInitIterator(Map, iterator, Key);
+}
+
+int ImInitIterator(CC_INT_MAP* Map, CC_INT_MAP_ITERATOR* Iterator, long long* Key)
+{
+    if (NULL == Map || NULL == Iterator || NULL == Key)
+    {
+        return -1;
+    }
+
+    Iterator->Map = Map;
+    Iterator->Index = -1;
+    return ImGetNextKey(Iterator, Key);
+}
+
+int ImGetNextKey(CC_INT_MAP_ITERATOR* Iterator, long long* Key)
+{
+    CC_INT_MAP* map;
+
+    if (Iterator == NULL || Key == NULL || Iterator->Map == NULL)
+    {
+        return -1;
+    }
+
+    map = Iterator->Map;
+    for (int i = Iterator->Index + 1; i < map->Capacity; i++)
+    {
+        if (IS_FULL_CONTROL(map->Control[i]))
+        {
+            Iterator->Index = i;
+            *Key = map->Keys[i];
+            return 0;
+        }
+    }
+
+    Iterator->Index = map->Capacity;
+    return -2;
+}
+
+int ImReleaseIterator(CC_INT_MAP_ITERATOR** Iterator)
+{
+    if (Iterator == NULL)
+    {
+        return -1;
+    }
+    free(*Iterator);
+    *Iterator = NULL;
+    return 0;
+}
+
+int ImClear(CC_INT_MAP* Map)
+{
+    if (Map == NULL)
+    {
+        return -1;
+    }
+
+    //an empty map does not keep any memory
+    FreeSlots(Map);
+    Map->Count = 0;
+    return 0;
+}
+
+int ImGetKeyCount(CC_INT_MAP* Map)
+{
+    if (Map == NULL)
+    {
+        return -1;
+    }
+    return Map->Count;
+}
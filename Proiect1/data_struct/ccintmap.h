@@ -0,0 +1,75 @@
+#pragma once
+#include "common.h"
+
+// Map from 64-bit integer keys to int values, for the tables whose keys are ids and
+// would otherwise be formatted into strings for CC_HASH_TABLE. Keys, values and one
+// control byte per slot live in flat arrays sharing a single allocation, nothing is
+// allocated per key. Slots are found with Fibonacci hashing (the key times 2^64 / phi,
+// the top bits give the slot) and linear probing. The control byte holds
+// IM_CTRL_EMPTY, IM_CTRL_DELETED or 7 more bits of the hash, so most probes never
+// read a key. Capacity is a power of two, allocated on the first insert and doubled
+// when occupied + deleted slots go over 3/4 of it.
+#define IM_INITIAL_CAPACITY 16
+
+#define IM_CTRL_EMPTY       0x80
+#define IM_CTRL_DELETED     0xFE
+
+typedef struct _CC_INT_MAP {
+    long long* Keys;        //NULL when not allocated
+    int* Values;
+    unsigned char* Control;
+    int Capacity;           //number of slots, 0 or a power of two
+    int Used;               //number of keys + number of deleted slots
+    int Count;              //number of keys
+    int Shift;              //64 - log2(Capacity), the hash is shifted right by it
+} CC_INT_MAP;
+
+typedef struct _CC_INT_MAP_ITERATOR
+{
+    CC_INT_MAP *Map;    // set by call to ImGetFirstKey
+    int Index;          //index of the current slot in the map
+} CC_INT_MAP_ITERATOR;
+
+int ImCreate(CC_INT_MAP **Map);
+int ImDestroy(CC_INT_MAP **Map);
+
+// Returns -1 if Key already exist in Map or the parameters are invalid
+int ImSetKeyValue(CC_INT_MAP *Map, long long Key, int Value);
+
+// Returns -1 if Key does not exist in Map or the parameters are invalid
+int ImGetKeyValue(CC_INT_MAP *Map, long long Key, int *Value);
+
+// Returns -1 if Key does not exist in Map or the parameters are invalid
+int ImRemoveKey(CC_INT_MAP *Map, long long Key);
+
+//  Returns:
+//       1  - Map contains Key
+//       0  - Map does not contain Key
+//      -1  - Error or invalid parameter
+int ImHasKey(CC_INT_MAP *Map, long long Key);
+
+// Initializes the iterator and gets the first key in the map
+// Returns:
+//       -1 - Error or invalid parameter
+//       -2 - No keys in the map
+//      >=0 - Success
+int ImGetFirstKey(CC_INT_MAP *Map, CC_INT_MAP_ITERATOR **Iterator, long long *Key);
+
+// Same as ImGetFirstKey with an iterator owned by the caller, usually on the stack.
+// Nothing is allocated, the iterator does not have to be released.
+int ImInitIterator(CC_INT_MAP *Map, CC_INT_MAP_ITERATOR *Iterator, long long *Key);
+
+// Returns the next key in the map contained in the iterator
+// Returns:
+//       -1 - Error or invalid parameter
+//       -2 - No more keys in the map
+//      >=0 - Success
+int ImGetNextKey(CC_INT_MAP_ITERATOR *Iterator, long long *Key);
+
+int ImReleaseIterator(CC_INT_MAP_ITERATOR **Iterator);
+
+// Removes every element in the map and frees the arrays
+int ImClear(CC_INT_MAP *Map);
+
+// Returns the number of keys in the Map, or -1 in case of error
+int ImGetKeyCount(CC_INT_MAP *Map);
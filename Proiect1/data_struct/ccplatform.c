@@ -0,0 +1,767 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+//mremap, and the pthread and file calls under a strict -std=c11
+#define _GNU_SOURCE
+#endif
+#include "ccplatform.h"
+#include "common.h"
+#include <stdlib.h>
+
+//the only file that sees the OS headers, see CC_RWLOCK
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined(CC_X86) && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static int gSimdLevel = -1;     //detected level, -1 until the first call
+static int gSimdCap = CC_SIMD_AVX2;
+
+#ifdef CC_X86
+static void CpuId(int Leaf, int SubLeaf, unsigned int Registers[4])
+{
+#ifdef _MSC_VER
+    __cpuidex((int*)Registers, Leaf, SubLeaf);
+#else
+    __cpuid_count(Leaf, SubLeaf, Registers[0], Registers[1], Registers[2], Registers[3]);
+#endif
+}
+
+// Returns the XCR0 register, tells which register states the OS saves
+static unsigned long long ReadXcr0(void)
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int low, high;
+    __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return ((unsigned long long)high << 32) | low;
+#endif
+}
+
+static int DetectSimdLevel(void)
+{
+    unsigned int registers[4];
+    int level = CC_SIMD_NONE;
+
+    CpuId(0, 0, registers);
+    if (registers[0] < 1)
+    {
+        return level;
+    }
+    int maxLeaf = (int)registers[0];
+
+    CpuId(1, 0, registers);
+    if (registers[3] & (1u << 26))
+    {
+        level = CC_SIMD_SSE2;
+    }
+    if (level == CC_SIMD_SSE2 && (registers[2] & (1u << 19)))
+    {
+        level = CC_SIMD_SSE41;
+    }
+
+    //AVX2 also needs the OS to save the YMM registers (OSXSAVE + XCR0 bits 1 and 2)
+    if (level == CC_SIMD_SSE41 && maxLeaf >= 7 && (registers[2] & (1u << 27)) && (ReadXcr0() & 6) == 6)
+    {
+        CpuId(7, 0, registers);
+        if (registers[1] & (1u << 5))
+        {
+            level = CC_SIMD_AVX2;
+        }
+    }
+    return level;
+}
+#else
+static int DetectSimdLevel(void)
+{
+    return CC_SIMD_NONE;
+}
+#endif
+
+int CcGetSimdLevel(void)
+{
+    if (gSimdLevel < 0)
+    {
+        //racing threads all store the same value
+        gSimdLevel = DetectSimdLevel();
+    }
+    return gSimdLevel < gSimdCap ? gSimdLevel : gSimdCap;
+}
+
+int CcSetSimdLevel(int Level)
+{
+    if (Level < CC_SIMD_NONE || Level > CC_SIMD_AVX2)
+    {
+        return -1;
+    }
+    gSimdCap = Level;
+    return 0;
+}
+
+void* CcAlignedAlloc(size_t Size, size_t Alignment)
+{
+#ifdef _WIN32
+    return _aligned_malloc(Size, Alignment);
+#else
+    void* memory = NULL;
+
+    if (Alignment < sizeof(void*))
+    {
+        Alignment = sizeof(void*);
+    }
+    if (posix_memalign(&memory, Alignment, Size) != 0)
+    {
+        return NULL;
+    }
+    return memory;
+#endif
+}
+
+void CcAlignedFree(void* Memory)
+{
+#ifdef _WIN32
+    _aligned_free(Memory);
+#else
+    free(Memory);
+#endif
+}
+
+#ifdef _WIN32
+// The SRWLOCK and CONDITION_VARIABLE are stored in the Handle of the CC_* structures
+C_ASSERT(sizeof(SRWLOCK) == sizeof(void*) && sizeof(CONDITION_VARIABLE) == sizeof(void*));
+#define SRW_LOCK(Lock)          ((PSRWLOCK)&(Lock)->Handle)
+#define CONDITION_VAR(Condition)    ((PCONDITION_VARIABLE)&(Condition)->Handle)
+#else
+#define RW_LOCK(Lock)           ((pthread_rwlock_t*)(Lock)->Handle)
+#define MUTEX(Mutex)            ((pthread_mutex_t*)(Mutex)->Handle)
+#define CONDITION_VAR(Condition)    ((pthread_cond_t*)(Condition)->Handle)
+
+struct _CC_THREAD {
+    pthread_t Thread;
+};
+
+// Every lock gets cache lines of its own, like the shards that used to embed them
+static void* AllocLock(size_t Size)
+{
+    return CcAlignedAlloc((Size + CC_CACHE_LINE_SIZE - 1) & ~(size_t)(CC_CACHE_LINE_SIZE - 1), CC_CACHE_LINE_SIZE);
+}
+#endif
+
+int CcRwLockInit(CC_RWLOCK* Lock)
+{
+#ifdef _WIN32
+    InitializeSRWLock(SRW_LOCK(Lock));
+    return 0;
+#else
+    pthread_rwlock_t* lock = (pthread_rwlock_t*)AllocLock(sizeof(pthread_rwlock_t));
+
+    if (lock == NULL || pthread_rwlock_init(lock, NULL) != 0)
+    {
+        CcAlignedFree(lock);
+        return -1;
+    }
+    Lock->Handle = lock;
+    return 0;
+#endif
+}
+
+void CcRwLockDestroy(CC_RWLOCK* Lock)
+{
+#ifdef _WIN32
+    //an SRWLOCK holds no resources
+    CC_UNREFERENCED_PARAMETER(Lock);
+#else
+    pthread_rwlock_destroy(RW_LOCK(Lock));
+    CcAlignedFree(Lock->Handle);
+    Lock->Handle = NULL;
+#endif
+}
+
+void CcRwLockAcquireShared(CC_RWLOCK* Lock)
+{
+#ifdef _WIN32
+    AcquireSRWLockShared(SRW_LOCK(Lock));
+#else
+    pthread_rwlock_rdlock(RW_LOCK(Lock));
+#endif
+}
+
+void CcRwLockReleaseShared(CC_RWLOCK* Lock)
+{
+#ifdef _WIN32
+    ReleaseSRWLockShared(SRW_LOCK(Lock));
+#else
+    pthread_rwlock_unlock(RW_LOCK(Lock));
+#endif
+}
+
+void CcRwLockAcquireExclusive(CC_RWLOCK* Lock)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(SRW_LOCK(Lock));
+#else
+    pthread_rwlock_wrlock(RW_LOCK(Lock));
+#endif
+}
+
+void CcRwLockReleaseExclusive(CC_RWLOCK* Lock)
+{
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(SRW_LOCK(Lock));
+#else
+    pthread_rwlock_unlock(RW_LOCK(Lock));
+#endif
+}
+
+int CcMutexInit(CC_MUTEX* Mutex)
+{
+#ifdef _WIN32
+    InitializeSRWLock(SRW_LOCK(Mutex));
+    return 0;
+#else
+    pthread_mutex_t* mutex = (pthread_mutex_t*)AllocLock(sizeof(pthread_mutex_t));
+
+    if (mutex == NULL || pthread_mutex_init(mutex, NULL) != 0)
+    {
+        CcAlignedFree(mutex);
+        return -1;
+    }
+    Mutex->Handle = mutex;
+    return 0;
+#endif
+}
+
+void CcMutexDestroy(CC_MUTEX* Mutex)
+{
+#ifdef _WIN32
+    CC_UNREFERENCED_PARAMETER(Mutex);
+#else
+    pthread_mutex_destroy(MUTEX(Mutex));
+    CcAlignedFree(Mutex->Handle);
+    Mutex->Handle = NULL;
+#endif
+}
+
+void CcMutexAcquire(CC_MUTEX* Mutex)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(SRW_LOCK(Mutex));
+#else
+    pthread_mutex_lock(MUTEX(Mutex));
+#endif
+}
+
+void CcMutexRelease(CC_MUTEX* Mutex)
+{
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(SRW_LOCK(Mutex));
+#else
+    pthread_mutex_unlock(MUTEX(Mutex));
+#endif
+}
+
+int CcConditionInit(CC_CONDITION* Condition)
+{
+#ifdef _WIN32
+    InitializeConditionVariable(CONDITION_VAR(Condition));
+    return 0;
+#else
+    pthread_cond_t* condition = (pthread_cond_t*)AllocLock(sizeof(pthread_cond_t));
+
+    if (condition == NULL || pthread_cond_init(condition, NULL) != 0)
+    {
+        CcAlignedFree(condition);
+        return -1;
+    }
+    Condition->Handle = condition;
+    return 0;
+#endif
+}
+
+void CcConditionDestroy(CC_CONDITION* Condition)
+{
+#ifdef _WIN32
+    //a CONDITION_VARIABLE holds no resources either
+    CC_UNREFERENCED_PARAMETER(Condition);
+#else
+    pthread_cond_destroy(CONDITION_VAR(Condition));
+    CcAlignedFree(Condition->Handle);
+    Condition->Handle = NULL;
+#endif
+}
+
+void CcConditionWait(CC_CONDITION* Condition, CC_MUTEX* Mutex)
+{
+#ifdef _WIN32
+    SleepConditionVariableSRW(CONDITION_VAR(Condition), SRW_LOCK(Mutex), INFINITE, 0);
+#else
+    pthread_cond_wait(CONDITION_VAR(Condition), MUTEX(Mutex));
+#endif
+}
+
+void CcConditionSignal(CC_CONDITION* Condition)
+{
+#ifdef _WIN32
+    WakeConditionVariable(CONDITION_VAR(Condition));
+#else
+    pthread_cond_signal(CONDITION_VAR(Condition));
+#endif
+}
+
+void CcConditionBroadcast(CC_CONDITION* Condition)
+{
+#ifdef _WIN32
+    WakeAllConditionVariable(CONDITION_VAR(Condition));
+#else
+    pthread_cond_broadcast(CONDITION_VAR(Condition));
+#endif
+}
+
+typedef struct _CC_THREAD_START {
+    CC_THREAD_ROUTINE Routine;
+    void* Context;
+} CC_THREAD_START;
+
+// Adapts CC_THREAD_ROUTINE to the signature the OS expects
+#ifdef _WIN32
+static DWORD WINAPI ThreadStart(LPVOID Parameter)
+#else
+static void* ThreadStart(void* Parameter)
+#endif
+{
+    CC_THREAD_START start = *(CC_THREAD_START*)Parameter;
+
+    free(Parameter);
+    start.Routine(start.Context);
+    return 0;
+}
+
+int CcThreadCreate(CC_THREAD* Thread, CC_THREAD_ROUTINE Routine, void* Context)
+{
+    CC_THREAD_START* start;
+
+    if (Thread == NULL || Routine == NULL)
+    {
+        return -1;
+    }
+
+    start = (CC_THREAD_START*)malloc(sizeof(CC_THREAD_START));
+    if (start == NULL)
+    {
+        return -1;
+    }
+    start->Routine = Routine;
+    start->Context = Context;
+
+#ifdef _WIN32
+    *Thread = (CC_THREAD)CreateThread(NULL, 0, ThreadStart, start, 0, NULL);
+    if (*Thread == NULL)
+    {
+        free(start);
+        return -1;
+    }
+#else
+    *Thread = (CC_THREAD)malloc(sizeof(struct _CC_THREAD));
+    if (*Thread == NULL || pthread_create(&(*Thread)->Thread, NULL, ThreadStart, start) != 0)
+    {
+        free(*Thread);
+        *Thread = NULL;
+        free(start);
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+int CcThreadJoin(CC_THREAD Thread)
+{
+    if (Thread == NULL)
+    {
+        return -1;
+    }
+
+#ifdef _WIN32
+    if (WaitForSingleObject((HANDLE)Thread, INFINITE) != WAIT_OBJECT_0)
+    {
+        return -1;
+    }
+    CloseHandle((HANDLE)Thread);
+    return 0;
+#else
+    if (pthread_join(Thread->Thread, NULL) != 0)
+    {
+        return -1;
+    }
+    free(Thread);
+    return 0;
+#endif
+}
+
+int CcGetProcessorCount(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+int CcMapFile(const char* Path, void** Memory, size_t* Size)
+{
+    if (Path == NULL || Memory == NULL || Size == NULL)
+    {
+        return -1;
+    }
+
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+    LARGE_INTEGER fileSize;
+    void* view = NULL;
+
+    file = CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return -1;
+    }
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || (unsigned long long)fileSize.QuadPart > (size_t)-1)
+    {
+        CloseHandle(file);
+        return -1;
+    }
+
+    //the view keeps the file and the mapping alive, both handles can go
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL)
+    {
+        view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    if (view == NULL)
+    {
+        return -1;
+    }
+    *Memory = view;
+    *Size = (size_t)fileSize.QuadPart;
+    return 0;
+#else
+    struct stat info;
+    void* view;
+    int file;
+
+    file = open(Path, O_RDONLY);
+    if (file < 0)
+    {
+        return -1;
+    }
+    if (fstat(file, &info) != 0 || info.st_size <= 0)
+    {
+        close(file);
+        return -1;
+    }
+
+    view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+    if (view == MAP_FAILED)
+    {
+        return -1;
+    }
+    *Memory = view;
+    *Size = (size_t)info.st_size;
+    return 0;
+#endif
+}
+
+void CcUnmapFile(void* Memory, size_t Size)
+{
+    if (Memory == NULL)
+    {
+        return;
+    }
+#ifdef _WIN32
+    CC_UNREFERENCED_PARAMETER(Size);
+    UnmapViewOfFile(Memory);
+#else
+    munmap(Memory, Size);
+#endif
+}
+
+#ifdef _WIN32
+#define FILE_HANDLE(File)   ((HANDLE)(File)->File)
+#else
+#define FILE_HANDLE(File)   ((int)(File)->File)
+#endif
+
+#ifdef _WIN32
+// Maps Size bytes of the file, the view keeps the mapping object alive
+static int MapView(CC_MAPPED_FILE* File, size_t Size)
+{
+    HANDLE mapping;
+    void* view = NULL;
+
+    mapping = CreateFileMappingA(FILE_HANDLE(File), NULL, PAGE_READWRITE, (DWORD)((unsigned long long)Size >> 32), (DWORD)Size, NULL);
+    if (mapping != NULL)
+    {
+        view = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, Size);
+        CloseHandle(mapping);
+    }
+    if (view == NULL)
+    {
+        return -1;
+    }
+    File->Memory = view;
+    File->Size = Size;
+    return 0;
+}
+
+static int SetFileSize(HANDLE File, size_t Size)
+{
+    LARGE_INTEGER size;
+
+    size.QuadPart = (LONGLONG)Size;
+    return SetFilePointerEx(File, size, NULL, FILE_BEGIN) && SetEndOfFile(File) ? 0 : -1;
+}
+#endif
+
+int CcOpenMappedFile(const char* Path, CC_MAPPED_FILE* File)
+{
+    if (Path == NULL || File == NULL)
+    {
+        return -1;
+    }
+
+#ifdef _WIN32
+    HANDLE file;
+    LARGE_INTEGER fileSize;
+
+    file = CreateFileA(Path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return -1;
+    }
+    if (!GetFileSizeEx(file, &fileSize) || (unsigned long long)fileSize.QuadPart > (size_t)-1)
+    {
+        CloseHandle(file);
+        return -1;
+    }
+
+    File->File = (intptr_t)file;
+    File->Memory = NULL;
+    File->Size = 0;
+    if (fileSize.QuadPart > 0 && MapView(File, (size_t)fileSize.QuadPart) != 0)
+    {
+        CloseHandle(file);
+        return -1;
+    }
+    return 0;
+#else
+    struct stat info;
+    void* view = NULL;
+    int file;
+
+    file = open(Path, O_RDWR | O_CREAT, 0644);
+    if (file < 0)
+    {
+        return -1;
+    }
+    if (fstat(file, &info) != 0 || (unsigned long long)info.st_size > (size_t)-1)
+    {
+        close(file);
+        return -1;
+    }
+
+    if (info.st_size > 0)
+    {
+        view = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        if (view == MAP_FAILED)
+        {
+            close(file);
+            return -1;
+        }
+    }
+    File->File = (intptr_t)file;
+    File->Memory = view;
+    File->Size = (size_t)info.st_size;
+    return 0;
+#endif
+}
+
+int CcResizeMappedFile(CC_MAPPED_FILE* File, size_t Size)
+{
+    if (File == NULL)
+    {
+        return -1;
+    }
+    if (Size == File->Size)
+    {
+        return 0;
+    }
+
+#ifdef _WIN32
+    size_t oldSize = File->Size;
+
+    //a mapped file cannot change size, the view goes and comes back
+    if (File->Memory != NULL)
+    {
+        UnmapViewOfFile(File->Memory);
+        File->Memory = NULL;
+        File->Size = 0;
+    }
+    if (SetFileSize(FILE_HANDLE(File), Size) != 0 || (Size > 0 && MapView(File, Size) != 0))
+    {
+        if (SetFileSize(FILE_HANDLE(File), oldSize) == 0 && oldSize > 0)
+        {
+            MapView(File, oldSize);
+        }
+        return -1;
+    }
+    return 0;
+#else
+    void* view;
+
+    //the pages past the end of the file must not be mapped, it grows first and shrinks last
+    if (Size > File->Size && ftruncate(FILE_HANDLE(File), (off_t)Size) != 0)
+    {
+        return -1;
+    }
+
+    if (Size == 0)
+    {
+        munmap(File->Memory, File->Size);
+        view = NULL;
+    }
+    else if (File->Memory == NULL)
+    {
+        view = mmap(NULL, Size, PROT_READ | PROT_WRITE, MAP_SHARED, FILE_HANDLE(File), 0);
+    }
+    else
+    {
+#ifdef __linux__
+        view = mremap(File->Memory, File->Size, Size, MREMAP_MAYMOVE);
+#else
+        view = mmap(NULL, Size, PROT_READ | PROT_WRITE, MAP_SHARED, FILE_HANDLE(File), 0);
+        if (view != MAP_FAILED)
+        {
+            munmap(File->Memory, File->Size);
+        }
+#endif
+    }
+    if (view == MAP_FAILED)
+    {
+        //back to the old size, the old mapping still covers it
+        if (Size > File->Size)
+        {
+            ftruncate(FILE_HANDLE(File), (off_t)File->Size);
+        }
+        return -1;
+    }
+
+    //a file that cannot shrink only keeps more room than needed
+    if (Size < File->Size)
+    {
+        ftruncate(FILE_HANDLE(File), (off_t)Size);
+    }
+    File->Memory = view;
+    File->Size = Size;
+    return 0;
+#endif
+}
+
+int CcSyncMappedFile(CC_MAPPED_FILE* File)
+{
+    if (File == NULL)
+    {
+        return -1;
+    }
+
+#ifdef _WIN32
+    if (File->Memory != NULL && !FlushViewOfFile(File->Memory, 0))
+    {
+        return -1;
+    }
+    return FlushFileBuffers(FILE_HANDLE(File)) ? 0 : -1;
+#else
+    if (File->Memory != NULL && msync(File->Memory, File->Size, MS_SYNC) != 0)
+    {
+        return -1;
+    }
+    return fsync(FILE_HANDLE(File)) == 0 ? 0 : -1;
+#endif
+}
+
+int CcAdviseMappedFile(CC_MAPPED_FILE* File, int Access)
+{
+    if (File == NULL || Access < CC_ACCESS_NORMAL || Access > CC_ACCESS_RANDOM)
+    {
+        return -1;
+    }
+
+#ifdef _WIN32
+    return 0;
+#else
+    static const int advice[] = { MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM };
+
+    if (File->Memory == NULL)
+    {
+        return 0;
+    }
+    return madvise(File->Memory, File->Size, advice[Access]) == 0 ? 0 : -1;
+#endif
+}
+
+void CcCloseMappedFile(CC_MAPPED_FILE* File)
+{
+    if (File == NULL)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    if (File->Memory != NULL)
+    {
+        UnmapViewOfFile(File->Memory);
+    }
+    CloseHandle(FILE_HANDLE(File));
+#else
+    if (File->Memory != NULL)
+    {
+        munmap(File->Memory, File->Size);
+    }
+    close(FILE_HANDLE(File));
+#endif
+    File->Memory = NULL;
+    File->Size = 0;
+}
+
+unsigned long long CcGetPhysicalMemory(void)
+{
+#ifdef _WIN32
+    MEMORYSTATUSEX status;
+
+    status.dwLength = sizeof(status);
+    return GlobalMemoryStatusEx(&status) ? status.ullTotalPhys : 0;
+#else
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+
+    return pages > 0 && pageSize > 0 ? (unsigned long long)pages * (unsigned long long)pageSize : 0;
+#endif
+}
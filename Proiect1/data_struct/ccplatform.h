@@ -0,0 +1,337 @@
+#pragma once
+
+// Compiler and CPU specific helpers shared by the containers
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CC_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC lets any function use any intrinsic
+#define CC_TARGET_SSE41
+#define CC_TARGET_AVX2
+#else
+#define CC_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define CC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// Size of a cache line, data written by different threads is kept this far apart
+#define CC_CACHE_LINE_SIZE  64
+
+// Instruction sets, each one implies the ones before it
+#define CC_SIMD_NONE    0
+#define CC_SIMD_SSE2    1
+#define CC_SIMD_SSE41   2
+#define CC_SIMD_AVX2    3
+
+// Returns the best CC_SIMD_* level supported by the CPU and the OS, capped by CcSetSimdLevel
+int CcGetSimdLevel(void);
+
+// Caps the level returned by CcGetSimdLevel, used to compare the code paths
+// Containers created after this call use the new level
+// Returns -1 if Level is not a CC_SIMD_* value
+int CcSetSimdLevel(int Level);
+
+// Index of the lowest set bit, Value must not be 0
+static __inline unsigned int CcCountTrailingZeros(unsigned int Value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, Value);
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctz(Value);
+#endif
+}
+
+// Index of the lowest set bit of a 64-bit Value, Value must not be 0
+static __inline unsigned int CcCountTrailingZeros64(unsigned long long Value)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, Value);
+    return (unsigned int)index;
+#elif defined(_MSC_VER)
+    if ((unsigned int)Value != 0)
+    {
+        return CcCountTrailingZeros((unsigned int)Value);
+    }
+    return 32 + CcCountTrailingZeros((unsigned int)(Value >> 32));
+#else
+    return (unsigned int)__builtin_ctzll(Value);
+#endif
+}
+
+// Starts loading the cache line holding Address, never faults
+static __inline void CcPrefetch(const void *Address)
+{
+#if defined(CC_X86)
+    _mm_prefetch((const char*)Address, _MM_HINT_T0);
+#elif defined(_MSC_VER)
+    __prefetch(Address);
+#else
+    __builtin_prefetch(Address);
+#endif
+}
+
+// Thread local storage class for global variables
+#ifdef _MSC_VER
+#define CC_THREAD_LOCAL __declspec(thread)
+#else
+#define CC_THREAD_LOCAL __thread
+#endif
+
+// Atomic operations on values shared between threads. The read-modify-write ones are
+// full barriers. Loads have acquire and stores release semantics.
+static __inline long CcAtomicIncrement(volatile long *Value)
+{
+#ifdef _MSC_VER
+    return _InterlockedIncrement(Value);
+#else
+    return __atomic_add_fetch(Value, 1, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static __inline long CcAtomicDecrement(volatile long *Value)
+{
+#ifdef _MSC_VER
+    return _InterlockedDecrement(Value);
+#else
+    return __atomic_sub_fetch(Value, 1, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Returns the previous value, Value was changed only if it was Comparand
+static __inline long CcAtomicCompareExchange(volatile long *Value, long Exchange, long Comparand)
+{
+#ifdef _MSC_VER
+    return _InterlockedCompareExchange(Value, Exchange, Comparand);
+#else
+    __atomic_compare_exchange_n(Value, &Comparand, Exchange, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return Comparand;
+#endif
+}
+
+// Returns the previous pointer, Pointer was changed only if it was Comparand
+static __inline void* CcAtomicCompareExchangePointer(void* volatile *Pointer, void *Exchange, void *Comparand)
+{
+#ifdef _MSC_VER
+    return _InterlockedCompareExchangePointer(Pointer, Exchange, Comparand);
+#else
+    __atomic_compare_exchange_n(Pointer, &Comparand, Exchange, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return Comparand;
+#endif
+}
+
+// Full hardware barrier for MSVC, MemoryBarrier() would need <windows.h>
+#if defined(_MSC_VER) && defined(CC_X86)
+#define CC_MEMORY_BARRIER() _mm_mfence()
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+#define CC_MEMORY_BARRIER() __dmb(_ARM64_BARRIER_ISH)
+#elif defined(_MSC_VER)
+#define CC_MEMORY_BARRIER() __dmb(_ARM_BARRIER_ISH)
+#endif
+
+// Orders the loads before the fence with the loads and stores after it
+static __inline void CcAcquireFence(void)
+{
+#if defined(_MSC_VER) && defined(CC_X86)
+    //x86 never reorders loads with other accesses, only the compiler could
+    _ReadWriteBarrier();
+#elif defined(_MSC_VER)
+    CC_MEMORY_BARRIER();
+#else
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+}
+
+// Orders the loads and stores before the fence with the stores after it
+static __inline void CcReleaseFence(void)
+{
+#if defined(_MSC_VER) && defined(CC_X86)
+    _ReadWriteBarrier();
+#elif defined(_MSC_VER)
+    CC_MEMORY_BARRIER();
+#else
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
+
+static __inline void CcFullFence(void)
+{
+#ifdef _MSC_VER
+    CC_MEMORY_BARRIER();
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+static __inline long CcAtomicLoad(volatile long *Value)
+{
+#ifdef _MSC_VER
+    long value = *Value;
+    CcAcquireFence();
+    return value;
+#else
+    return __atomic_load_n(Value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static __inline void* CcAtomicLoadPointer(void* volatile *Pointer)
+{
+#ifdef _MSC_VER
+    void *value = *Pointer;
+    CcAcquireFence();
+    return value;
+#else
+    return __atomic_load_n(Pointer, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static __inline void CcAtomicStorePointer(void* volatile *Pointer, void *Value)
+{
+#ifdef _MSC_VER
+    CcReleaseFence();
+    *Pointer = Value;
+#else
+    __atomic_store_n(Pointer, Value, __ATOMIC_RELEASE);
+#endif
+}
+
+// Same for int values, an int is a long on Windows
+static __inline int CcAtomicLoadInt(volatile int *Value)
+{
+#ifdef _MSC_VER
+    int value = *Value;
+    CcAcquireFence();
+    return value;
+#else
+    return __atomic_load_n(Value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static __inline void CcAtomicStoreInt(volatile int *Value, int NewValue)
+{
+#ifdef _MSC_VER
+    CcReleaseFence();
+    *Value = NewValue;
+#else
+    __atomic_store_n(Value, NewValue, __ATOMIC_RELEASE);
+#endif
+}
+
+// Returns the value after the addition
+static __inline int CcAtomicAddInt(volatile int *Value, int Delta)
+{
+#ifdef _MSC_VER
+    return (int)_InterlockedExchangeAdd((volatile long*)Value, (long)Delta) + Delta;
+#else
+    return __atomic_add_fetch(Value, Delta, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Memory aligned to Alignment, a power of two, free it with CcAlignedFree
+void* CcAlignedAlloc(size_t Size, size_t Alignment);
+void CcAlignedFree(void *Memory);
+
+// Reader-writer lock, SRWLOCK on Windows and pthread_rwlock_t elsewhere. Not recursive.
+// The OS types stay in ccplatform.c, so this header does not pull in <windows.h> or
+// <pthread.h>: an SRWLOCK is the size of a pointer and is kept in Handle, the pthread
+// objects are allocated by the Init functions and freed by the Destroy ones.
+typedef struct _CC_RWLOCK {
+    void *Handle;
+} CC_RWLOCK;
+
+// Returns -1 if the lock cannot be created
+int CcRwLockInit(CC_RWLOCK *Lock);
+void CcRwLockDestroy(CC_RWLOCK *Lock);
+void CcRwLockAcquireShared(CC_RWLOCK *Lock);
+void CcRwLockReleaseShared(CC_RWLOCK *Lock);
+void CcRwLockAcquireExclusive(CC_RWLOCK *Lock);
+void CcRwLockReleaseExclusive(CC_RWLOCK *Lock);
+
+// Mutex and condition variable for threads that have to sleep until some state changes,
+// SRWLOCK + CONDITION_VARIABLE on Windows and pthread_mutex_t + pthread_cond_t elsewhere,
+// kept the same way as in CC_RWLOCK
+typedef struct _CC_MUTEX {
+    void *Handle;
+} CC_MUTEX;
+
+typedef struct _CC_CONDITION {
+    void *Handle;
+} CC_CONDITION;
+
+int CcMutexInit(CC_MUTEX *Mutex);
+void CcMutexDestroy(CC_MUTEX *Mutex);
+void CcMutexAcquire(CC_MUTEX *Mutex);
+void CcMutexRelease(CC_MUTEX *Mutex);
+
+int CcConditionInit(CC_CONDITION *Condition);
+void CcConditionDestroy(CC_CONDITION *Condition);
+
+// Releases Mutex, sleeps until the condition is signaled and acquires Mutex again.
+// May also return without a signal, the caller checks its state in a loop.
+void CcConditionWait(CC_CONDITION *Condition, CC_MUTEX *Mutex);
+
+// Wakes one or all of the threads waiting on Condition
+void CcConditionSignal(CC_CONDITION *Condition);
+void CcConditionBroadcast(CC_CONDITION *Condition);
+
+// Threads run Routine(Context) and are waited for with CcThreadJoin
+typedef void (*CC_THREAD_ROUTINE)(void *Context);
+
+// The thread HANDLE on Windows, an allocated pthread_t elsewhere
+typedef struct _CC_THREAD *CC_THREAD;
+
+// Returns -1 if the thread could not be started
+int CcThreadCreate(CC_THREAD *Thread, CC_THREAD_ROUTINE Routine, void *Context);
+
+// Waits for Thread to end and releases it
+int CcThreadJoin(CC_THREAD Thread);
+
+// Number of logical processors, at least 1
+int CcGetProcessorCount(void);
+
+// Maps a whole file read-only. Every process mapping the same file shares its pages
+// through the page cache. Returns -1 if the file cannot be opened or is empty.
+int CcMapFile(const char *Path, void **Memory, size_t *Size);
+void CcUnmapFile(void *Memory, size_t Size);
+
+// A file mapped read-write, its size changed with CcResizeMappedFile. Stores through
+// Memory reach the page cache at once and the disk when the system writes them back or
+// on CcSyncMappedFile. Memory is NULL while the file is empty.
+typedef struct _CC_MAPPED_FILE {
+    void *Memory;
+    size_t Size;
+    intptr_t File;      //HANDLE on Windows, file descriptor elsewhere
+} CC_MAPPED_FILE;
+
+// Opens Path, or creates it empty, and maps it whole
+int CcOpenMappedFile(const char *Path, CC_MAPPED_FILE *File);
+
+// Sets the file size to Size bytes and maps it again, Memory may move. The file grows
+// with ftruncate and the mapping with mremap on Linux, without copying the pages.
+// Returns -1 if the file or the mapping cannot change, File is then left as it was.
+int CcResizeMappedFile(CC_MAPPED_FILE *File, size_t Size);
+
+// Writes the changed pages to the disk and waits for them
+int CcSyncMappedFile(CC_MAPPED_FILE *File);
+
+// How the mapping is going to be read, passed to madvise. Sequential access reads far
+// ahead and drops the pages behind, random access reads single pages. Windows has no
+// such hint for mappings, it is ignored there.
+#define CC_ACCESS_NORMAL        0
+#define CC_ACCESS_SEQUENTIAL    1
+#define CC_ACCESS_RANDOM        2
+
+int CcAdviseMappedFile(CC_MAPPED_FILE *File, int Access);
+void CcCloseMappedFile(CC_MAPPED_FILE *File);
+
+// Physical memory of the machine in bytes, 0 if unknown
+unsigned long long CcGetPhysicalMemory(void);
@@ -0,0 +1,420 @@
+#include "ccsort.h"
+#include "ccplatform.h"
+#include <stdlib.h>
+#include <string.h>
+
+// The introsort is instantiated for both orders, so the comparison is a single
+// instruction instead of a test of Descending
+SRT_DEFINE_INTROSORT(Ascending, int, SRT_LESS, 0)
+SRT_DEFINE_INTROSORT(Descending, int, SRT_LESS, 1)
+
+void SrtIntroSort(int* Array, int Count, int Descending)
+{
+    if (Array == NULL || Count < 2)
+    {
+        return;
+    }
+
+    if (Descending)
+    {
+        SrtIntroSortDescending(Array, Count, SrtIntroDepth(Count));
+    }
+    else
+    {
+        SrtIntroSortAscending(Array, Count, SrtIntroDepth(Count));
+    }
+}
+
+// Radix sorts between Array and Buffer, returns the one the sorted elements ended in
+static int* RadixSortPasses(int* Array, int* Buffer, int Count, int Descending)
+{
+    unsigned int counts[4][256];
+    //the sign bit is flipped so negative values sort first, descending flips every other bit instead
+    unsigned int flip = Descending ? 0x7FFFFFFFu : 0x80000000u;
+    int* source = Array;
+    int* target = Buffer;
+
+    //one pass counts the bytes of all four digits
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < Count; i++)
+    {
+        unsigned int key = (unsigned int)Array[i] ^ flip;
+
+        counts[0][key & 0xFF]++;
+        counts[1][(key >> 8) & 0xFF]++;
+        counts[2][(key >> 16) & 0xFF]++;
+        counts[3][key >> 24]++;
+    }
+
+    for (int pass = 0; pass < 4; pass++)
+    {
+        unsigned int offsets[256];
+        unsigned int offset = 0;
+        int shift = pass * 8;
+        int* swapped;
+
+        //every element has the same byte here, the pass would not move anything
+        if (counts[pass][(((unsigned int)source[0] ^ flip) >> shift) & 0xFF] == (unsigned int)Count)
+        {
+            continue;
+        }
+
+        for (int digit = 0; digit < 256; digit++)
+        {
+            offsets[digit] = offset;
+            offset += counts[pass][digit];
+        }
+        for (int i = 0; i < Count; i++)
+        {
+            target[offsets[(((unsigned int)source[i] ^ flip) >> shift) & 0xFF]++] = source[i];
+        }
+
+        swapped = source;
+        source = target;
+        target = swapped;
+    }
+    return source;
+}
+
+int SrtRadixSort(int* Array, int Count, int Descending, int* Buffer)
+{
+    int* buffer = Buffer;
+    int* sorted;
+
+    if (Array == NULL || Count < 2)
+    {
+        return 0;
+    }
+    if (buffer == NULL)
+    {
+        buffer = (int*)malloc(sizeof(int) * (size_t)Count);
+        if (buffer == NULL)
+        {
+            return -1;
+        }
+    }
+
+    sorted = RadixSortPasses(Array, buffer, Count, Descending);
+    if (sorted != Array)
+    {
+        memcpy(Array, sorted, sizeof(int) * (size_t)Count);
+    }
+    if (Buffer == NULL)
+    {
+        free(buffer);
+    }
+    return 0;
+}
+
+// Returns 1 if Array is already sorted, -1 if it is sorted in the other order, 0 otherwise.
+// Unsorted input usually stops both scans within a few elements.
+static int FindOrder(int* Array, int Count, int Descending)
+{
+    int inOrder = 1;
+    int reversed = 1;
+
+    for (int i = 1; i < Count && (inOrder || reversed); i++)
+    {
+        if (Array[i - 1] != Array[i])
+        {
+            if ((Array[i - 1] > Array[i]) == (Descending != 0))
+            {
+                reversed = 0;
+            }
+            else
+            {
+                inOrder = 0;
+            }
+        }
+    }
+    return inOrder ? 1 : reversed ? -1 : 0;
+}
+
+void SrtSortInts(int* Array, int Count, int Descending)
+{
+    int order;
+
+    if (Array == NULL || Count < 2)
+    {
+        return;
+    }
+
+    order = FindOrder(Array, Count, Descending);
+    if (order == 1)
+    {
+        return;
+    }
+    if (order == -1)
+    {
+        for (int i = 0, j = Count - 1; i < j; i++, j--)
+        {
+            SrtSwapAscending(Array, i, j);
+        }
+        return;
+    }
+
+    if (Count >= SRT_RADIX_LIMIT && SrtRadixSort(Array, Count, Descending, NULL) == 0)
+    {
+        return;
+    }
+    SrtIntroSort(Array, Count, Descending);
+}
+
+typedef struct _SRT_PARALLEL_SORT {
+    int* Array;
+    int* Buffer;
+    unsigned char* Buckets;     //bucket of every element of Array, found while counting
+    int Count;
+    int Descending;
+    int ThreadCount;
+    int* Splitters;             //ascending, no duplicates
+    int SplitterCount;
+    int BucketCount;            //2 * SplitterCount + 1
+    int* Offsets;               //per thread and bucket, where the thread writes its next element
+    int* BucketStart;           //start of every bucket in memory order and Count, BucketCount + 1 of them
+    volatile long NextBucket;
+} SRT_PARALLEL_SORT;
+
+typedef struct _SRT_PARALLEL_TASK {
+    SRT_PARALLEL_SORT* Sort;
+    int Thread;
+} SRT_PARALLEL_TASK;
+
+// Bucket 2 i holds the values between splitters i - 1 and i, bucket 2 i + 1 the
+// values equal to splitter i. The search runs the same number of steps for every
+// value and moves by arithmetic instead of a branch that random values would
+// mispredict half of the time.
+static __inline int FindBucket(const int* Splitters, int SplitterCount, int Value)
+{
+    const int* base = Splitters;
+    int count = SplitterCount;
+
+    while (count > 1)
+    {
+        int half = count / 2;
+
+        base += (base[half - 1] < Value) * half;
+        count -= half;
+    }
+    return 2 * (int)(base - Splitters) + 2 * (*base < Value) + (*base == Value);
+}
+
+static void CountBuckets(void* Context)
+{
+    SRT_PARALLEL_TASK* task = (SRT_PARALLEL_TASK*)Context;
+    SRT_PARALLEL_SORT* sort = task->Sort;
+    const int* splitters = sort->Splitters;
+    const int* array = sort->Array;
+    unsigned char* buckets = sort->Buckets;
+    int splitterCount = sort->SplitterCount;
+    int* counts = sort->Offsets + (size_t)task->Thread * (size_t)sort->BucketCount;
+    int end = (int)((long long)sort->Count * (task->Thread + 1) / sort->ThreadCount);
+
+    for (int i = (int)((long long)sort->Count * task->Thread / sort->ThreadCount); i < end; i++)
+    {
+        int bucket = FindBucket(splitters, splitterCount, array[i]);
+
+        buckets[i] = (unsigned char)bucket;
+        counts[bucket]++;
+    }
+}
+
+static void ScatterBuckets(void* Context)
+{
+    SRT_PARALLEL_TASK* task = (SRT_PARALLEL_TASK*)Context;
+    SRT_PARALLEL_SORT* sort = task->Sort;
+    const int* array = sort->Array;
+    const unsigned char* buckets = sort->Buckets;
+    int* buffer = sort->Buffer;
+    int* offsets = sort->Offsets + (size_t)task->Thread * (size_t)sort->BucketCount;
+    int end = (int)((long long)sort->Count * (task->Thread + 1) / sort->ThreadCount);
+
+    for (int i = (int)((long long)sort->Count * task->Thread / sort->ThreadCount); i < end; i++)
+    {
+        buffer[offsets[buckets[i]]++] = array[i];
+    }
+}
+
+// Takes buckets until none is left and sorts each from Buffer back into Array. The
+// bucket count is odd, the buckets of equal values stay at odd positions when descending.
+static void SortBuckets(void* Context)
+{
+    SRT_PARALLEL_TASK* task = (SRT_PARALLEL_TASK*)Context;
+    SRT_PARALLEL_SORT* sort = task->Sort;
+
+    for (;;)
+    {
+        int bucket = (int)CcAtomicIncrement(&sort->NextBucket) - 1;
+        int start;
+        int count;
+
+        if (bucket >= sort->BucketCount)
+        {
+            return;
+        }
+        start = sort->BucketStart[bucket];
+        count = sort->BucketStart[bucket + 1] - start;
+
+        //the radix sort uses the same range of Array as its buffer
+        if (bucket % 2 == 0 && count >= SRT_RADIX_LIMIT)
+        {
+            int* sorted = RadixSortPasses(sort->Buffer + start, sort->Array + start, count, sort->Descending);
+
+            if (sorted != sort->Array + start)
+            {
+                memcpy(sort->Array + start, sorted, sizeof(int) * (size_t)count);
+            }
+            continue;
+        }
+        memcpy(sort->Array + start, sort->Buffer + start, sizeof(int) * (size_t)count);
+        if (bucket % 2 == 0)
+        {
+            SrtIntroSort(sort->Array + start, count, sort->Descending);
+        }
+    }
+}
+
+// Runs Routine once per thread of Sort on the pool, or on this thread if it cannot be queued
+static void RunParallel(CC_TASK_POOL* Pool, SRT_PARALLEL_SORT* Sort, SRT_PARALLEL_TASK* Tasks, CC_THREAD_ROUTINE Routine)
+{
+    CC_TASK_GROUP group = { 0 };
+
+    for (int i = 0; i < Sort->ThreadCount; i++)
+    {
+        if (TpSubmit(Pool, &group, Routine, &Tasks[i]) != 0)
+        {
+            Routine(&Tasks[i]);
+        }
+    }
+    TpWait(Pool, &group);
+}
+
+// Splitters from a sorted sample spread over the whole array, duplicates dropped
+static int PickSplitters(SRT_PARALLEL_SORT* Sort)
+{
+    int wanted = Sort->ThreadCount * SRT_PARALLEL_BUCKETS_PER_THREAD - 1;
+    int sampleCount = (wanted + 1) * SRT_PARALLEL_OVERSAMPLING;
+    int* sample = (int*)malloc(sizeof(int) * (size_t)sampleCount);
+    unsigned int seed = 0x9E3779B9u;
+
+    if (sample == NULL)
+    {
+        return -1;
+    }
+
+    //a fixed seed, the same input is always cut the same way
+    for (int i = 0; i < sampleCount; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        sample[i] = Sort->Array[(int)(((unsigned long long)seed * (unsigned int)Sort->Count) >> 32)];
+    }
+    SrtIntroSort(sample, sampleCount, 0);
+
+    Sort->SplitterCount = 0;
+    for (int i = 1; i <= wanted; i++)
+    {
+        int splitter = sample[i * SRT_PARALLEL_OVERSAMPLING - 1];
+
+        if (Sort->SplitterCount == 0 || Sort->Splitters[Sort->SplitterCount - 1] != splitter)
+        {
+            Sort->Splitters[Sort->SplitterCount] = splitter;
+            Sort->SplitterCount += 1;
+        }
+    }
+    Sort->BucketCount = 2 * Sort->SplitterCount + 1;
+    free(sample);
+    return 0;
+}
+
+// Turns the counts of every thread into the position of its first element in each
+// bucket. Descending sorts place the buckets from the last one down, BucketStart is in
+// the order of the buckets in memory.
+static void ComputeOffsets(SRT_PARALLEL_SORT* Sort)
+{
+    int position = 0;
+
+    for (int i = 0; i < Sort->BucketCount; i++)
+    {
+        int bucket = Sort->Descending ? Sort->BucketCount - 1 - i : i;
+
+        Sort->BucketStart[i] = position;
+        for (int thread = 0; thread < Sort->ThreadCount; thread++)
+        {
+            int* offset = &Sort->Offsets[(size_t)thread * (size_t)Sort->BucketCount + (size_t)bucket];
+            int count = *offset;
+
+            *offset = position;
+            position += count;
+        }
+    }
+    Sort->BucketStart[Sort->BucketCount] = Sort->Count;
+}
+
+int SrtSortIntsParallel(int* Array, int Count, int Descending, int ThreadCount)
+{
+    SRT_PARALLEL_SORT sort;
+    SRT_PARALLEL_TASK tasks[SRT_PARALLEL_MAX_THREADS];
+    CC_TASK_POOL* pool;
+    int maxBuckets;
+
+    if ((Array == NULL && Count > 0) || Count < 0 || ThreadCount < 1)
+    {
+        return -1;
+    }
+
+    if (ThreadCount > SRT_PARALLEL_MAX_THREADS)
+    {
+        ThreadCount = SRT_PARALLEL_MAX_THREADS;
+    }
+    if (ThreadCount > Count / SRT_PARALLEL_MIN_CHUNK)
+    {
+        ThreadCount = Count / SRT_PARALLEL_MIN_CHUNK;
+    }
+    pool = ThreadCount > 1 ? TpGetSharedPool() : NULL;
+    //more tasks than the pool runs at once would only add buckets to count
+    if (pool != NULL && ThreadCount > pool->ThreadCount + 1)
+    {
+        ThreadCount = pool->ThreadCount + 1;
+    }
+    if (pool == NULL || ThreadCount < 2 || FindOrder(Array, Count, Descending) != 0)
+    {
+        SrtSortInts(Array, Count, Descending);
+        return 0;
+    }
+
+    memset(&sort, 0, sizeof(sort));
+    sort.Array = Array;
+    sort.Count = Count;
+    sort.Descending = Descending;
+    sort.ThreadCount = ThreadCount;
+    maxBuckets = 2 * ThreadCount * SRT_PARALLEL_BUCKETS_PER_THREAD;
+    sort.Buffer = (int*)malloc(sizeof(int) * (size_t)Count);
+    sort.Buckets = (unsigned char*)malloc((size_t)Count);
+    sort.Splitters = (int*)malloc(sizeof(int) * (size_t)maxBuckets);
+    sort.Offsets = (int*)calloc((size_t)ThreadCount * (size_t)maxBuckets, sizeof(int));
+    sort.BucketStart = (int*)malloc(sizeof(int) * (size_t)(maxBuckets + 1));
+    if (sort.Buffer == NULL || sort.Buckets == NULL || sort.Splitters == NULL || sort.Offsets == NULL || sort.BucketStart == NULL
+        || PickSplitters(&sort) != 0)
+    {
+        SrtSortInts(Array, Count, Descending);
+        goto cleanup;
+    }
+
+    for (int i = 0; i < ThreadCount; i++)
+    {
+        tasks[i].Sort = &sort;
+        tasks[i].Thread = i;
+    }
+    RunParallel(pool, &sort, tasks, CountBuckets);
+    ComputeOffsets(&sort);
+    RunParallel(pool, &sort, tasks, ScatterBuckets);
+    RunParallel(pool, &sort, tasks, SortBuckets);
+
+cleanup:
+    free(sort.Buffer);
+    free(sort.Buckets);
+    free(sort.Splitters);
+    free(sort.Offsets);
+    free(sort.BucketStart);
+    return 0;
+}
@@ -0,0 +1,211 @@
+#pragma once
+#include "cctaskpool.h"
+
+// Sorting of int arrays, the engine behind VecSort. Descending is the order VecSort
+// always had. Every function sorts in place and never recurses deeper than log2(Count).
+
+// Below this many elements a range is finished with an insertion sort
+#define SRT_INSERTION_SORT_LIMIT    16
+
+// From this many elements the quicksort pivot is the ninther (median of three medians
+// of three) instead of the median of the first, middle and last elements
+#define SRT_NINTHER_LIMIT           128
+
+// From this many elements SrtSortInts picks the radix sort. Measured from a cold cache,
+// the radix sort catches up with the introsort at 64 random or 128 almost sorted
+// elements and is ahead on any input from 256, below that its four passes over the
+// digit counts cost more than the introsort saves.
+#define SRT_RADIX_LIMIT             256
+
+// The default comparator of the templates, true when A goes before B
+#define SRT_LESS(A, B)  ((A) < (B))
+
+// Quicksort levels SrtIntroSort##Suffix goes down before it turns to the heapsort
+static __inline int SrtIntroDepth(int Count)
+{
+    int depth = 0;
+
+    for (int count = Count; count > 1; count /= 2)
+    {
+        depth += 2;
+    }
+    return depth;
+}
+
+// Defines SrtIntroSort##Suffix(Type* Array, int Count, int Depth), the introsort of
+// SrtIntroSort for arrays of Type, with Depth from SrtIntroDepth. Less(A, B) is an
+// expression or function of two Type values, true when A goes before B; with Reverse 1
+// the order is the other way around. Both are known at compile time, every comparison
+// is inlined and elements are moved by assignment, never through a void pointer.
+#define SRT_DEFINE_INTROSORT(Suffix, Type, Less, Reverse)                                           \
+static __inline int SrtFirst##Suffix(const Type* A, const Type* B)                                  \
+{                                                                                                   \
+    return (Reverse) ? Less(*B, *A) : Less(*A, *B);                                                 \
+}                                                                                                   \
+                                                                                                    \
+static __inline void SrtSwap##Suffix(Type* Array, int I, int J)                                     \
+{                                                                                                   \
+    Type swapped = Array[I];                                                                        \
+    Array[I] = Array[J];                                                                            \
+    Array[J] = swapped;                                                                             \
+}                                                                                                   \
+                                                                                                    \
+static __inline void SrtInsertionSort##Suffix(Type* Array, int Count)                               \
+{                                                                                                   \
+    for (int i = 1; i < Count; i++)                                                                 \
+    {                                                                                               \
+        Type value = Array[i];                                                                      \
+        int j = i;                                                                                  \
+                                                                                                    \
+        while (j > 0 && SrtFirst##Suffix(&value, &Array[j - 1]))                                    \
+        {                                                                                           \
+            Array[j] = Array[j - 1];                                                                \
+            j--;                                                                                    \
+        }                                                                                           \
+        Array[j] = value;                                                                           \
+    }                                                                                               \
+}                                                                                                   \
+                                                                                                    \
+/* The root of the heap is the element that goes last */                                            \
+static __inline void SrtSiftDown##Suffix(Type* Array, int Root, int Count)                          \
+{                                                                                                   \
+    for (int child = 2 * Root + 1; child < Count; child = 2 * Root + 1)                             \
+    {                                                                                               \
+        if (child + 1 < Count && SrtFirst##Suffix(&Array[child], &Array[child + 1]))                \
+        {                                                                                           \
+            child++;                                                                                \
+        }                                                                                           \
+        if (!SrtFirst##Suffix(&Array[Root], &Array[child]))                                         \
+        {                                                                                           \
+            return;                                                                                 \
+        }                                                                                           \
+        SrtSwap##Suffix(Array, Root, child);                                                        \
+        Root = child;                                                                               \
+    }                                                                                               \
+}                                                                                                   \
+                                                                                                    \
+static __inline void SrtHeapSort##Suffix(Type* Array, int Count)                                    \
+{                                                                                                   \
+    for (int i = Count / 2 - 1; i >= 0; i--)                                                        \
+    {                                                                                               \
+        SrtSiftDown##Suffix(Array, i, Count);                                                       \
+    }                                                                                               \
+    for (int end = Count - 1; end > 0; end--)                                                       \
+    {                                                                                               \
+        SrtSwap##Suffix(Array, 0, end);                                                             \
+        SrtSiftDown##Suffix(Array, 0, end);                                                         \
+    }                                                                                               \
+}                                                                                                   \
+                                                                                                    \
+static __inline int SrtMedian3##Suffix(Type* Array, int A, int B, int C)                            \
+{                                                                                                   \
+    if (SrtFirst##Suffix(&Array[B], &Array[A]))                                                     \
+    {                                                                                               \
+        int swapped = A; A = B; B = swapped;                                                        \
+    }                                                                                               \
+    if (SrtFirst##Suffix(&Array[C], &Array[B]))                                                     \
+    {                                                                                               \
+        B = SrtFirst##Suffix(&Array[C], &Array[A]) ? A : C;                                         \
+    }                                                                                               \
+    return B;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int SrtPivot##Suffix(Type* Array, int Count)                                        \
+{                                                                                                   \
+    int middle = Count / 2;                                                                         \
+    int step = Count / 8;                                                                           \
+                                                                                                    \
+    if (Count < SRT_NINTHER_LIMIT)                                                                  \
+    {                                                                                               \
+        return SrtMedian3##Suffix(Array, 0, middle, Count - 1);                                     \
+    }                                                                                               \
+    return SrtMedian3##Suffix(Array,                                                                \
+        SrtMedian3##Suffix(Array, 0, step, 2 * step),                                               \
+        SrtMedian3##Suffix(Array, middle - step, middle, middle + step),                            \
+        SrtMedian3##Suffix(Array, Count - 1 - 2 * step, Count - 1 - step, Count - 1));              \
+}                                                                                                   \
+                                                                                                    \
+/* Loops on the larger partition and recurses on the smaller one only */                            \
+static __inline void SrtIntroSort##Suffix(Type* Array, int Count, int Depth)                        \
+{                                                                                                   \
+    while (Count > SRT_INSERTION_SORT_LIMIT)                                                        \
+    {                                                                                               \
+        Type pivot;                                                                                 \
+        int i = -1;                                                                                 \
+        int j = Count;                                                                              \
+                                                                                                    \
+        if (Depth == 0)                                                                             \
+        {                                                                                           \
+            SrtHeapSort##Suffix(Array, Count);                                                      \
+            return;                                                                                 \
+        }                                                                                           \
+        Depth--;                                                                                    \
+                                                                                                    \
+        /* Hoare partition with the pivot moved first, j always stops before the end */             \
+        SrtSwap##Suffix(Array, 0, SrtPivot##Suffix(Array, Count));                                  \
+        pivot = Array[0];                                                                           \
+        for (;;)                                                                                    \
+        {                                                                                           \
+            do { i++; } while (SrtFirst##Suffix(&Array[i], &pivot));                                \
+            do { j--; } while (SrtFirst##Suffix(&pivot, &Array[j]));                                \
+            if (i >= j)                                                                             \
+            {                                                                                       \
+                break;                                                                              \
+            }                                                                                       \
+            SrtSwap##Suffix(Array, i, j);                                                           \
+        }                                                                                           \
+                                                                                                    \
+        /* [0, j] and [j + 1, Count) */                                                             \
+        if (j + 1 < Count - j - 1)                                                                  \
+        {                                                                                           \
+            SrtIntroSort##Suffix(Array, j + 1, Depth);                                              \
+            Array += j + 1;                                                                         \
+            Count -= j + 1;                                                                         \
+        }                                                                                           \
+        else                                                                                        \
+        {                                                                                           \
+            SrtIntroSort##Suffix(Array + j + 1, Count - j - 1, Depth);                              \
+            Count = j + 1;                                                                          \
+        }                                                                                           \
+    }                                                                                               \
+    SrtInsertionSort##Suffix(Array, Count);                                                         \
+}
+
+// Picks the radix sort for large arrays and the introsort for the others, or when the
+// radix sort buffer cannot be allocated. Arrays already in order, or in the reverse
+// order, are found by a first scan and only reversed at most.
+void SrtSortInts(int *Array, int Count, int Descending);
+
+// Quicksort with median of three or ninther pivots that turns to a heapsort when the
+// partitions get too unbalanced, O(n log n) on any input. Not stable.
+void SrtIntroSort(int *Array, int Count, int Descending);
+
+// LSD radix sort, one byte per pass, passes on bytes that all the elements share are
+// skipped. Buffer needs room for Count ints, NULL to have one allocated.
+// Returns -1 if Buffer is NULL and could not be allocated, Array is then unchanged
+int SrtRadixSort(int *Array, int Count, int Descending, int *Buffer);
+
+// SrtSortIntsParallel splits the work so each thread gets at least this many elements,
+// smaller arrays are sorted by fewer threads or by SrtSortInts
+#define SRT_PARALLEL_MIN_CHUNK              (1 << 15)
+#define SRT_PARALLEL_MAX_THREADS            32
+
+// Buckets per thread, the threads pick the next bucket when done with one so a few
+// more buckets than threads even out their sizes. With the equal value buckets there
+// are at most 2 * 32 * 4 - 1, the bucket of an element fits a byte.
+#define SRT_PARALLEL_BUCKETS_PER_THREAD     4
+
+// Sample elements per splitter
+#define SRT_PARALLEL_OVERSAMPLING           32
+
+// Sample sort on the shared task pool (see TpGetSharedPool) with up to ThreadCount
+// threads, no more than the pool has plus the caller. Splitters taken from a sample
+// cut the values into buckets, each thread counts then moves its part of Array to the
+// buckets in a buffer, then the threads sort the buckets back into Array. Values equal
+// to a splitter get a bucket that needs no sort, so few distinct values do not end up
+// in one huge bucket. The only large allocations are the buffer of Count ints and the
+// bucket of every element, one byte each, whatever the thread count.
+// Same result as SrtSortInts, which sorts Array instead if the buffers cannot be
+// allocated or only one thread would be used.
+// Returns -1 if the parameters are invalid
+int SrtSortIntsParallel(int *Array, int Count, int Descending, int ThreadCount);
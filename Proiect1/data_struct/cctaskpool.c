@@ -0,0 +1,246 @@
+#include "cctaskpool.h"
+#include <stdlib.h>
+#include <string.h>
+
+static CC_TASK_POOL* volatile gSharedPool = NULL;
+
+// Takes the oldest task, the pool lock is held
+static CC_TASK PopTask(CC_TASK_POOL* Pool)
+{
+    CC_TASK task = Pool->Queue[Pool->QueueHead];
+
+    Pool->QueueHead = (Pool->QueueHead + 1) % Pool->QueueSize;
+    Pool->QueueCount -= 1;
+    return task;
+}
+
+// Runs Task without the pool lock and marks it finished, the pool lock is held
+static void RunTask(CC_TASK_POOL* Pool, CC_TASK Task)
+{
+    CcMutexRelease(&Pool->Lock);
+    Task.Routine(Task.Context);
+    CcMutexAcquire(&Pool->Lock);
+
+    Task.Group->Pending -= 1;
+    if (Task.Group->Pending == 0)
+    {
+        CcConditionBroadcast(&Pool->TaskDone);
+    }
+}
+
+static void WorkerThread(void* Context)
+{
+    CC_TASK_POOL* pool = (CC_TASK_POOL*)Context;
+
+    CcMutexAcquire(&pool->Lock);
+    for (;;)
+    {
+        while (pool->QueueCount == 0 && !pool->Stopping)
+        {
+            CcConditionWait(&pool->TaskQueued, &pool->Lock);
+        }
+        //the queue is drained before stopping
+        if (pool->QueueCount == 0)
+        {
+            break;
+        }
+        RunTask(pool, PopTask(pool));
+    }
+    CcMutexRelease(&pool->Lock);
+}
+
+// Doubles the queue, unwrapping it at the same time, the pool lock is held
+static int GrowQueue(CC_TASK_POOL* Pool)
+{
+    int size = Pool->QueueSize == 0 ? TP_INITIAL_QUEUE_SIZE : Pool->QueueSize * 2;
+    CC_TASK* queue = (CC_TASK*)malloc(sizeof(CC_TASK) * (size_t)size);
+
+    if (queue == NULL)
+    {
+        return -1;
+    }
+    for (int i = 0; i < Pool->QueueCount; i++)
+    {
+        queue[i] = Pool->Queue[(Pool->QueueHead + i) % Pool->QueueSize];
+    }
+    free(Pool->Queue);
+    Pool->Queue = queue;
+    Pool->QueueSize = size;
+    Pool->QueueHead = 0;
+    return 0;
+}
+
+// Stops and joins the first Count threads
+static void StopThreads(CC_TASK_POOL* Pool, int Count)
+{
+    CcMutexAcquire(&Pool->Lock);
+    Pool->Stopping = 1;
+    CcConditionBroadcast(&Pool->TaskQueued);
+    CcMutexRelease(&Pool->Lock);
+
+    for (int i = 0; i < Count; i++)
+    {
+        CcThreadJoin(Pool->Threads[i]);
+    }
+}
+
+static void FreePool(CC_TASK_POOL* Pool)
+{
+    CcConditionDestroy(&Pool->TaskDone);
+    CcConditionDestroy(&Pool->TaskQueued);
+    CcMutexDestroy(&Pool->Lock);
+    free(Pool->Threads);
+    free(Pool->Queue);
+    free(Pool);
+}
+
+int TpCreate(CC_TASK_POOL** Pool, int ThreadCount)
+{
+    CC_TASK_POOL* pool;
+
+    if (Pool == NULL || ThreadCount < 0)
+    {
+        return -1;
+    }
+
+    pool = (CC_TASK_POOL*)malloc(sizeof(CC_TASK_POOL));
+    if (pool == NULL)
+    {
+        return -1;
+    }
+    memset(pool, 0, sizeof(*pool));
+
+    if (CcMutexInit(&pool->Lock) != 0)
+    {
+        free(pool);
+        return -1;
+    }
+    if (CcConditionInit(&pool->TaskQueued) != 0)
+    {
+        CcMutexDestroy(&pool->Lock);
+        free(pool);
+        return -1;
+    }
+    if (CcConditionInit(&pool->TaskDone) != 0)
+    {
+        CcConditionDestroy(&pool->TaskQueued);
+        CcMutexDestroy(&pool->Lock);
+        free(pool);
+        return -1;
+    }
+
+    pool->Threads = (CC_THREAD*)malloc(sizeof(CC_THREAD) * (size_t)(ThreadCount + 1));
+    if (pool->Threads == NULL || GrowQueue(pool) != 0)
+    {
+        FreePool(pool);
+        return -1;
+    }
+    for (int i = 0; i < ThreadCount; i++)
+    {
+        if (CcThreadCreate(&pool->Threads[i], WorkerThread, pool) != 0)
+        {
+            StopThreads(pool, i);
+            FreePool(pool);
+            return -1;
+        }
+    }
+    pool->ThreadCount = ThreadCount;
+
+    *Pool = pool;
+    return 0;
+}
+
+int TpDestroy(CC_TASK_POOL** Pool)
+{
+    if (Pool == NULL || *Pool == NULL)
+    {
+        return -1;
+    }
+
+    StopThreads(*Pool, (*Pool)->ThreadCount);
+    FreePool(*Pool);
+    *Pool = NULL;
+    return 0;
+}
+
+CC_TASK_POOL* TpGetSharedPool(void)
+{
+    CC_TASK_POOL* pool = (CC_TASK_POOL*)CcAtomicLoadPointer((void* volatile*)&gSharedPool);
+
+    if (pool != NULL)
+    {
+        return pool;
+    }
+    if (TpCreate(&pool, CcGetProcessorCount() - 1) != 0)
+    {
+        return NULL;
+    }
+
+    //another thread may have created one first, then ours is not needed
+    if (CcAtomicCompareExchangePointer((void* volatile*)&gSharedPool, pool, NULL) != NULL)
+    {
+        TpDestroy(&pool);
+    }
+    return (CC_TASK_POOL*)CcAtomicLoadPointer((void* volatile*)&gSharedPool);
+}
+
+void TpReleaseSharedPool(void)
+{
+    CC_TASK_POOL* pool = (CC_TASK_POOL*)CcAtomicCompareExchangePointer((void* volatile*)&gSharedPool, NULL, gSharedPool);
+
+    if (pool != NULL)
+    {
+        TpDestroy(&pool);
+    }
+}
+
+int TpSubmit(CC_TASK_POOL* Pool, CC_TASK_GROUP* Group, CC_THREAD_ROUTINE Routine, void* Context)
+{
+    CC_TASK* task;
+
+    if (Pool == NULL || Group == NULL || Routine == NULL)
+    {
+        return -1;
+    }
+
+    CcMutexAcquire(&Pool->Lock);
+    if (Pool->QueueCount == Pool->QueueSize && GrowQueue(Pool) != 0)
+    {
+        CcMutexRelease(&Pool->Lock);
+        return -1;
+    }
+
+    task = &Pool->Queue[(Pool->QueueHead + Pool->QueueCount) % Pool->QueueSize];
+    task->Routine = Routine;
+    task->Context = Context;
+    task->Group = Group;
+    Pool->QueueCount += 1;
+    Group->Pending += 1;
+    CcConditionSignal(&Pool->TaskQueued);
+    CcMutexRelease(&Pool->Lock);
+    return 0;
+}
+
+int TpWait(CC_TASK_POOL* Pool, CC_TASK_GROUP* Group)
+{
+    if (Pool == NULL || Group == NULL)
+    {
+        return -1;
+    }
+
+    CcMutexAcquire(&Pool->Lock);
+    while (Group->Pending > 0)
+    {
+        if (Pool->QueueCount > 0)
+        {
+            RunTask(Pool, PopTask(Pool));
+        }
+        else
+        {
+            //the last tasks of the group are running on other threads
+            CcConditionWait(&Pool->TaskDone, &Pool->Lock);
+        }
+    }
+    CcMutexRelease(&Pool->Lock);
+    return 0;
+}
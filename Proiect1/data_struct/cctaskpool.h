@@ -0,0 +1,56 @@
+#pragma once
+#include "ccplatform.h"
+#include "common.h"
+
+// Pool of worker threads running short tasks from one queue. The threads are started
+// once and sleep while the queue is empty, so splitting work into tasks costs a queue
+// push instead of a thread start. Tasks are submitted in a group and the submitter
+// waits for the group with TpWait, running queued tasks itself meanwhile, so a pool of
+// N threads gives N + 1 way parallelism and a pool of 0 threads runs everything on the
+// caller. Several threads may submit and wait on the same pool.
+#define TP_INITIAL_QUEUE_SIZE   64
+
+typedef struct _CC_TASK {
+    CC_THREAD_ROUTINE Routine;
+    void* Context;
+    struct _CC_TASK_GROUP* Group;
+} CC_TASK;
+
+typedef struct _CC_TASK_GROUP {
+    int Pending;                //tasks submitted and not finished yet, guarded by the pool lock
+} CC_TASK_GROUP;
+
+typedef struct _CC_TASK_POOL {
+    CC_MUTEX Lock;              //guards everything below
+    CC_CONDITION TaskQueued;    //workers sleep on it
+    CC_CONDITION TaskDone;      //TpWait sleeps on it
+    CC_TASK* Queue;             //circular, QueueSize slots
+    int QueueSize;
+    int QueueHead;
+    int QueueCount;
+    int Stopping;
+    CC_THREAD* Threads;
+    int ThreadCount;
+} CC_TASK_POOL;
+
+// Starts ThreadCount threads, 0 is valid
+int TpCreate(CC_TASK_POOL **Pool, int ThreadCount);
+
+// Waits for the queued tasks to finish and stops the threads
+int TpDestroy(CC_TASK_POOL **Pool);
+
+// Pool shared by the containers, created on the first call with one thread less than
+// there are processors. Returns NULL if it cannot be created.
+CC_TASK_POOL* TpGetSharedPool(void);
+
+// Destroys the shared pool, no task may be running on it. The next TpGetSharedPool
+// creates a new one.
+void TpReleaseSharedPool(void);
+
+// Queues Routine(Context) as part of Group, Group->Pending must be 0 for a new group
+// Returns -1 if the queue cannot grow, the task is then not run
+int TpSubmit(CC_TASK_POOL *Pool, CC_TASK_GROUP *Group, CC_THREAD_ROUTINE Routine, void *Context);
+
+// Returns when every task of Group has finished, queued tasks of any group are run on
+// the calling thread until then
+int TpWait(CC_TASK_POOL *Pool, CC_TASK_GROUP *Group);
@@ -0,0 +1,594 @@
+#pragma once
+#include "ccvector.h"
+#include "ccsort.h"
+#include "ccplatform.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+
+// Vectors of any plain data type, generated at compile time. CC_VECTOR_DEFINE(Name,
+// Type, Less) defines the struct Name, laid out like CC_VECTOR with a Type* Array, and
+// the whole Vec* API for it with Name as the prefix instead of Vec:
+//
+//      CC_VECTOR_DEFINE(CC_VECTOR_I64, long long, SRT_LESS)
+//      CC_VECTOR_I64* ids = NULL;
+//      CC_VECTOR_I64Create(&ids);
+//      CC_VECTOR_I64InsertTail(ids, 1234567890123LL);
+//
+// Every function is specialized for sizeof(Type): elements are moved by assignment or
+// memcpy of whole ranges, nothing goes through a void pointer or a function pointer.
+// Less(A, B) orders two Type values, true when A goes before B. It is inlined into the
+// sort, VecSort descending order included, and also decides which elements are equal
+// for Find and CountEqual: neither goes before the other. SRT_LESS suits the
+// arithmetic types, a struct needs its own, such as #define RECORD_LESS(A, B)
+// ((A).Id < (B).Id). Floating point NaNs compare equal to every value with SRT_LESS.
+//
+// The functions are static __inline, the macro may be used in a header included by
+// several files. Arithmetic types also get Name##Sum with CC_VECTOR_DEFINE_SUM.
+//
+// Differences with CC_VECTOR: the sorts are introsorts, the radix sort is only used by
+// CC_VECTOR; SortParallel is a merge sort of one run per thread, with equal elements
+// it may order them differently from Sort. There are no SIMD kernels, the loops are
+// left to the compiler.
+
+#define CC_VECTOR_DEFINE(Name, Type, Less)                                                          \
+typedef struct _##Name {                                                                            \
+    Type* Array;    /* NULL until the first insert, VEC_ALIGNMENT aligned */                        \
+    int Size;       /* number of elements Array has room for */                                     \
+    int Count;                                                                                      \
+} Name;                                                                                             \
+                                                                                                    \
+SRT_DEFINE_INTROSORT(Name##Ascending, Type, Less, 0)                                                \
+SRT_DEFINE_INTROSORT(Name##Descending, Type, Less, 1)                                               \
+                                                                                                    \
+static __inline int Name##pResizeArray(Name* Vector, int Size)                                      \
+{                                                                                                   \
+    Type* array;                                                                                    \
+                                                                                                    \
+    if (Size == 0)                                                                                  \
+    {                                                                                               \
+        CcAlignedFree(Vector->Array);                                                               \
+        Vector->Array = NULL;                                                                       \
+        Vector->Size = 0;                                                                           \
+        return 0;                                                                                   \
+    }                                                                                               \
+    if ((size_t)Size > SIZE_MAX / sizeof(Type))                                                     \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    array = (Type*)CcAlignedAlloc(sizeof(Type) * (size_t)Size, VEC_ALIGNMENT);                      \
+    if (NULL == array)                                                                              \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+    if (Vector->Count > 0)                                                                          \
+    {                                                                                               \
+        memcpy(array, Vector->Array, sizeof(Type) * (size_t)Vector->Count);                         \
+    }                                                                                               \
+    CcAlignedFree(Vector->Array);                                                                   \
+    Vector->Array = array;                                                                          \
+    Vector->Size = Size;                                                                            \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##pGrowArray(Name* Vector, int Count)                                       \
+{                                                                                                   \
+    int size = Vector->Size < VEC_MIN_CAPACITY ? VEC_MIN_CAPACITY : Vector->Size;                   \
+                                                                                                    \
+    if (Count > INT_MAX - Vector->Count)                                                            \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+    if (Vector->Count + Count <= Vector->Size)                                                      \
+    {                                                                                               \
+        return 0;                                                                                   \
+    }                                                                                               \
+                                                                                                    \
+    while (size < Vector->Count + Count)                                                            \
+    {                                                                                               \
+        size = size > INT_MAX / 2 ? INT_MAX : size * 2;                                             \
+    }                                                                                               \
+    return Name##pResizeArray(Vector, size);                                                        \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##pOpenGap(Name* Vector, int Index, int Count)                              \
+{                                                                                                   \
+    if (Count == 0)                                                                                 \
+    {                                                                                               \
+        return 0;                                                                                   \
+    }                                                                                               \
+    if (0 != Name##pGrowArray(Vector, Count))                                                       \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    memmove(Vector->Array + Index + Count, Vector->Array + Index, sizeof(Type) * (size_t)(Vector->Count - Index));\
+    Vector->Count += Count;                                                                         \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##CreateWithCapacity(Name** Vector, int Capacity)                           \
+{                                                                                                   \
+    Name* vector;                                                                                   \
+                                                                                                    \
+    if (NULL == Vector || Capacity < 0)                                                             \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    vector = (Name*)malloc(sizeof(Name));                                                           \
+    if (NULL == vector)                                                                             \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+    memset(vector, 0, sizeof(*vector));                                                             \
+                                                                                                    \
+    if (Capacity > 0 && 0 != Name##pResizeArray(vector, Capacity))                                  \
+    {                                                                                               \
+        free(vector);                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    *Vector = vector;                                                                               \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##Create(Name** Vector)                                                     \
+{                                                                                                   \
+    return Name##CreateWithCapacity(Vector, 0);                                                     \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##Destroy(Name** Vector)                                                    \
+{                                                                                                   \
+    if (NULL == Vector || NULL == *Vector)                                                          \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    CcAlignedFree((*Vector)->Array);                                                                \
+    free(*Vector);                                                                                  \
+    *Vector = NULL;                                                                                 \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##Reserve(Name* Vector, int Capacity)                                       \
+{                                                                                                   \
+    if (NULL == Vector || Capacity < 0)                                                             \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    if (Capacity <= Vector->Size)                                                                   \
+    {                                                                                               \
+        return 0;                                                                                   \
+    }                                                                                               \
+    return Name##pResizeArray(Vector, Capacity);                                                    \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##ShrinkToFit(Name* Vector)                                                 \
+{                                                                                                   \
+    if (NULL == Vector)                                                                             \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    if (Vector->Count == Vector->Size)                                                              \
+    {                                                                                               \
+        return 0;                                                                                   \
+    }                                                                                               \
+    return Name##pResizeArray(Vector, Vector->Count);                                               \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##InsertTail(Name* Vector, Type Value)                                      \
+{                                                                                                   \
+    if (NULL == Vector)                                                                             \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    if (Vector->Count >= Vector->Size && 0 != Name##pGrowArray(Vector, 1))                          \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    Vector->Array[Vector->Count] = Value;                                                           \
+    Vector->Count += 1;                                                                             \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##InsertRange(Name* Vector, int Index, const Type* Values, int Count)       \
+{                                                                                                   \
+    if (NULL == Vector || Index < 0 || Index > Vector->Count || Count < 0 || (NULL == Values && Count > 0))\
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    if (0 != Name##pOpenGap(Vector, Index, Count))                                                  \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+    if (Count > 0)                                                                                  \
+    {                                                                                               \
+        memcpy(Vector->Array + Index, Values, sizeof(Type) * (size_t)Count);                        \
+    }                                                                                               \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##InsertManyAt(Name* Vector, int Index, Type Value, int Count)              \
+{                                                                                                   \
+    if (NULL == Vector || Index < 0 || Index > Vector->Count || Count < 0)                          \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    if (0 != Name##pOpenGap(Vector, Index, Count))                                                  \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+    for (int i = Index; i < Index + Count; i++)                                                     \
+    {                                                                                               \
+        Vector->Array[i] = Value;                                                                   \
+    }                                                                                               \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##InsertHead(Name* Vector, Type Value)                                      \
+{                                                                                                   \
+    return Name##InsertRange(Vector, 0, &Value, 1);                                                 \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##InsertAfterIndex(Name* Vector, int Index, Type Value)                     \
+{                                                                                                   \
+    if (NULL == Vector || Index < 0 || Index >= Vector->Count)                                      \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    return Name##InsertRange(Vector, Index + 1, &Value, 1);                                         \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##RemoveRange(Name* Vector, int Index, int Count)                           \
+{                                                                                                   \
+    if (NULL == Vector || Index < 0 || Count < 0 || Count > Vector->Count - Index)                  \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+    if (Count == 0)                                                                                 \
+    {                                                                                               \
+        return 0;                                                                                   \
+    }                                                                                               \
+                                                                                                    \
+    memmove(Vector->Array + Index, Vector->Array + Index + Count, sizeof(Type) * (size_t)(Vector->Count - Index - Count));\
+    Vector->Count -= Count;                                                                         \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##RemoveByIndex(Name* Vector, int Index)                                    \
+{                                                                                                   \
+    return Name##RemoveRange(Vector, Index, 1);                                                     \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##SwapRemove(Name* Vector, int Index)                                       \
+{                                                                                                   \
+    if (NULL == Vector || Index < 0 || Index >= Vector->Count)                                      \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    Vector->Array[Index] = Vector->Array[Vector->Count - 1];                                        \
+    Vector->Count -= 1;                                                                             \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##GetValueByIndex(Name* Vector, int Index, Type* Value)                     \
+{                                                                                                   \
+    if (NULL == Vector || NULL == Value || Index < 0 || Index >= Vector->Count)                     \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    *Value = Vector->Array[Index];                                                                  \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##GetCount(Name* Vector)                                                    \
+{                                                                                                   \
+    if (NULL == Vector)                                                                             \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+    return Vector->Count;                                                                           \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##Clear(Name* Vector)                                                       \
+{                                                                                                   \
+    if (NULL == Vector)                                                                             \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    if (Vector->Count > 0)                                                                          \
+    {                                                                                               \
+        memset(Vector->Array, 0, sizeof(Type) * (size_t)Vector->Count);                             \
+    }                                                                                               \
+    Vector->Count = 0;                                                                              \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##SortEx(Name* Vector, int Order)                                           \
+{                                                                                                   \
+    if (NULL == Vector || (Order != VEC_SORT_DESCENDING && Order != VEC_SORT_ASCENDING))            \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+    if (Vector->Count < 2)                                                                          \
+    {                                                                                               \
+        return 0;                                                                                   \
+    }                                                                                               \
+                                                                                                    \
+    if (Order == VEC_SORT_DESCENDING)                                                               \
+    {                                                                                               \
+        SrtIntroSort##Name##Descending(Vector->Array, Vector->Count, SrtIntroDepth(Vector->Count)); \
+    }                                                                                               \
+    else                                                                                            \
+    {                                                                                               \
+        SrtIntroSort##Name##Ascending(Vector->Array, Vector->Count, SrtIntroDepth(Vector->Count));  \
+    }                                                                                               \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##Sort(Name* Vector)                                                        \
+{                                                                                                   \
+    return Name##SortEx(Vector, VEC_SORT_DESCENDING);                                               \
+}                                                                                                   \
+                                                                                                    \
+/* A run of Source, or two runs to merge into Target */                                             \
+typedef struct _##Name##P_SORT_TASK {                                                               \
+    Type* Source;                                                                                   \
+    Type* Target;                                                                                   \
+    int Start;                                                                                      \
+    int Middle;                                                                                     \
+    int End;                                                                                        \
+    int Descending;                                                                                 \
+} Name##P_SORT_TASK;                                                                                \
+                                                                                                    \
+static __inline void Name##pSortRun(void* Context)                                                  \
+{                                                                                                   \
+    Name##P_SORT_TASK* task = (Name##P_SORT_TASK*)Context;                                          \
+    int count = task->End - task->Start;                                                            \
+                                                                                                    \
+    if (task->Descending)                                                                           \
+    {                                                                                               \
+        SrtIntroSort##Name##Descending(task->Source + task->Start, count, SrtIntroDepth(count));    \
+    }                                                                                               \
+    else                                                                                            \
+    {                                                                                               \
+        SrtIntroSort##Name##Ascending(task->Source + task->Start, count, SrtIntroDepth(count));     \
+    }                                                                                               \
+}                                                                                                   \
+                                                                                                    \
+/* The left run wins the ties, so runs of equal elements keep their order */                        \
+static __inline void Name##pMergeRuns(void* Context)                                                \
+{                                                                                                   \
+    Name##P_SORT_TASK* task = (Name##P_SORT_TASK*)Context;                                          \
+    Type* source = task->Source;                                                                    \
+    Type* target = task->Target;                                                                    \
+    int i = task->Start;                                                                            \
+    int j = task->Middle;                                                                           \
+    int k = task->Start;                                                                            \
+                                                                                                    \
+    while (i < task->Middle && j < task->End)                                                       \
+    {                                                                                               \
+        int right = task->Descending ? SrtFirst##Name##Descending(&source[j], &source[i])           \
+            : SrtFirst##Name##Ascending(&source[j], &source[i]);                                    \
+                                                                                                    \
+        target[k++] = right ? source[j++] : source[i++];                                            \
+    }                                                                                               \
+    memcpy(target + k, source + i, sizeof(Type) * (size_t)(task->Middle - i));                      \
+    k += task->Middle - i;                                                                          \
+    memcpy(target + k, source + j, sizeof(Type) * (size_t)(task->End - j));                         \
+}                                                                                                   \
+                                                                                                    \
+/* One run per thread sorted in parallel, then merged by pairs, the last merge on one               \
+   thread. The buffer holds as many elements as the vector. */                                      \
+static __inline int Name##SortParallelEx(Name* Vector, int ThreadCount, int Order)                  \
+{                                                                                                   \
+    Name##P_SORT_TASK tasks[SRT_PARALLEL_MAX_THREADS];                                              \
+    CC_TASK_POOL* pool;                                                                             \
+    CC_TASK_GROUP group;                                                                            \
+    Type* buffer;                                                                                   \
+    Type* source;                                                                                   \
+    int runs;                                                                                       \
+                                                                                                    \
+    if (NULL == Vector || ThreadCount < 1 || (Order != VEC_SORT_DESCENDING && Order != VEC_SORT_ASCENDING))\
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    ThreadCount = ThreadCount < SRT_PARALLEL_MAX_THREADS ? ThreadCount : SRT_PARALLEL_MAX_THREADS;  \
+    ThreadCount = ThreadCount < Vector->Count / SRT_PARALLEL_MIN_CHUNK ? ThreadCount : Vector->Count / SRT_PARALLEL_MIN_CHUNK;\
+    pool = ThreadCount > 1 ? TpGetSharedPool() : NULL;                                              \
+    if (pool != NULL && ThreadCount > pool->ThreadCount + 1)                                        \
+    {                                                                                               \
+        ThreadCount = pool->ThreadCount + 1;                                                        \
+    }                                                                                               \
+    buffer = pool != NULL && ThreadCount > 1 ? (Type*)malloc(sizeof(Type) * (size_t)Vector->Count) : NULL;\
+    if (NULL == buffer)                                                                             \
+    {                                                                                               \
+        return Name##SortEx(Vector, Order);                                                         \
+    }                                                                                               \
+                                                                                                    \
+    memset(&group, 0, sizeof(group));                                                               \
+    for (int i = 0; i < ThreadCount; i++)                                                           \
+    {                                                                                               \
+        tasks[i].Source = Vector->Array;                                                            \
+        tasks[i].Target = buffer;                                                                   \
+        tasks[i].Start = (int)((long long)Vector->Count * i / ThreadCount);                         \
+        tasks[i].End = (int)((long long)Vector->Count * (i + 1) / ThreadCount);                     \
+        tasks[i].Middle = tasks[i].End;                                                             \
+        tasks[i].Descending = Order == VEC_SORT_DESCENDING;                                         \
+        if (0 != TpSubmit(pool, &group, Name##pSortRun, &tasks[i]))                                 \
+        {                                                                                           \
+            Name##pSortRun(&tasks[i]);                                                              \
+        }                                                                                           \
+    }                                                                                               \
+    TpWait(pool, &group);                                                                           \
+                                                                                                    \
+    source = Vector->Array;                                                                         \
+    for (runs = ThreadCount; runs > 1; runs = (runs + 1) / 2)                                       \
+    {                                                                                               \
+        Type* target = source == Vector->Array ? buffer : Vector->Array;                            \
+                                                                                                    \
+        /* task i merges runs 2 i and 2 i + 1, which are read before task i is written */           \
+        for (int i = 0; 2 * i < runs; i++)                                                          \
+        {                                                                                           \
+            Name##P_SORT_TASK merge = tasks[2 * i];                                                 \
+                                                                                                    \
+            merge.Source = source;                                                                  \
+            merge.Target = target;                                                                  \
+            merge.Middle = merge.End;                                                               \
+            if (2 * i + 1 < runs)                                                                   \
+            {                                                                                       \
+                merge.End = tasks[2 * i + 1].End;                                                   \
+            }                                                                                       \
+            tasks[i] = merge;                                                                       \
+            if (0 != TpSubmit(pool, &group, Name##pMergeRuns, &tasks[i]))                           \
+            {                                                                                       \
+                Name##pMergeRuns(&tasks[i]);                                                        \
+            }                                                                                       \
+        }                                                                                           \
+        TpWait(pool, &group);                                                                       \
+        source = target;                                                                            \
+    }                                                                                               \
+                                                                                                    \
+    if (source != Vector->Array)                                                                    \
+    {                                                                                               \
+        memcpy(Vector->Array, source, sizeof(Type) * (size_t)Vector->Count);                        \
+    }                                                                                               \
+    free(buffer);                                                                                   \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##SortParallel(Name* Vector, int ThreadCount)                               \
+{                                                                                                   \
+    return Name##SortParallelEx(Vector, ThreadCount, VEC_SORT_DESCENDING);                          \
+}                                                                                                   \
+                                                                                                    \
+/* Appends all the elements in DestVector to SrcVector, the same way VecAppend does */              \
+static __inline int Name##Append(Name* DestVector, Name* SrcVector)                                 \
+{                                                                                                   \
+    if (NULL == DestVector || NULL == SrcVector)                                                    \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    if (DestVector->Count == 0)                                                                     \
+    {                                                                                               \
+        return 0;                                                                                   \
+    }                                                                                               \
+    if (0 != Name##pGrowArray(SrcVector, DestVector->Count))                                        \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+    memmove(SrcVector->Array + SrcVector->Count, DestVector->Array, sizeof(Type) * (size_t)DestVector->Count);\
+    SrcVector->Count += DestVector->Count;                                                          \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##MinMax(Name* Vector, Type* Min, Type* Max)                                \
+{                                                                                                   \
+    Type min;                                                                                       \
+    Type max;                                                                                       \
+                                                                                                    \
+    if (NULL == Vector || NULL == Min || NULL == Max || Vector->Count == 0)                         \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    min = Vector->Array[0];                                                                         \
+    max = Vector->Array[0];                                                                         \
+    for (int i = 1; i < Vector->Count; i++)                                                         \
+    {                                                                                               \
+        if (Less(Vector->Array[i], min))                                                            \
+        {                                                                                           \
+            min = Vector->Array[i];                                                                 \
+        }                                                                                           \
+        if (Less(max, Vector->Array[i]))                                                            \
+        {                                                                                           \
+            max = Vector->Array[i];                                                                 \
+        }                                                                                           \
+    }                                                                                               \
+    *Min = min;                                                                                     \
+    *Max = max;                                                                                     \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##Find(Name* Vector, Type Value)                                            \
+{                                                                                                   \
+    if (NULL == Vector)                                                                             \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    for (int i = 0; i < Vector->Count; i++)                                                         \
+    {                                                                                               \
+        if (!Less(Vector->Array[i], Value) && !Less(Value, Vector->Array[i]))                       \
+        {                                                                                           \
+            return i;                                                                               \
+        }                                                                                           \
+    }                                                                                               \
+    return -1;                                                                                      \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##CountEqual(Name* Vector, Type Value)                                      \
+{                                                                                                   \
+    int count = 0;                                                                                  \
+                                                                                                    \
+    if (NULL == Vector)                                                                             \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    for (int i = 0; i < Vector->Count; i++)                                                         \
+    {                                                                                               \
+        count += !Less(Vector->Array[i], Value) && !Less(Value, Vector->Array[i]);                  \
+    }                                                                                               \
+    return count;                                                                                   \
+}                                                                                                   \
+                                                                                                    \
+static __inline int Name##FillRange(Name* Vector, int Index, int Count, Type Value)                 \
+{                                                                                                   \
+    if (NULL == Vector || Index < 0 || Count < 0 || Index > Vector->Count - Count)                  \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    for (int i = Index; i < Index + Count; i++)                                                     \
+    {                                                                                               \
+        Vector->Array[i] = Value;                                                                   \
+    }                                                                                               \
+    return 0;                                                                                       \
+}
+
+// Name##Sum(Name* Vector, SumType* Sum) for a vector of an arithmetic Type defined by
+// CC_VECTOR_DEFINE, SumType is the type the elements are added in, long long for ints
+// so the sum does not overflow
+#define CC_VECTOR_DEFINE_SUM(Name, Type, SumType)                                                   \
+static __inline int Name##Sum(Name* Vector, SumType* Sum)                                           \
+{                                                                                                   \
+    SumType sum = 0;                                                                                \
+                                                                                                    \
+    if (NULL == Vector || NULL == Sum)                                                              \
+    {                                                                                               \
+        return -1;                                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    for (int i = 0; i < Vector->Count; i++)                                                         \
+    {                                                                                               \
+        sum += (SumType)Vector->Array[i];                                                           \
+    }                                                                                               \
+    *Sum = sum;                                                                                     \
+    return 0;                                                                                       \
+}
@@ -1,15 +1,168 @@
 #include "ccvector.h"
 #include "common.h"
+#include "ccplatform.h"
+#include "ccsort.h"
 #include "string.h"
 #include <stdio.h>
+#include <limits.h>
+#include <stdint.h>
 
-#define INITIAL_SIZE  2048
+// A mapped vector file starts with this header, padded to VEC_FILE_HEADER_SIZE bytes so
+// the elements after it are VEC_ALIGNMENT aligned like an allocated array
+#define VEC_FILE_HEADER_SIZE    64
+#define VEC_FILE_MAGIC          "CCVECTOR"
+
+typedef struct _VEC_FILE_HEADER {
+    char Magic[8];
+    long long Count;    //elements in use when the vector was last synced or destroyed
+} VEC_FILE_HEADER;
+
+typedef struct _CC_VECTOR_FILE {
+    CC_MAPPED_FILE File;
+    char *Path;         //the external sort merges into a file next to it
+    int Access;         //VEC_ACCESS_* hint, given again whenever the mapping moves
+} CC_VECTOR_FILE;
+
+// The external sort writes to the vector file name followed by this
+#define VEC_SORT_FILE_SUFFIX    ".sort"
+
+// Runs of the external sort have at least this many elements, whatever the sort memory
+#define VEC_MIN_SORT_RUN        (1 << 12)
+
+static size_t gSortMemory = 0;
+
+// Points Array at the elements that follow the header in the mapping
+static void SetMappedArray(CC_VECTOR *Vector)
+{
+    CC_MAPPED_FILE* file = &Vector->File->File;
+
+    //only a remap that failed on Windows leaves no mapping at all
+    if (NULL == file->Memory || file->Size < VEC_FILE_HEADER_SIZE)
+    {
+        Vector->Array = NULL;
+        Vector->Size = 0;
+        Vector->Count = 0;
+        return;
+    }
+
+    Vector->Array = (int*)((char*)file->Memory + VEC_FILE_HEADER_SIZE);
+    Vector->Size = (int)((file->Size - VEC_FILE_HEADER_SIZE) / sizeof(int));
+    Vector->Count = Vector->Count < Vector->Size ? Vector->Count : Vector->Size;
+}
+
+// Sets the file size to the header and Size elements, the mapping may move
+static int ResizeMappedArray(CC_VECTOR *Vector, int Size)
+{
+    int retVal = -1;
+
+    if ((size_t)Size <= (SIZE_MAX - VEC_FILE_HEADER_SIZE) / sizeof(int))
+    {
+        retVal = CcResizeMappedFile(&Vector->File->File, VEC_FILE_HEADER_SIZE + sizeof(int) * (size_t)Size);
+    }
+    SetMappedArray(Vector);
+    CcAdviseMappedFile(&Vector->File->File, Vector->File->Access);
+    return retVal;
+}
+
+static void WriteFileHeader(CC_VECTOR *Vector)
+{
+    ((VEC_FILE_HEADER*)Vector->File->File.Memory)->Count = Vector->Count;
+}
+
+// Frees Array unless it is the inline buffer, a mapped vector closes its file instead
+static void FreeArray(CC_VECTOR *Vector)
+{
+    if (NULL != Vector->File)
+    {
+        if (NULL != Vector->File->File.Memory)
+        {
+            WriteFileHeader(Vector);
+        }
+        CcCloseMappedFile(&Vector->File->File);
+        free(Vector->File->Path);
+        free(Vector->File);
+        Vector->File = NULL;
+    }
+    else if (Vector->Array != Vector->Inline)
+    {
+        CcAlignedFree(Vector->Array);
+    }
+}
+
+// Moves Array to a block with room for exactly Size elements, or to the inline buffer
+// if they fit in it, Size 0 without an inline buffer frees it. A mapped vector resizes
+// its file instead. There is no aligned
+// realloc, the elements are always copied to the new block.
+static int ResizeArray(CC_VECTOR *Vector, int Size)
+{
+    int* array = NULL;
+
+    if (NULL != Vector->File)
+    {
+        return ResizeMappedArray(Vector, Size);
+    }
+
+    if (Size <= Vector->InlineSize)
+    {
+        if (Vector->Array != Vector->Inline)
+        {
+            if (Vector->Count > 0)
+            {
+                memcpy(Vector->Inline, Vector->Array, sizeof(int) * (size_t)Vector->Count);
+            }
+            CcAlignedFree(Vector->Array);
+            Vector->Array = Vector->Inline;
+            Vector->Size = Vector->InlineSize;
+        }
+        return 0;
+    }
+
+    array = (int*)CcAlignedAlloc(sizeof(int) * (size_t)Size, VEC_ALIGNMENT);
+    if (NULL == array)
+    {
+        return -1;
+    }
+    if (Vector->Count > 0)
+    {
+        memcpy(array, Vector->Array, sizeof(int) * (size_t)Vector->Count);
+    }
+    FreeArray(Vector);
+    Vector->Array = array;
+    Vector->Size = Size;
+    return 0;
+}
+
+// Makes room for Count more elements, doubling the array until they fit
+static int GrowArray(CC_VECTOR *Vector, int Count)
+{
+    int size = Vector->Size < VEC_MIN_CAPACITY ? VEC_MIN_CAPACITY : Vector->Size;
+
+    if (Count > INT_MAX - Vector->Count)
+    {
+        return -1;
+    }
+    if (Vector->Count + Count <= Vector->Size)
+    {
+        return 0;
+    }
+
+    while (size < Vector->Count + Count)
+    {
+        size = size > INT_MAX / 2 ? INT_MAX : size * 2;
+    }
+    return ResizeArray(Vector, size);
+}
 
 int VecCreate(CC_VECTOR **Vector)
+{
+    return VecCreateWithCapacity(Vector, 0);
+}
+
+int VecCreateWithCapacity(CC_VECTOR **Vector, int Capacity)
 {
     CC_VECTOR *vec = NULL;
 
-    if (NULL == Vector)
+    if (NULL == Vector || Capacity < 0)
     {
         return -1;
     }
@@ -22,10 +175,8 @@ int VecCreate(CC_VECTOR **Vector)
 
     memset(vec, 0, sizeof(*vec));
 
-    vec->Count = 0;
-    vec->Size = INITIAL_SIZE;
-    vec->Array = (int*)malloc( sizeof(int) * INITIAL_SIZE );
-    if (NULL == vec->Array) 
+    //most vectors stay small, the array only comes with the first insert
+    if (Capacity > 0 && 0 != ResizeArray(vec, Capacity))
     {
         free(vec);
         return -1;
@@ -36,16 +187,39 @@ int VecCreate(CC_VECTOR **Vector)
     return 0;
 }
 
+int VecCreateSmall(CC_VECTOR **Vector, int InlineSize)
+{
+    CC_VECTOR *vec = NULL;
+
+    if (NULL == Vector || InlineSize < 0 || (size_t)InlineSize > (SIZE_MAX - sizeof(CC_VECTOR)) / sizeof(int))
+    {
+        return -1;
+    }
+
+    //the inline elements follow the vector in the same block
+    vec = (CC_VECTOR*)malloc(sizeof(CC_VECTOR) + sizeof(int) * (size_t)InlineSize);
+    if (NULL == vec)
+    {
+        return -1;
+    }
+
+    VecInit(vec, InlineSize > 0 ? (int*)(vec + 1) : NULL, InlineSize);
+    *Vector = vec;
+
+    return 0;
+}
+
 int VecDestroy(CC_VECTOR **Vector)
 {
-    CC_VECTOR *vec = *Vector;
+    CC_VECTOR *vec = NULL;
 
-    if (NULL == Vector)
+    if (NULL == Vector || NULL == *Vector)
     {
         return -1;
     }
 
-    free(vec->Array);
+    vec = *Vector;
+    FreeArray(vec);
     free(vec);
 
     *Vector = NULL;
@@ -53,129 +227,283 @@ int VecDestroy(CC_VECTOR **Vector)
     return 0;
 }
 
-int VecInsertTail(CC_VECTOR *Vector, int Value)
+int VecInit(CC_VECTOR *Vector, int *Buffer, int BufferSize)
+{
+    if (NULL == Vector || BufferSize < 0 || (NULL == Buffer) != (0 == BufferSize))
+    {
+        return -1;
+    }
+
+    memset(Vector, 0, sizeof(*Vector));
+    Vector->Inline = Buffer;
+    Vector->InlineSize = BufferSize;
+    Vector->Array = Buffer;
+    Vector->Size = BufferSize;
+
+    return 0;
+}
+
+int VecUninit(CC_VECTOR *Vector)
 {
     if (NULL == Vector)
     {
         return -1;
     }
-    
-    if (Vector->Count >= Vector->Size)
+
+    FreeArray(Vector);
+    memset(Vector, 0, sizeof(*Vector));
+
+    return 0;
+}
+
+int VecCreateMapped(CC_VECTOR **Vector, const char *Path)
+{
+    CC_VECTOR *vec = NULL;
+    CC_VECTOR_FILE *file = NULL;
+    VEC_FILE_HEADER *header = NULL;
+    size_t elements = 0;
+    int opened = 0;
+
+    if (NULL == Vector || NULL == Path)
+    {
+        return -1;
+    }
+
+    vec = (CC_VECTOR*)malloc(sizeof(CC_VECTOR));
+    file = (CC_VECTOR_FILE*)malloc(sizeof(CC_VECTOR_FILE));
+    if (NULL == vec || NULL == file)
+    {
+        goto cleanup;
+    }
+    memset(vec, 0, sizeof(*vec));
+    memset(file, 0, sizeof(*file));
+
+    file->Path = (char*)malloc(strlen(Path) + 1);
+    if (NULL == file->Path || 0 != CcOpenMappedFile(Path, &file->File))
     {
-        /// REALLOC
-        int* new = NULL;
+        goto cleanup;
+    }
+    memcpy(file->Path, Path, strlen(Path) + 1);
+    opened = 1;
+    vec->File = file;
 
-        new = (int*)realloc(Vector->Array, (Vector->Size) * sizeof(int) + INITIAL_SIZE * sizeof(int));
-        if (new) 
+    //a new file gets a header, an existing one must be a vector file
+    if (0 == file->File.Size)
+    {
+        if (0 != ResizeMappedArray(vec, 0))
         {
-            Vector->Array = new;
-            Vector->Size += INITIAL_SIZE;
+            goto cleanup;
         }
-        else 
+        header = (VEC_FILE_HEADER*)file->File.Memory;
+        memcpy(header->Magic, VEC_FILE_MAGIC, sizeof(header->Magic));
+        header->Count = 0;
+    }
+    else
+    {
+        header = (VEC_FILE_HEADER*)file->File.Memory;
+        elements = file->File.Size >= VEC_FILE_HEADER_SIZE ? (file->File.Size - VEC_FILE_HEADER_SIZE) / sizeof(int) : 0;
+        if (file->File.Size < VEC_FILE_HEADER_SIZE || 0 != memcmp(header->Magic, VEC_FILE_MAGIC, sizeof(header->Magic))
+            || 0 != (file->File.Size - VEC_FILE_HEADER_SIZE) % sizeof(int) || elements > (size_t)INT_MAX
+            || header->Count < 0 || header->Count > (long long)elements)
         {
-            return -1;
+            goto cleanup;
         }
+        vec->Count = (int)header->Count;
+        SetMappedArray(vec);
     }
-    
-    Vector->Array[Vector->Count] = Value;
-    Vector->Count += 1;
 
+    *Vector = vec;
     return 0;
+
+cleanup:
+    //the file is left as it was
+    if (opened)
+    {
+        CcCloseMappedFile(&file->File);
+    }
+    if (NULL != file)
+    {
+        free(file->Path);
+    }
+    free(file);
+    free(vec);
+    return -1;
 }
 
-int VecInsertHead(CC_VECTOR *Vector, int Value)
+int VecSync(CC_VECTOR *Vector)
 {
     if (NULL == Vector)
     {
         return -1;
     }
+    if (NULL == Vector->File)
+    {
+        return 0;
+    }
+
+    WriteFileHeader(Vector);
+    return CcSyncMappedFile(&Vector->File->File);
+}
 
-    if (Vector->Count >= Vector->Size)
+int VecAdvise(CC_VECTOR *Vector, int Access)
+{
+    if (NULL == Vector || Access < VEC_ACCESS_NORMAL || Access > VEC_ACCESS_RANDOM)
     {
-        /// REALLOC
-        int* new = NULL;
+        return -1;
+    }
+    if (NULL == Vector->File)
+    {
+        return 0;
+    }
 
-        new = (int*)realloc(Vector->Array, (Vector->Size) * sizeof(int) + INITIAL_SIZE * sizeof(int));
-        if (new) 
-        {
-            Vector->Array = new;
-            Vector->Size += INITIAL_SIZE;
-        }
-        else 
-        {
-            return -1;
-        }
+    Vector->File->Access = Access;
+    return CcAdviseMappedFile(&Vector->File->File, Access);
+}
+
+int VecReserve(CC_VECTOR *Vector, int Capacity)
+{
+    if (NULL == Vector || Capacity < 0)
+    {
+        return -1;
     }
 
-    for (int i = Vector->Count-1; i >= 0; i--)
+    if (Capacity <= Vector->Size)
     {
-        if (Vector->Array[i] && Vector->Array[i + 1])
-        {
-            Vector->Array[i + 1] = Vector->Array[i];
-        }   
+        return 0;
+    }
+    return ResizeArray(Vector, Capacity);
+}
+
+int VecShrinkToFit(CC_VECTOR *Vector)
+{
+    if (NULL == Vector)
+    {
+        return -1;
+    }
+
+    if (Vector->Count == Vector->Size)
+    {
+        return 0;
+    }
+    return ResizeArray(Vector, Vector->Count);
+}
+
+int VecInsertTail(CC_VECTOR *Vector, int Value)
+{
+    if (NULL == Vector)
+    {
+        return -1;
+    }
+    
+    if (Vector->Count >= Vector->Size && 0 != GrowArray(Vector, 1))
+    {
+        return -1;
     }
-    Vector->Array[0] = Value;
+    
+    Vector->Array[Vector->Count] = Value;
     Vector->Count += 1;
 
     return 0;
 }
 
-int VecInsertAfterIndex(CC_VECTOR *Vector, int Index, int Value)
+// Shifts the elements from Index on by Count positions to the right in one move,
+// growing the array first if needed. The Count elements at Index are left to the caller.
+static int OpenGap(CC_VECTOR *Vector, int Index, int Count)
 {
-    
-    if (NULL == Vector || Index < 0)
+    if (Count == 0)
+    {
+        return 0;
+    }
+    if (0 != GrowArray(Vector, Count))
     {
         return -1;
     }
 
-    if (Vector->Count >= Vector->Size)
+    memmove(Vector->Array + Index + Count, Vector->Array + Index, sizeof(int) * (size_t)(Vector->Count - Index));
+    Vector->Count += Count;
+    return 0;
+}
+
+int VecInsertHead(CC_VECTOR *Vector, int Value)
+{
+    return VecInsertRange(Vector, 0, &Value, 1);
+}
+
+int VecInsertAfterIndex(CC_VECTOR *Vector, int Index, int Value)
+{
+    if (NULL == Vector || Index < 0 || Index >= Vector->Count)
     {
-        /// REALLOC
-        int* new = NULL;
+        return -1;
+    }
 
-        new = (int*)realloc(Vector->Array, (Vector->Size) * sizeof(int) + INITIAL_SIZE * sizeof(int));
-        if (new) 
-        {
-            Vector->Array = new;
-            Vector->Size += INITIAL_SIZE;
-        }
-        else 
-        {
-            return -1;
-        }
+    return VecInsertRange(Vector, Index + 1, &Value, 1);
+}
+
+int VecInsertRange(CC_VECTOR *Vector, int Index, int *Values, int Count)
+{
+    if (NULL == Vector || Index < 0 || Index > Vector->Count || Count < 0 || (NULL == Values && Count > 0))
+    {
+        return -1;
     }
 
-    for (int i = Vector->Count - 1; i > Index; i--)
+    if (0 != OpenGap(Vector, Index, Count))
     {
-        if (Vector->Array[i] && Vector->Array[i + 1])
-        {
-            Vector->Array[i + 1] = Vector->Array[i];
-        }     
+        return -1;
     }
-    if (Vector->Array[Index + 1])
+    if (Count > 0)
     {
-        Vector->Array[Index + 1] = Value;
+        memcpy(Vector->Array + Index, Values, sizeof(int) * (size_t)Count);
+    }
+    return 0;
+}
+
+int VecInsertManyAt(CC_VECTOR *Vector, int Index, int Value, int Count)
+{
+    if (NULL == Vector || Index < 0 || Index > Vector->Count || Count < 0)
+    {
+        return -1;
     }
-    Vector->Count += 1;
 
+    if (0 != OpenGap(Vector, Index, Count))
+    {
+        return -1;
+    }
+    for (int i = Index; i < Index + Count; i++)
+    {
+        Vector->Array[i] = Value;
+    }
     return 0;
 }
 
 int VecRemoveByIndex(CC_VECTOR *Vector, int Index)
 {
-    if (NULL == Vector || Index < 0) 
+    return VecRemoveRange(Vector, Index, 1);
+}
+
+int VecRemoveRange(CC_VECTOR *Vector, int Index, int Count)
+{
+    if (NULL == Vector || Index < 0 || Count < 0 || Count > Vector->Count - Index)
     {
         return -1;
     }
+    if (Count == 0)
+    {
+        return 0;
+    }
+
+    memmove(Vector->Array + Index, Vector->Array + Index + Count, sizeof(int) * (size_t)(Vector->Count - Index - Count));
+    Vector->Count -= Count;
+    return 0;
+}
 
-    for (int i = Index; i <= Vector->Count - 2; i++) 
+int VecSwapRemove(CC_VECTOR *Vector, int Index)
+{
+    if (NULL == Vector || Index < 0 || Index >= Vector->Count)
     {
-        if (Vector->Array[i] && Vector->Array[i + 1])
-        {
-            Vector->Array[i] = Vector->Array[i + 1];
-        }  
+        return -1;
     }
 
+    Vector->Array[Index] = Vector->Array[Vector->Count - 1];
     Vector->Count -= 1;
     return 0;
 }
@@ -224,66 +552,692 @@ int VecClear(CC_VECTOR *Vector)
     return 0;
 }
 
-int Partition(int Vec[], int Left, int Right)
+int VecSort(CC_VECTOR *Vector)
 {
-    int pivot = Vec[Right];     
-    int i = (Left - 1);   
+    return VecSortEx(Vector, VEC_SORT_DESCENDING);
+}
 
-    for (int j = Left; j <= Right - 1; j++)
-    {        
-        if (Vec[j] > pivot)
-        {
-            i += 1;
-            int temporary;
-            temporary = Vec[i];
-            Vec[i] = Vec[j];
-            Vec[j] = temporary;
-        }
-    }
-    int temporary;
-    temporary = Vec[i+1];
-    Vec[i+1] = Vec[Right];
-    Vec[Right] = temporary;
-    return (i + 1);
+void VecSetSortMemory(size_t Bytes)
+{
+    gSortMemory = Bytes;
 }
 
-void QuickSort(int Vec[], int Left, int Right)
+// Elements of a mapped vector sorted at once, the radix sort needs as many for its buffer
+static int SortRunLength(void)
 {
-    if (Left < Right)
+    unsigned long long bytes = gSortMemory != 0 ? gSortMemory : CcGetPhysicalMemory() / 2;
+    unsigned long long elements = bytes / (2 * sizeof(int));
+
+    //unknown memory, nothing is sorted outside of it
+    if (0 == bytes || elements > (unsigned long long)INT_MAX)
     {
-        int pivot = Partition(Vec, Left, Right);
-        QuickSort(Vec, Left, pivot - 1);
-        QuickSort(Vec, pivot + 1, Right);
+        return INT_MAX;
     }
+    return elements < VEC_MIN_SORT_RUN ? VEC_MIN_SORT_RUN : (int)elements;
 }
 
-int VecSort(CC_VECTOR *Vector)
+static int SortsInMemory(CC_VECTOR *Vector)
 {
-    if (NULL == Vector)
+    return NULL == Vector->File || Vector->Count <= SortRunLength();
+}
+
+// Merge state of one run of the external sort
+typedef struct _VEC_MERGE_RUN {
+    int Value;      //next element of the run
+    int Next;       //index of the element after Value
+    int End;
+} VEC_MERGE_RUN;
+
+// True when run A gives its element before run B
+static int RunFirst(const VEC_MERGE_RUN* A, const VEC_MERGE_RUN* B, int Descending)
+{
+    return Descending ? A->Value > B->Value : A->Value < B->Value;
+}
+
+// Heap of runs with the one to take from first
+static void SiftDownRun(VEC_MERGE_RUN* Runs, int Count, int Root, int Descending)
+{
+    for (int child = 2 * Root + 1; child < Count; child = 2 * Root + 1)
     {
-        return -1;
+        VEC_MERGE_RUN swapped;
+
+        if (child + 1 < Count && RunFirst(&Runs[child + 1], &Runs[child], Descending))
+        {
+            child++;
+        }
+        if (!RunFirst(&Runs[child], &Runs[Root], Descending))
+        {
+            return;
+        }
+        swapped = Runs[Root];
+        Runs[Root] = Runs[child];
+        Runs[child] = swapped;
+        Root = child;
     }
-    QuickSort(Vector->Array, 0, Vector->Count);
-    return 0;
 }
 
-int VecAppend(CC_VECTOR *DestVector, CC_VECTOR *SrcVector)
+// Sorts runs of SortRunLength elements in place, merges them all at once into a file
+// next to the vector file and copies the result back
+static int ExternalSort(CC_VECTOR *Vector, int Descending)
 {
-    if (DestVector == NULL || SrcVector == NULL)
+    CC_VECTOR_FILE* file = Vector->File;
+    CC_MAPPED_FILE output;
+    VEC_MERGE_RUN* runs = NULL;
+    int* buffer = NULL;
+    int* target = NULL;
+    char* path = NULL;
+    size_t length = strlen(file->Path);
+    int runLength = SortRunLength();
+    int runCount = (int)(((long long)Vector->Count + runLength - 1) / runLength);
+    int heapCount = runCount;
+    int opened = 0;
+    int retVal = -1;
+
+    runs = (VEC_MERGE_RUN*)malloc(sizeof(VEC_MERGE_RUN) * (size_t)runCount);
+    buffer = (int*)malloc(sizeof(int) * (size_t)runLength);
+    path = (char*)malloc(length + sizeof(VEC_SORT_FILE_SUFFIX));
+    if (NULL == runs || NULL == buffer || NULL == path)
     {
-        return -1;
+        goto cleanup;
+    }
+    memcpy(path, file->Path, length);
+    memcpy(path + length, VEC_SORT_FILE_SUFFIX, sizeof(VEC_SORT_FILE_SUFFIX));
+
+    //each run is read and written in order, once sorted its pages can go
+    CcAdviseMappedFile(&file->File, CC_ACCESS_SEQUENTIAL);
+    for (int i = 0; i < runCount; i++)
+    {
+        int start = i * runLength;
+        int count = Vector->Count - start < runLength ? Vector->Count - start : runLength;
+
+        SrtRadixSort(Vector->Array + start, count, Descending, buffer);
+        runs[i].Value = Vector->Array[start];
+        runs[i].Next = start + 1;
+        runs[i].End = start + count;
+    }
+
+    if (0 != CcOpenMappedFile(path, &output))
+    {
+        goto cleanup;
+    }
+    opened = 1;
+    if (0 != CcResizeMappedFile(&output, sizeof(int) * (size_t)Vector->Count))
+    {
+        goto cleanup;
+    }
+    CcAdviseMappedFile(&output, CC_ACCESS_SEQUENTIAL);
+
+    //the runs are all read in order at the same time, the output is written in order
+    for (int i = runCount / 2 - 1; i >= 0; i--)
+    {
+        SiftDownRun(runs, runCount, i, Descending);
+    }
+    target = (int*)output.Memory;
+    for (int i = 0; i < Vector->Count; i++)
+    {
+        target[i] = runs[0].Value;
+        if (runs[0].Next < runs[0].End)
+        {
+            runs[0].Value = Vector->Array[runs[0].Next];
+            runs[0].Next += 1;
+        }
+        else
+        {
+            heapCount -= 1;
+            runs[0] = runs[heapCount];
+        }
+        SiftDownRun(runs, heapCount, 0, Descending);
+    }
+    memcpy(Vector->Array, target, sizeof(int) * (size_t)Vector->Count);
+    retVal = 0;
+
+cleanup:
+    if (opened)
+    {
+        CcCloseMappedFile(&output);
+        remove(path);
+    }
+    CcAdviseMappedFile(&file->File, file->Access);
+    free(runs);
+    free(buffer);
+    free(path);
+    return retVal;
+}
+
+int VecSortEx(CC_VECTOR *Vector, int Order)
+{
+    if (NULL == Vector)
+    {
+        return -1;
+    }
+    if (Order != VEC_SORT_DESCENDING && Order != VEC_SORT_ASCENDING)
+    {
+        return -1;
+    }
+
+    if (!SortsInMemory(Vector))
+    {
+        return ExternalSort(Vector, Order == VEC_SORT_DESCENDING);
+    }
+    SrtSortInts(Vector->Array, Vector->Count, Order == VEC_SORT_DESCENDING);
+    return 0;
+}
+
+int VecSortParallel(CC_VECTOR *Vector, int ThreadCount)
+{
+    return VecSortParallelEx(Vector, ThreadCount, VEC_SORT_DESCENDING);
+}
+
+int VecSortParallelEx(CC_VECTOR *Vector, int ThreadCount, int Order)
+{
+    if (NULL == Vector || ThreadCount < 1)
+    {
+        return -1;
+    }
+    if (Order != VEC_SORT_DESCENDING && Order != VEC_SORT_ASCENDING)
+    {
+        return -1;
+    }
+
+    if (!SortsInMemory(Vector))
+    {
+        return ExternalSort(Vector, Order == VEC_SORT_DESCENDING);
+    }
+    return SrtSortIntsParallel(Vector->Array, Vector->Count, Order == VEC_SORT_DESCENDING, ThreadCount);
+}
+
+int VecAppend(CC_VECTOR *DestVector, CC_VECTOR *SrcVector)
+{
+    if (DestVector == NULL || SrcVector == NULL)
+    {
+        return -1;
     }
 
     if (DestVector->Count == 0)
     {
         return 0;
     }
+
+    //one reallocation at most, then a single copy
+    if (0 != GrowArray(SrcVector, DestVector->Count))
+    {
+        return -1;
+    }
+    memmove(SrcVector->Array + SrcVector->Count, DestVector->Array, sizeof(int) * (size_t)DestVector->Count);
+    SrcVector->Count += DestVector->Count;
+    return 0;
+}
+
+// Plain loops, for CPUs without SSE4.1 and for the elements after the last full block
+static long long SumScalar(const int* Array, int Count)
+{
+    long long sum = 0;
+
+    for (int i = 0; i < Count; i++)
+    {
+        sum += Array[i];
+    }
+    return sum;
+}
+
+static void MinMaxScalar(const int* Array, int Count, int* Min, int* Max)
+{
+    for (int i = 0; i < Count; i++)
+    {
+        *Min = Array[i] < *Min ? Array[i] : *Min;
+        *Max = Array[i] > *Max ? Array[i] : *Max;
+    }
+}
+
+static int FindScalar(const int* Array, int Count, int Value)
+{
+    for (int i = 0; i < Count; i++)
+    {
+        if (Array[i] == Value)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int CountEqualScalar(const int* Array, int Count, int Value)
+{
+    int count = 0;
+
+    for (int i = 0; i < Count; i++)
+    {
+        count += Array[i] == Value;
+    }
+    return count;
+}
+
+static void FillScalar(int* Array, int Count, int Value)
+{
+    for (int i = 0; i < Count; i++)
+    {
+        Array[i] = Value;
+    }
+}
+
+#ifdef CC_X86
+// The SIMD level for the kernels that read Array from its start with aligned loads,
+// none for an inline buffer that is not aligned
+static int KernelSimdLevel(const int* Array)
+{
+    return ((size_t)Array & (VEC_ALIGNMENT - 1)) == 0 ? CcGetSimdLevel() : CC_SIMD_NONE;
+}
+
+// The kernels take the whole array, which starts VEC_ALIGNMENT aligned, and go through
+// it in blocks of 32 ints with four independent accumulators so the adds and compares
+// of one block do not wait for each other, the rest is left to the scalar loops.
+#define VEC_BLOCK_INTS      32
+
+// Fills of more ints than this bypass the cache, they would only evict everything else
+#define VEC_STREAM_INTS     (1 << 20)
+
+CC_TARGET_AVX2
+static long long SumAvx2(const int* Array, int Count)
+{
+    __m256i sums[4] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+    long long lanes[4];
+    int blocks = Count / VEC_BLOCK_INTS * VEC_BLOCK_INTS;
+
+    for (int i = 0; i < blocks; i += VEC_BLOCK_INTS)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            __m256i values = _mm256_load_si256((const __m256i*)(Array + i + 8 * j));
+
+            //sign extended to 64 bits, 4 ints at a time
+            sums[j] = _mm256_add_epi64(sums[j], _mm256_cvtepi32_epi64(_mm256_castsi256_si128(values)));
+            sums[j] = _mm256_add_epi64(sums[j], _mm256_cvtepi32_epi64(_mm256_extracti128_si256(values, 1)));
+        }
+    }
+
+    sums[0] = _mm256_add_epi64(_mm256_add_epi64(sums[0], sums[1]), _mm256_add_epi64(sums[2], sums[3]));
+    _mm256_storeu_si256((__m256i*)lanes, sums[0]);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + SumScalar(Array + blocks, Count - blocks);
+}
+
+CC_TARGET_SSE41
+static long long SumSse41(const int* Array, int Count)
+{
+    __m128i sums[4] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+    long long lanes[2];
+    int blocks = Count / VEC_BLOCK_INTS * VEC_BLOCK_INTS;
+
+    for (int i = 0; i < blocks; i += VEC_BLOCK_INTS)
+    {
+        for (int j = 0; j < 8; j++)
+        {
+            __m128i values = _mm_load_si128((const __m128i*)(Array + i + 4 * j));
+
+            sums[j % 4] = _mm_add_epi64(sums[j % 4], _mm_cvtepi32_epi64(values));
+            sums[j % 4] = _mm_add_epi64(sums[j % 4], _mm_cvtepi32_epi64(_mm_srli_si128(values, 8)));
+        }
+    }
+
+    sums[0] = _mm_add_epi64(_mm_add_epi64(sums[0], sums[1]), _mm_add_epi64(sums[2], sums[3]));
+    _mm_storeu_si128((__m128i*)lanes, sums[0]);
+    return lanes[0] + lanes[1] + SumScalar(Array + blocks, Count - blocks);
+}
+
+CC_TARGET_AVX2
+static void MinMaxAvx2(const int* Array, int Count, int* Min, int* Max)
+{
+    __m256i mins[4];
+    __m256i maxs[4];
+    int lanes[8];
+    int blocks = Count / VEC_BLOCK_INTS * VEC_BLOCK_INTS;
+
+    for (int j = 0; j < 4; j++)
+    {
+        mins[j] = _mm256_set1_epi32(*Min);
+        maxs[j] = _mm256_set1_epi32(*Max);
+    }
+    for (int i = 0; i < blocks; i += VEC_BLOCK_INTS)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            __m256i values = _mm256_load_si256((const __m256i*)(Array + i + 8 * j));
+
+            mins[j] = _mm256_min_epi32(mins[j], values);
+            maxs[j] = _mm256_max_epi32(maxs[j], values);
+        }
+    }
+
+    mins[0] = _mm256_min_epi32(_mm256_min_epi32(mins[0], mins[1]), _mm256_min_epi32(mins[2], mins[3]));
+    maxs[0] = _mm256_max_epi32(_mm256_max_epi32(maxs[0], maxs[1]), _mm256_max_epi32(maxs[2], maxs[3]));
+    _mm256_storeu_si256((__m256i*)lanes, mins[0]);
+    MinMaxScalar(lanes, 8, Min, Max);
+    _mm256_storeu_si256((__m256i*)lanes, maxs[0]);
+    MinMaxScalar(lanes, 8, Min, Max);
+    MinMaxScalar(Array + blocks, Count - blocks, Min, Max);
+}
+
+CC_TARGET_SSE41
+static void MinMaxSse41(const int* Array, int Count, int* Min, int* Max)
+{
+    __m128i mins[4];
+    __m128i maxs[4];
+    int lanes[4];
+    int blocks = Count / VEC_BLOCK_INTS * VEC_BLOCK_INTS;
+
+    for (int j = 0; j < 4; j++)
+    {
+        mins[j] = _mm_set1_epi32(*Min);
+        maxs[j] = _mm_set1_epi32(*Max);
+    }
+    for (int i = 0; i < blocks; i += VEC_BLOCK_INTS)
+    {
+        for (int j = 0; j < 8; j++)
+        {
+            __m128i values = _mm_load_si128((const __m128i*)(Array + i + 4 * j));
+
+            mins[j % 4] = _mm_min_epi32(mins[j % 4], values);
+            maxs[j % 4] = _mm_max_epi32(maxs[j % 4], values);
+        }
+    }
+
+    mins[0] = _mm_min_epi32(_mm_min_epi32(mins[0], mins[1]), _mm_min_epi32(mins[2], mins[3]));
+    maxs[0] = _mm_max_epi32(_mm_max_epi32(maxs[0], maxs[1]), _mm_max_epi32(maxs[2], maxs[3]));
+    _mm_storeu_si128((__m128i*)lanes, mins[0]);
+    MinMaxScalar(lanes, 4, Min, Max);
+    _mm_storeu_si128((__m128i*)lanes, maxs[0]);
+    MinMaxScalar(lanes, 4, Min, Max);
+    MinMaxScalar(Array + blocks, Count - blocks, Min, Max);
+}
+
+// Compares a whole block before testing for a match, then finds it in the block
+CC_TARGET_AVX2
+static int FindAvx2(const int* Array, int Count, int Value)
+{
+    __m256i value = _mm256_set1_epi32(Value);
+    int blocks = Count / VEC_BLOCK_INTS * VEC_BLOCK_INTS;
+    int index;
+
+    for (int i = 0; i < blocks; i += VEC_BLOCK_INTS)
+    {
+        __m256i equal0 = _mm256_cmpeq_epi32(_mm256_load_si256((const __m256i*)(Array + i)), value);
+        __m256i equal1 = _mm256_cmpeq_epi32(_mm256_load_si256((const __m256i*)(Array + i + 8)), value);
+        __m256i equal2 = _mm256_cmpeq_epi32(_mm256_load_si256((const __m256i*)(Array + i + 16)), value);
+        __m256i equal3 = _mm256_cmpeq_epi32(_mm256_load_si256((const __m256i*)(Array + i + 24)), value);
+
+        if (!_mm256_testz_si256(_mm256_or_si256(_mm256_or_si256(equal0, equal1), _mm256_or_si256(equal2, equal3)), _mm256_set1_epi32(-1)))
+        {
+            return i + FindScalar(Array + i, VEC_BLOCK_INTS, Value);
+        }
+    }
+
+    index = FindScalar(Array + blocks, Count - blocks, Value);
+    return index == -1 ? -1 : blocks + index;
+}
+
+CC_TARGET_SSE41
+static int FindSse41(const int* Array, int Count, int Value)
+{
+    __m128i value = _mm_set1_epi32(Value);
+    int blocks = Count / VEC_BLOCK_INTS * VEC_BLOCK_INTS;
+    int index;
+
+    for (int i = 0; i < blocks; i += VEC_BLOCK_INTS)
+    {
+        __m128i equal = _mm_setzero_si128();
+
+        for (int j = 0; j < 8; j++)
+        {
+            equal = _mm_or_si128(equal, _mm_cmpeq_epi32(_mm_load_si128((const __m128i*)(Array + i + 4 * j)), value));
+        }
+        if (!_mm_testz_si128(equal, equal))
+        {
+            return i + FindScalar(Array + i, VEC_BLOCK_INTS, Value);
+        }
+    }
+
+    index = FindScalar(Array + blocks, Count - blocks, Value);
+    return index == -1 ? -1 : blocks + index;
+}
+
+// A match compares to -1, subtracting the comparison counts it in every lane
+CC_TARGET_AVX2
+static int CountEqualAvx2(const int* Array, int Count, int Value)
+{
+    __m256i value = _mm256_set1_epi32(Value);
+    __m256i counts[4] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+    int lanes[8];
+    int blocks = Count / VEC_BLOCK_INTS * VEC_BLOCK_INTS;
+    int count = 0;
+
+    for (int i = 0; i < blocks; i += VEC_BLOCK_INTS)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            counts[j] = _mm256_sub_epi32(counts[j], _mm256_cmpeq_epi32(_mm256_load_si256((const __m256i*)(Array + i + 8 * j)), value));
+        }
+    }
+
+    counts[0] = _mm256_add_epi32(_mm256_add_epi32(counts[0], counts[1]), _mm256_add_epi32(counts[2], counts[3]));
+    _mm256_storeu_si256((__m256i*)lanes, counts[0]);
+    for (int j = 0; j < 8; j++)
+    {
+        count += lanes[j];
+    }
+    return count + CountEqualScalar(Array + blocks, Count - blocks, Value);
+}
+
+CC_TARGET_SSE41
+static int CountEqualSse41(const int* Array, int Count, int Value)
+{
+    __m128i value = _mm_set1_epi32(Value);
+    __m128i counts[4] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+    int lanes[4];
+    int blocks = Count / VEC_BLOCK_INTS * VEC_BLOCK_INTS;
+
+    for (int i = 0; i < blocks; i += VEC_BLOCK_INTS)
+    {
+        for (int j = 0; j < 8; j++)
+        {
+            counts[j % 4] = _mm_sub_epi32(counts[j % 4], _mm_cmpeq_epi32(_mm_load_si128((const __m128i*)(Array + i + 4 * j)), value));
+        }
+    }
+
+    counts[0] = _mm_add_epi32(_mm_add_epi32(counts[0], counts[1]), _mm_add_epi32(counts[2], counts[3]));
+    _mm_storeu_si128((__m128i*)lanes, counts[0]);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + CountEqualScalar(Array + blocks, Count - blocks, Value);
+}
+
+// The range may start anywhere, the scalar loop writes up to the first aligned element
+CC_TARGET_AVX2
+static void FillAvx2(int* Array, int Count, int Value)
+{
+    __m256i value = _mm256_set1_epi32(Value);
+    int head = (int)(((VEC_ALIGNMENT - ((size_t)Array & (VEC_ALIGNMENT - 1))) & (VEC_ALIGNMENT - 1)) / sizeof(int));
+    int blocks;
+
+    head = head < Count ? head : Count;
+    FillScalar(Array, head, Value);
+    Array += head;
+    Count -= head;
+
+    blocks = Count / VEC_BLOCK_INTS * VEC_BLOCK_INTS;
+    if (blocks >= VEC_STREAM_INTS)
+    {
+        //the lines are written whole, reading them into the cache first would only halve the bandwidth
+        for (int i = 0; i < blocks; i += VEC_BLOCK_INTS)
+        {
+            _mm256_stream_si256((__m256i*)(Array + i), value);
+            _mm256_stream_si256((__m256i*)(Array + i + 8), value);
+            _mm256_stream_si256((__m256i*)(Array + i + 16), value);
+            _mm256_stream_si256((__m256i*)(Array + i + 24), value);
+        }
+        _mm_sfence();
+    }
+    else
+    {
+        for (int i = 0; i < blocks; i += VEC_BLOCK_INTS)
+        {
+            _mm256_store_si256((__m256i*)(Array + i), value);
+            _mm256_store_si256((__m256i*)(Array + i + 8), value);
+            _mm256_store_si256((__m256i*)(Array + i + 16), value);
+            _mm256_store_si256((__m256i*)(Array + i + 24), value);
+        }
+    }
+    FillScalar(Array + blocks, Count - blocks, Value);
+}
+
+CC_TARGET_SSE41
+static void FillSse41(int* Array, int Count, int Value)
+{
+    __m128i value = _mm_set1_epi32(Value);
+    int head = (int)(((16 - ((size_t)Array & 15)) & 15) / sizeof(int));
+    int blocks;
+
+    head = head < Count ? head : Count;
+    FillScalar(Array, head, Value);
+    Array += head;
+    Count -= head;
+
+    blocks = Count / VEC_BLOCK_INTS * VEC_BLOCK_INTS;
+    if (blocks >= VEC_STREAM_INTS)
+    {
+        for (int i = 0; i < blocks; i += VEC_BLOCK_INTS)
+        {
+            for (int j = 0; j < 8; j++)
+            {
+                _mm_stream_si128((__m128i*)(Array + i + 4 * j), value);
+            }
+        }
+        _mm_sfence();
+    }
     else
     {
-        for (int i = 0; i < DestVector->Count; i++) 
+        for (int i = 0; i < blocks; i += VEC_BLOCK_INTS)
         {
-            VecInsertTail(SrcVector, DestVector->Array[i]);
+            for (int j = 0; j < 8; j++)
+            {
+                _mm_store_si128((__m128i*)(Array + i + 4 * j), value);
+            }
         }
+    }
+    FillScalar(Array + blocks, Count - blocks, Value);
+}
+#endif
+
+int VecSum(CC_VECTOR *Vector, long long *Sum)
+{
+    if (NULL == Vector || NULL == Sum)
+    {
+        return -1;
+    }
+
+#ifdef CC_X86
+    if (KernelSimdLevel(Vector->Array) >= CC_SIMD_AVX2)
+    {
+        *Sum = SumAvx2(Vector->Array, Vector->Count);
+        return 0;
+    }
+    if (KernelSimdLevel(Vector->Array) >= CC_SIMD_SSE41)
+    {
+        *Sum = SumSse41(Vector->Array, Vector->Count);
+        return 0;
+    }
+#endif
+    *Sum = SumScalar(Vector->Array, Vector->Count);
+    return 0;
+}
+
+int VecMinMax(CC_VECTOR *Vector, int *Min, int *Max)
+{
+    int min;
+    int max;
+
+    if (NULL == Vector || NULL == Min || NULL == Max || Vector->Count == 0)
+    {
+        return -1;
+    }
+
+    min = Vector->Array[0];
+    max = Vector->Array[0];
+#ifdef CC_X86
+    if (KernelSimdLevel(Vector->Array) >= CC_SIMD_AVX2)
+    {
+        MinMaxAvx2(Vector->Array, Vector->Count, &min, &max);
+    }
+    else if (KernelSimdLevel(Vector->Array) >= CC_SIMD_SSE41)
+    {
+        MinMaxSse41(Vector->Array, Vector->Count, &min, &max);
+    }
+    else
+#endif
+    {
+        MinMaxScalar(Vector->Array, Vector->Count, &min, &max);
+    }
+
+    *Min = min;
+    *Max = max;
+    return 0;
+}
+
+int VecFind(CC_VECTOR *Vector, int Value)
+{
+    if (NULL == Vector)
+    {
+        return -1;
+    }
+
+#ifdef CC_X86
+    if (KernelSimdLevel(Vector->Array) >= CC_SIMD_AVX2)
+    {
+        return FindAvx2(Vector->Array, Vector->Count, Value);
+    }
+    if (KernelSimdLevel(Vector->Array) >= CC_SIMD_SSE41)
+    {
+        return FindSse41(Vector->Array, Vector->Count, Value);
+    }
+#endif
+    return FindScalar(Vector->Array, Vector->Count, Value);
+}
+
+int VecCountEqual(CC_VECTOR *Vector, int Value)
+{
+    if (NULL == Vector)
+    {
+        return -1;
+    }
+
+#ifdef CC_X86
+    if (KernelSimdLevel(Vector->Array) >= CC_SIMD_AVX2)
+    {
+        return CountEqualAvx2(Vector->Array, Vector->Count, Value);
+    }
+    if (KernelSimdLevel(Vector->Array) >= CC_SIMD_SSE41)
+    {
+        return CountEqualSse41(Vector->Array, Vector->Count, Value);
+    }
+#endif
+    return CountEqualScalar(Vector->Array, Vector->Count, Value);
+}
+
+int VecFillRange(CC_VECTOR *Vector, int Index, int Count, int Value)
+{
+    if (NULL == Vector || Index < 0 || Count < 0 || Index > Vector->Count - Count)
+    {
+        return -1;
+    }
+
+#ifdef CC_X86
+    if (CcGetSimdLevel() >= CC_SIMD_AVX2)
+    {
+        FillAvx2(Vector->Array + Index, Count, Value);
         return 0;
     }
+    if (CcGetSimdLevel() >= CC_SIMD_SSE41)
+    {
+        FillSse41(Vector->Array + Index, Count, Value);
+        return 0;
+    }
+#endif
+    FillScalar(Vector->Array + Index, Count, Value);
+    return 0;
 }
@@ -1,26 +1,153 @@
 #pragma once
+#include <stddef.h>
+
+// Array grows geometrically, it doubles whenever it is full so appending N elements
+// copies each of them about once. VecCreate allocates no elements at all, the first
+// insert allocates VEC_MIN_CAPACITY of them.
+#define VEC_MIN_CAPACITY    16
+
+// Array is aligned to this many bytes, the SIMD kernels below read it 8 ints at a time
+// with aligned loads
+#define VEC_ALIGNMENT       32
 
 typedef struct _CC_VECTOR {
-    int *Array;
-    int Size;
+    int *Array;     //NULL until the first insert, VEC_ALIGNMENT aligned unless it is Inline
+    int Size;       //number of elements Array has room for
     int Count;
+    int *Inline;    //room for InlineSize elements that comes with the vector, NULL if none
+    int InlineSize;
+    struct _CC_VECTOR_FILE *File;   //the file Array is mapped from, NULL for a vector in memory
 } CC_VECTOR;
 
 int VecCreate(CC_VECTOR **Vector);
+
+// Same as VecCreate with room for Capacity elements allocated up front
+int VecCreateWithCapacity(CC_VECTOR **Vector, int Capacity);
+
+// Same as VecCreate with room for InlineSize elements in the block of the vector
+// itself. Array is only allocated once there are more elements, and given back as soon
+// as they fit again when shrinking, so short vectors cost one malloc.
+int VecCreateSmall(CC_VECTOR **Vector, int InlineSize);
 int VecDestroy(CC_VECTOR **Vector);
 
+// Sets up a vector whose CC_VECTOR the caller provides, as a member of another struct
+// or on the stack, so it needs no malloc of its own. Buffer, NULL if BufferSize is 0,
+// holds the elements while there are at most BufferSize of them, see VecCreateSmall.
+// Array then points to Buffer: the vector must not be copied to another address and
+// Buffer must outlive it. Every Vec function works on it except VecDestroy, VecUninit
+// gives back the array it may have allocated.
+int VecInit(CC_VECTOR *Vector, int *Buffer, int BufferSize);
+int VecUninit(CC_VECTOR *Vector);
+
+// Same as VecCreate with the elements kept in the file at Path, which is created if it
+// does not exist. Array is a shared mapping of the file, its pages are read when first
+// touched and written back by the system, so the vector may be larger than the memory
+// and opening an existing file takes no time whatever its size. Every Vec function
+// works on it, growing the vector grows the file. The number of elements is written to
+// the file by VecSync and VecDestroy, elements added since are lost if the process ends
+// first. The file holds native ints, it cannot move to a machine of other endianness.
+// Returns -1 if Path cannot be opened or holds something other than a vector
+int VecCreateMapped(CC_VECTOR **Vector, const char *Path);
+
+// Writes the elements of a mapped vector and their number to the disk and waits for
+// them, nothing to do for a vector in memory
+int VecSync(CC_VECTOR *Vector);
+
+// How a mapped vector is about to be read, see CcAdviseMappedFile: sequential for
+// scans, random for lookups spread over the whole vector. The hint stays until the
+// next call. Ignored for a vector in memory.
+#define VEC_ACCESS_NORMAL       0
+#define VEC_ACCESS_SEQUENTIAL   1
+#define VEC_ACCESS_RANDOM       2
+
+int VecAdvise(CC_VECTOR *Vector, int Access);
+
+// A CC_VECTOR followed by room for Count elements, for struct members and locals:
+//      CC_SMALL_VECTOR(8) ids;
+//      VEC_INIT_SMALL(ids);
+//      VecInsertTail(&ids.Vector, 10);
+#define CC_SMALL_VECTOR(Count)  struct { CC_VECTOR Vector; int Inline[Count]; }
+#define VEC_INIT_SMALL(Small)   VecInit(&(Small).Vector, (Small).Inline, (int)(sizeof((Small).Inline) / sizeof(int)))
+
+// Makes room for at least Capacity elements, so that many can be inserted without
+// reallocating. Never shrinks the array.
+int VecReserve(CC_VECTOR *Vector, int Capacity);
+
+// Gives back the room not used by the elements, an empty vector keeps no array at all
+int VecShrinkToFit(CC_VECTOR *Vector);
+
 int VecInsertTail(CC_VECTOR *Vector, int Value);
 int VecInsertHead(CC_VECTOR *Vector, int Value);
+
+// Returns -1 if Index is not the index of an element
 int VecInsertAfterIndex(CC_VECTOR *Vector, int Index, int Value);
 int VecRemoveByIndex(CC_VECTOR *Vector, int Index);
+
+// Inserts the Count elements of Values so the first one ends up at Index, which goes
+// from 0 to the number of elements (append). The elements after it are moved once,
+// whatever Count is. Values must not point into Vector, the array may be reallocated.
+int VecInsertRange(CC_VECTOR *Vector, int Index, int *Values, int Count);
+
+// Same as VecInsertRange with Count copies of Value
+int VecInsertManyAt(CC_VECTOR *Vector, int Index, int Value, int Count);
+
+// Removes the Count elements starting at Index, the ones after them are moved once
+// Returns -1 if the range goes past the last element
+int VecRemoveRange(CC_VECTOR *Vector, int Index, int Count);
+
+// Removes the element at Index by moving the last element in its place, in constant
+// time. The order of the elements is not kept.
+int VecSwapRemove(CC_VECTOR *Vector, int Index);
 int VecGetValueByIndex(CC_VECTOR *Vector, int Index, int *Value);
 
 // Returns the number of element in Vector or -1 in case of error or invalid parameters
 int VecGetCount(CC_VECTOR *Vector);
 int VecClear(CC_VECTOR *Vector);
 
+#define VEC_SORT_DESCENDING 0
+#define VEC_SORT_ASCENDING  1
+
 // Sort the vector in decreasing order
 int VecSort(CC_VECTOR *Vector);
 
+// Sort the vector in VEC_SORT_DESCENDING or VEC_SORT_ASCENDING order. Large vectors are
+// radix sorted, the others introsorted, see ccsort.h
+// A mapped vector that does not fit in the sort memory, see VecSetSortMemory, gets an
+// external merge sort: runs that fit are sorted in place one after the other, then all
+// of them are merged into a file next to the vector file, which is copied back. Each
+// pass reads and writes the files in order.
+int VecSortEx(CC_VECTOR *Vector, int Order);
+
+// Bytes a sort of a mapped vector may use for its elements and the radix sort buffer,
+// as many as the elements. 0, the default, is half of the physical memory.
+void VecSetSortMemory(size_t Bytes);
+
+// Same result as VecSort using up to ThreadCount threads of the shared task pool, see
+// SrtSortIntsParallel. Needs a buffer as large as the vector, or sorts on one thread.
+// Mapped vectors larger than the sort memory get the external sort of VecSortEx.
+int VecSortParallel(CC_VECTOR *Vector, int ThreadCount);
+int VecSortParallelEx(CC_VECTOR *Vector, int ThreadCount, int Order);
+
 // Appends all the elements in DestVector to SrcVector
 int VecAppend(CC_VECTOR *DestVector, CC_VECTOR *SrcVector);
+
+// The functions below run AVX2 or SSE4.1 kernels when the CPU has them, see
+// CcGetSimdLevel, and plain loops otherwise. The level is checked on every call.
+// Elements in an inline buffer that is not VEC_ALIGNMENT aligned go through the loops.
+
+// Sum of the elements in 64 bits, so it never overflows. 0 for an empty vector.
+int VecSum(CC_VECTOR *Vector, long long *Sum);
+
+// Returns -1 if the vector is empty or the parameters are invalid
+int VecMinMax(CC_VECTOR *Vector, int *Min, int *Max);
+
+// Returns the index of the first element equal to Value, or -1 if there is none or
+// the parameters are invalid
+int VecFind(CC_VECTOR *Vector, int Value);
+
+// Returns the number of elements equal to Value, or -1 if the parameters are invalid
+int VecCountEqual(CC_VECTOR *Vector, int Value);
+
+// Sets the Count elements starting at Index to Value
+// Returns -1 if the range goes past the last element
+int VecFillRange(CC_VECTOR *Vector, int Index, int Count, int Value);
@@ -9,10 +9,19 @@ typedef struct _NODE { //struct used for node in simple linked list of ints
     struct _NODE* Next;
 }NODE;
 
-typedef struct _NODEH { //struct used for node in hashtable
+// Frees memory handed over to someone else, free itself for plain heap blocks
+typedef void (*CC_FREE_ROUTINE)(void* Memory);
+
+typedef union _NODEH_KEY { //key of a hashtable slot
+    char* Pointer;  //key stored outside the slot
+    char Inline[16]; //short key copied into the slot, '\0' terminated
+}NODEH_KEY;
+
+typedef struct _NODEH { //struct used for slot in hashtable
+    NODEH_KEY Key;
     int Data;
-    struct _NODEH* Next;
-    char* Key;
+    unsigned int KeyLength; //strlen(Key)
+    unsigned long long Hash; //full hash of Key, compared before the key itself
 }NODEH;
 
 
@@ -2,10 +2,17 @@
 #include "ccvector.h"
 #include "ccstack.h"
 #include "cchashtable.h"
+#include "ccconcurrenthashtable.h"
+#include "ccintmap.h"
 #include "ccheap.h"
 #include "cctree.h"
+#include "ccsort.h"
+#include "cctypedvector.h"
+#include "ccplatform.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 
 #define _CRTDBG_MAP_ALLOC 
 #include <crtdbg.h>
@@ -15,6 +22,8 @@
 int TestVector();
 int TestStack();
 int TestHashTable();
+int TestConcurrentHashTable();
+int TestIntMap();
 int TestHeap();
 int TestTree();
 
@@ -63,6 +72,26 @@ void RunTests()
         printf("HashTable test failed\n\n");
     }
 
+    if (0 == TestConcurrentHashTable())
+    {
+        _CrtDumpMemoryLeaks();
+        printf("ConcurrentHashTable test passed\n\n");
+    }
+    else
+    {
+        printf("ConcurrentHashTable test failed\n\n");
+    }
+
+    if (0 == TestIntMap())
+    {
+        _CrtDumpMemoryLeaks();
+        printf("IntMap test passed\n\n");
+    }
+    else
+    {
+        printf("IntMap test failed\n\n");
+    }
+
     if (0 == TestHeap())
     {
         _CrtDumpMemoryLeaks();
@@ -264,287 +293,2018 @@ cleanup:
     return retVal;
 }
 
-int TestHashTable()
+#define TEST_INCREMENTAL_KEYS   20000
+
+static char gIncrementalKeys[TEST_INCREMENTAL_KEYS][32];
+
+// Adds keys "inc<n>" with value n, starting at *Next, until a migration is in progress.
+// Returns the number of migrations started, -1 on error
+static int AddUntilMigrating(CC_HASH_TABLE* HashTable, int* Next, int Limit)
 {
-    int retVal = -1;
-    int foundVal = -1;
-    CC_HASH_TABLE* usedTable = NULL;
-    
-    int x;
-    x = EqualStrings("aad","asad");
-    printf("%d\n ", x);
+    int migrations = 0;
 
-    retVal = HtCreate(&usedTable);
-    if (0 != retVal)
+    while (*Next < Limit)
     {
-        printf("HtCreate failed!\n");
-        goto cleanup;
+        int wasMigrating = HashTable->OldCount > 0;
+
+        snprintf(gIncrementalKeys[*Next], sizeof(gIncrementalKeys[*Next]), "inc%d", *Next);
+        if (0 != HtSetKeyValue(HashTable, gIncrementalKeys[*Next], *Next))
+        {
+            return -1;
+        }
+        *Next += 1;
+        if (!wasMigrating && HashTable->OldCount > 0)
+        {
+            migrations++;
+            break;
+        }
     }
+    return migrations;
+}
 
-    retVal = HtSetKeyValue(usedTable, "mere", 20);
+// Walks the rest of an iteration, every key must hold the number in its name and be
+// found by a lookup made in the middle of the walk.
+// Returns the number of keys seen, -1 on a wrong value
+static int CountIncrementalKeys(CC_HASH_TABLE_ITERATOR* Iterator, int Status, char* Key)
+{
+    int count = 0;
+    int value = -1;
 
-    retVal = HtSetKeyValue(usedTable, "mere1", 25);
-    
-    retVal = HtSetKeyValue(usedTable, "mere2", 30);
-    if (0 != retVal)
+    for (; Status >= 0; Status = HtGetNextKey(Iterator, &Key))
     {
-        printf("HtSetKeyValue failed!\n");
-        goto cleanup;
+        if (Iterator->Current->Data != atoi(Key + 3)
+            || 0 != HtGetKeyValue(Iterator->HashTable, Key, &value) || value != Iterator->Current->Data)
+        {
+            return -1;
+        }
+        count++;
     }
+    return count;
+}
 
-    retVal = HtGetKeyValue(usedTable, "mere", &foundVal);
+#define TEST_BASIC_KEYS     1000
+
+static char gBasicKeys[TEST_BASIC_KEYS][32];
+
+// Sets, gets, removes and iterates keys on a table made from Options, NULL for HtCreate.
+// Every other key is removed and added again, so probes go over deleted slots too.
+static int TestHashTableBasics(CC_HASH_TABLE_OPTIONS* Options)
+{
+    int retVal = -1;
+    int foundVal = -1;
+    int count = 0;
+    CC_HASH_TABLE* table = NULL;
+    CC_HASH_TABLE_ITERATOR iterator;
+    char* key = NULL;
+
+    retVal = NULL == Options ? HtCreate(&table) : HtCreateEx(&table, Options);
     if (0 != retVal)
     {
-        printf("HtGetKeyValue failed!\n");
+        printf("HtCreate failed!\n");
         goto cleanup;
     }
-    if (foundVal != 20)
+    if (NULL != Options && NULL != Options->HashRoutine
+        && (table->HashRoutine != Options->HashRoutine || table->Seed != Options->Seed))
     {
-        printf("Invalid value after get!\n");
+        printf("HtCreateEx did not keep the hash routine!\n");
         retVal = -1;
         goto cleanup;
     }
-    
-    //retVal = HtRemoveKey(usedTable, "mere2");
+    for (int i = 0; i < TEST_BASIC_KEYS; i++)
+    {
+        snprintf(gBasicKeys[i], sizeof(gBasicKeys[i]), "basic%d", i);
+        if (0 != HtSetKeyValue(table, gBasicKeys[i], i))
+        {
+            printf("HtSetKeyValue failed!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    for (int i = 0; i < TEST_BASIC_KEYS; i += 2)
+    {
+        if (0 != HtRemoveKey(table, gBasicKeys[i]) || -1 != HtRemoveKey(table, gBasicKeys[i]))
+        {
+            printf("HtRemoveKey failed!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    for (int i = 0; i < TEST_BASIC_KEYS; i++)
+    {
+        retVal = HtGetKeyValue(table, gBasicKeys[i], &foundVal);
+        if ((i % 2 == 0) ? (-1 != retVal || 0 != HtHasKey(table, gBasicKeys[i]))
+            : (0 != retVal || foundVal != i || 1 != HtHasKey(table, gBasicKeys[i])))
+        {
+            printf("Invalid value after HtRemoveKey!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    for (int i = 0; i < TEST_BASIC_KEYS; i += 4)
+    {
+        if (0 != HtSetKeyValue(table, gBasicKeys[i], i))
+        {
+            printf("HtSetKeyValue failed after HtRemoveKey!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
 
-    if (1 != HtHasKey(usedTable, "mere"))
+    for (retVal = HtInitIterator(table, &iterator, &key); retVal >= 0; retVal = HtGetNextKey(&iterator, &key))
     {
-        printf("Invalid answer to HtHasKey!\n");
+        int number = atoi(key + 5);
+        if (iterator.Current->Data != number || (number % 2 == 0 && number % 4 != 0))
+        {
+            printf("Invalid key %s from the iterator!\n", key);
+            retVal = -1;
+            goto cleanup;
+        }
+        count++;
+    }
+    if (-2 != retVal || count != TEST_BASIC_KEYS / 2 + TEST_BASIC_KEYS / 4 || count != HtGetKeyCount(table))
+    {
+        printf("Invalid key count from the iterator!\n");
         retVal = -1;
         goto cleanup;
     }
+    retVal = 0;
 
-    
-    CC_HASH_TABLE_ITERATOR* iterator;
-    char* key;
-    key = NULL;
-    retVal = HtGetFirstKey(usedTable, &iterator, &key);
-
-    retVal = HtGetNextKey(iterator, &key);
-    retVal = HtGetNextKey(iterator, &key);
-    
-    retVal = HtReleaseIterator(&iterator);
-
-    //retVal = HtClear(usedTable);
 cleanup:
-    if (NULL != usedTable)
+    if (NULL != table)
     {
-        if (0 != HtDestroy(&usedTable))
-        {
-            printf("HtDestroy failed!\n");
-            retVal = -1;
-        }
+        HtDestroy(&table);
     }
     return retVal;
 }
 
-int TestStack()
+#define TEST_SNAPSHOT_PATH  "test_truncated.snap"
+
+// Writes the first Size bytes of Image to TEST_SNAPSHOT_PATH
+static int WriteSnapshotImage(const char* Image, size_t Size)
 {
-    int retVal = -1;
-    int foundVal = -1;
-    CC_STACK* usedStack = NULL;
+    FILE* file = fopen(TEST_SNAPSHOT_PATH, "wb");
+    int retVal = 0;
 
-    retVal = StCreate(&usedStack);
-    if (0 != retVal)
+    if (NULL == file)
     {
-        printf("StCreate failed!\n");
-        goto cleanup;
+        return -1;
     }
-
-    retVal = StPush(usedStack, 10);
-    if (0 != retVal)
+    if (Size != fwrite(Image, 1, Size, file))
     {
-        printf("StPush failed!\n");
-        goto cleanup;
+        retVal = -1;
     }
+    fclose(file);
+    return retVal;
+}
 
-    if (0 != StIsEmpty(usedStack))
+// A snapshot cut short must not load, even without HT_SNAPSHOT_VERIFY and with a
+// header that was fixed to match the shorter file
+static int TestTruncatedSnapshot()
+{
+    int retVal = -1;
+    CC_HASH_TABLE* table = NULL;
+    CC_HASH_TABLE_OPTIONS options = { 0 };
+    char keyBuffer[64];
+    char* image = NULL;
+    long size = 0;
+    unsigned long long fileSize;
+    FILE* file = NULL;
+
+    //long keys, so the entries point into the key section
+    options.Flags = HT_FLAG_OWN_KEYS;
+    if (0 != HtCreateEx(&table, &options))
     {
-        printf("Invalid answer to StIsEmpty!\n");
-        retVal = -1;
         goto cleanup;
     }
-    retVal = StPush(usedStack, 10);
-    retVal = StPop(usedStack, &foundVal);
-    if (0 != retVal)
+    for (int i = 0; i < 100; i++)
     {
-        printf("StPop failed!\n");
+        snprintf(keyBuffer, sizeof(keyBuffer), "some/longer/path/to/key%d", i);
+        HtSetKeyValue(table, keyBuffer, i);
+    }
+    if (0 != HtSaveSnapshot(table, TEST_SNAPSHOT_PATH))
+    {
+        printf("HtSaveSnapshot failed!\n");
         goto cleanup;
     }
+    HtDestroy(&table);
 
-    if (foundVal != 10)
+    file = fopen(TEST_SNAPSHOT_PATH, "rb");
+    if (NULL == file || 0 != fseek(file, 0, SEEK_END) || (size = ftell(file)) <= 24 || 0 != fseek(file, 0, SEEK_SET))
     {
-        printf("Invalid value after pop!\n");
-        retVal = -1;
         goto cleanup;
     }
-
-    retVal = StPush(usedStack, 10);
-    retVal = StPush(usedStack, 11);
-    retVal = StPush(usedStack, 12);
-    retVal = StPush(usedStack, 13);
-    if (0 != StClear(usedStack)) 
+    image = (char*)malloc((size_t)size);
+    if (NULL == image || (size_t)size != fread(image, 1, (size_t)size, file))
     {
-        printf("Invalid answer to StClear!\n");
-        retVal = -1;
         goto cleanup;
     }
+    fclose(file);
+    file = NULL;
 
-    CC_STACK* stack1 = NULL;
-    CC_STACK* stack2 = NULL;
-    retVal = StCreate(&stack1);
-    retVal = StCreate(&stack2);
-
-    retVal = StPush(stack1, 10);
-    retVal = StPush(stack1, 11);
-    retVal = StPush(stack2, 12);
-    retVal = StPush(stack2, 13);
-
-    if (0 != StPushStack(stack1, stack2)) 
+    //the last byte is the terminator of the last long key
+    if (0 != WriteSnapshotImage(image, (size_t)size - 1) || -1 != HtLoadSnapshot(&table, TEST_SNAPSHOT_PATH, 0))
     {
-        printf("StPushStack failed!\n");
-        retVal = -1;
+        printf("HtLoadSnapshot loaded a truncated file!\n");
         goto cleanup;
     }
 
-
+    //FileSize is the third field of the header, after the magic, version and byte order
+    fileSize = (unsigned long long)size - 1;
+    memcpy(image + 16, &fileSize, sizeof(fileSize));
+    if (0 != WriteSnapshotImage(image, (size_t)size - 1) || -1 != HtLoadSnapshot(&table, TEST_SNAPSHOT_PATH, 0))
+    {
+        printf("HtLoadSnapshot loaded a truncated file with a matching header!\n");
+        goto cleanup;
+    }
+    retVal = 0;
 
 cleanup:
-    if (NULL != usedStack)
+    if (NULL != file)
     {
-        if (0 != StDestroy(&usedStack))
-        {
-            printf("StDestroy failed!\n");
-            retVal = -1;
-        }
+        fclose(file);
     }
-    StDestroy(&stack1);
-    StDestroy(&stack2);
+    if (NULL != table)
+    {
+        HtDestroy(&table);
+    }
+    free(image);
+    remove(TEST_SNAPSHOT_PATH);
     return retVal;
 }
 
-int TestVector()
+int TestHashTable()
 {
     int retVal = -1;
-    int retVal2 = -1;
-    int foundVal = 0;
-    CC_VECTOR* usedVector = NULL;
-    CC_VECTOR* usedVector2 = NULL;
-    
-    retVal = VecCreate(&usedVector);
-    retVal2 = VecCreate(&usedVector2);
+    int foundVal = -1;
+    CC_HASH_TABLE* usedTable = NULL;
+    CC_HASH_TABLE* ownTable = NULL;
+    CC_HASH_TABLE* orderedTable = NULL;
+    CC_HASH_TABLE* loadedTable = NULL;
+    CC_HASH_TABLE* filteredTable = NULL;
+    CC_HASH_TABLE* incrementalTable = NULL;
 
+    retVal = HtCreate(&usedTable);
     if (0 != retVal)
     {
-        printf("VecCreate failed!\n");
+        printf("HtCreate failed!\n");
         goto cleanup;
     }
 
-    if (0 != retVal2)
-    {
-        printf("VecCreate failed!\n");
-        goto cleanup;
-    }
+    retVal = HtSetKeyValue(usedTable, "mere", 20);
 
-    retVal = VecInsertTail(usedVector, 10);
+    retVal = HtSetKeyValue(usedTable, "mere1", 25);
+    
+    retVal = HtSetKeyValue(usedTable, "mere2", 30);
     if (0 != retVal)
     {
-        printf("VecInsertTail failed!\n");
+        printf("HtSetKeyValue failed!\n");
         goto cleanup;
     }
 
-    retVal = VecInsertHead(usedVector, 16);
+    retVal = HtGetKeyValue(usedTable, "mere", &foundVal);
     if (0 != retVal)
     {
-        printf("VecInsertHead failed!\n");
+        printf("HtGetKeyValue failed!\n");
         goto cleanup;
     }
-
-    if (VecGetCount(usedVector) != 2)
+    if (foundVal != 20)
     {
-        printf("Invalid count returned!\n");
+        printf("Invalid value after get!\n");
         retVal = -1;
         goto cleanup;
     }
-
-    retVal = VecInsertAfterIndex(usedVector, 0, 20);
+    
+    retVal = HtRemoveKey(usedTable, "mere2");
     if (0 != retVal)
     {
-        printf("VecInsertAfterIndex failed!\n");
+        printf("HtRemoveKey failed!\n");
         goto cleanup;
     }
 
-    retVal = VecRemoveByIndex(usedVector, 0);
-    if (0 != retVal)
+    if (0 != HtHasKey(usedTable, "mere2") || 2 != HtGetKeyCount(usedTable))
     {
-        printf("VecRemoveByIndex failed!\n");
+        printf("Key still in table after HtRemoveKey!\n");
+        retVal = -1;
         goto cleanup;
     }
 
-    retVal = VecGetValueByIndex(usedVector, 0, &foundVal);
+    retVal = HtSetKeyValue(usedTable, "mere2", 30);
     if (0 != retVal)
     {
-        printf("VecGetValueByIndex failed!\n");
+        printf("HtSetKeyValue failed after HtRemoveKey!\n");
         goto cleanup;
     }
 
-    if (foundVal != 20)
+    if (1 != HtHasKey(usedTable, "mere"))
     {
-        printf("Invalid value found at position 0\n");
+        printf("Invalid answer to HtHasKey!\n");
         retVal = -1;
         goto cleanup;
     }
 
-    retVal = VecClear(usedVector);
-    if (0 != retVal)
+    //the control bytes are scanned the same way at every SIMD level
+    for (int level = CC_SIMD_NONE; level <= CC_SIMD_AVX2; level++)
     {
-        printf("VecClear failed!\n");
-        goto cleanup;
+        CcSetSimdLevel(level);
+        if (0 != TestHashTableBasics(NULL))
+        {
+            printf("Hash table checks failed at SIMD level %d\n", level);
+            CcSetSimdLevel(CC_SIMD_AVX2);
+            retVal = -1;
+            goto cleanup;
+        }
     }
+    CcSetSimdLevel(CC_SIMD_AVX2);
 
-    if (0 != VecGetCount(usedVector))
+    //known answers of the reference xxHash64, and a seed that changes the whole output
+    if (0xEF46DB3751D8E999ULL != HfXxHash64("", 0, 0) || 0x44BC2CF5AD770999ULL != HfXxHash64("abc", 3, 0)
+        || HfSipHash("abc", 3, 1) == HfSipHash("abc", 3, 2))
     {
-        printf("Invalid count after clear\n");
+        printf("Invalid hash function output!\n");
         retVal = -1;
         goto cleanup;
     }
 
-    retVal = VecInsertTail(usedVector, 15);
-    retVal = VecInsertTail(usedVector, 150);
-    retVal = VecInsertTail(usedVector, 425);
-    retVal = VecInsertTail(usedVector, 65465);
-    retVal = VecInsertTail(usedVector, 2156);
-    retVal = VecInsertTail(usedVector, 65186);
-    retVal = VecInsertTail(usedVector, 166);
-    retVal = VecInsertTail(usedVector, 1023);
-    retVal = VecInsertTail(usedVector, 5465);
-
-    if (0 != VecSort(usedVector))
+    //the same checks on tables with another hash routine
+    CC_HASH_TABLE_OPTIONS hashOptions = { 0 };
+    hashOptions.HashRoutine = HfSipHash;
+    hashOptions.Seed = 0x0123456789ABCDEFULL;
+    if (0 != TestHashTableBasics(&hashOptions))
     {
-        printf("Invalid sort return value\n");
+        printf("Hash table checks failed with HfSipHash!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    hashOptions.HashRoutine = HfDjb2;
+    hashOptions.Seed = 0;
+    if (0 != TestHashTableBasics(&hashOptions))
+    {
+        printf("Hash table checks failed with HfDjb2!\n");
         retVal = -1;
         goto cleanup;
     }
 
-    for (int i = 0; i < usedVector->Count-1; i++)
+    //enough keys to make the table grow a few times
+    static char manyKeys[1000][32];
+    for (int i = 0; i < 1000; i++)
     {
-        if (usedVector->Array[i] - usedVector->Array[i + 1] < 0)
+        snprintf(manyKeys[i], sizeof(manyKeys[i]), "key%d", i);
+        if (0 != HtSetKeyValue(usedTable, manyKeys[i], i))
         {
-            printf("Invalid sort!\n");
+            printf("HtSetKeyValue failed while growing!\n");
             retVal = -1;
             goto cleanup;
         }
     }
-
-    retVal = VecClear(usedVector);
-    if (0 != retVal)
+    for (int i = 0; i < 1000; i++)
     {
-        printf("VecClear failed!\n");
+        if (0 != HtGetKeyValue(usedTable, manyKeys[i], &foundVal) || foundVal != i)
+        {
+            printf("Invalid value after growing!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    if (1003 != HtGetKeyCount(usedTable))
+    {
+        printf("Invalid key count after growing!\n");
+        retVal = -1;
         goto cleanup;
     }
 
-    retVal = VecInsertTail(usedVector, 15);
-    retVal = VecInsertTail(usedVector, 150);
+    //the batch calls must give the same answers as the single-key ones
+    char* batchKeys[4] = { "mere", "pere", manyKeys[500], "mere1" };
+    int batchValues[4] = { 0 };
+    int batchResults[4];
+    if (3 != HtGetKeyValueMany(usedTable, batchKeys, 4, batchValues, batchResults)
+        || batchResults[0] != 0 || batchValues[0] != 20 || batchResults[1] != -1
+        || batchResults[2] != 0 || batchValues[2] != 500 || batchResults[3] != 0 || batchValues[3] != 25)
+    {
+        printf("Invalid HtGetKeyValueMany results!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    batchValues[1] = 40;
+    if (1 != HtSetKeyValueMany(usedTable, batchKeys, batchValues, 2, batchResults)
+        || batchResults[0] != -1 || batchResults[1] != 0
+        || 0 != HtGetKeyValue(usedTable, "pere", &foundVal) || foundVal != 40)
+    {
+        printf("Invalid HtSetKeyValueMany results!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    //a stack iterator sees every key once
+    CC_HASH_TABLE_ITERATOR stackIterator;
+    char* iteratedKey = NULL;
+    int iteratedCount = 0;
+    retVal = HtInitIterator(usedTable, &stackIterator, &iteratedKey);
+    while (0 == retVal)
+    {
+        iteratedCount++;
+        retVal = HtGetNextKey(&stackIterator, &iteratedKey);
+    }
+    if (-2 != retVal || iteratedCount != HtGetKeyCount(usedTable))
+    {
+        printf("Invalid keys from HtInitIterator!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    //keys are looked up, removed and iterated while some of them are still in Old
+    CC_HASH_TABLE_OPTIONS incrementalOptions = { 0 };
+    CC_HASH_TABLE_ITERATOR* incrementalIterator = NULL;
+    char* incrementalKey = NULL;
+    int nextKey = 0;
+    int migrations = 0;
+    int incrementalCount = 0;
+    incrementalOptions.Flags = HT_FLAG_INCREMENTAL_REHASH;
+    retVal = HtCreateEx(&incrementalTable, &incrementalOptions);
+    if (0 != retVal)
+    {
+        printf("HtCreateEx failed!\n");
+        goto cleanup;
+    }
+    while (nextKey < 3000)
+    {
+        int started = AddUntilMigrating(incrementalTable, &nextKey, 3000);
+        if (started < 0)
+        {
+            printf("HtSetKeyValue failed during an incremental rehash!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+        migrations += started;
+    }
+    if (migrations < 3)
+    {
+        printf("Too few incremental migrations!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    for (int i = 0; i < 3000; i += 3)
+    {
+        if (0 != HtRemoveKey(incrementalTable, gIncrementalKeys[i]) || 0 != HtHasKey(incrementalTable, gIncrementalKeys[i]))
+        {
+            printf("HtRemoveKey failed during an incremental rehash!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    for (int i = 0; i < 3000; i++)
+    {
+        retVal = HtGetKeyValue(incrementalTable, gIncrementalKeys[i], &foundVal);
+        if ((i % 3 == 0) ? (-1 != retVal) : (0 != retVal || foundVal != i))
+        {
+            printf("Invalid value during an incremental rehash!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    incrementalCount = 2000;
+
+    //both iterator styles start in the middle of a migration
+    if (1 != AddUntilMigrating(incrementalTable, &nextKey, TEST_INCREMENTAL_KEYS))
+    {
+        printf("No migration in progress before HtInitIterator!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    incrementalCount += nextKey - 3000;
+    int oldCount = incrementalTable->OldCount;
+    retVal = HtInitIterator(incrementalTable, &stackIterator, &incrementalKey);
+    if (incrementalCount != CountIncrementalKeys(&stackIterator, retVal, incrementalKey)
+        || incrementalCount != HtGetKeyCount(incrementalTable) || oldCount != incrementalTable->OldCount)
+    {
+        printf("Invalid keys from HtInitIterator during an incremental rehash!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    int firstNew = nextKey;
+    if (1 != AddUntilMigrating(incrementalTable, &nextKey, TEST_INCREMENTAL_KEYS))
+    {
+        printf("No migration in progress before HtGetFirstKey!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    incrementalCount += nextKey - firstNew;
+    oldCount = incrementalTable->OldCount;
+    retVal = HtGetFirstKey(incrementalTable, &incrementalIterator, &incrementalKey);
+    if (incrementalCount != CountIncrementalKeys(incrementalIterator, retVal, incrementalKey)
+        || incrementalCount != HtGetKeyCount(incrementalTable) || oldCount != incrementalTable->OldCount)
+    {
+        printf("Invalid keys from HtGetFirstKey during an incremental rehash!\n");
+        HtReleaseIterator(&incrementalIterator);
+        retVal = -1;
+        goto cleanup;
+    }
+    HtReleaseIterator(&incrementalIterator);
+
+    //once the walk is over the lookups move keys again
+    for (int i = 1; i < 100; i += 3)
+    {
+        HtGetKeyValue(incrementalTable, gIncrementalKeys[i], &foundVal);
+    }
+    if (oldCount == incrementalTable->OldCount)
+    {
+        printf("Lookups did not migrate after the iteration!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    //a table owning its keys must not depend on the caller's buffer
+    CC_HASH_TABLE_OPTIONS ownOptions = { 0 };
+    char keyBuffer[64];
+    ownOptions.Flags = HT_FLAG_OWN_KEYS;
+    retVal = HtCreateEx(&ownTable, &ownOptions);
+    if (0 != retVal)
+    {
+        printf("HtCreateEx failed!\n");
+        goto cleanup;
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        //short keys go inline, long ones to the key arena
+        snprintf(keyBuffer, sizeof(keyBuffer), i % 2 ? "k%d" : "some/longer/path/to/key%d", i);
+        if (0 != HtSetKeyValue(ownTable, keyBuffer, i))
+        {
+            printf("HtSetKeyValue failed on a table owning its keys!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        snprintf(keyBuffer, sizeof(keyBuffer), i % 2 ? "k%d" : "some/longer/path/to/key%d", i);
+        if (0 != HtGetKeyValue(ownTable, keyBuffer, &foundVal) || foundVal != i)
+        {
+            printf("Invalid value in a table owning its keys!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    HtClear(ownTable);
+    if (0 != HtSetKeyValue(ownTable, "mere", 1) || 1 != HtHasKey(ownTable, "mere") || 0 != HtHasKey(ownTable, "k1"))
+    {
+        printf("Invalid keys after HtClear on a table owning its keys!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    //read-modify-write in place
+    int* valuePtr = NULL;
+    if (1 != HtUpsert(ownTable, "mere", 5) || 0 != HtUpsert(ownTable, "pere", 7) ||
+        0 != HtIncrementBy(ownTable, "prune", 3, NULL) || 1 != HtIncrementBy(ownTable, "prune", 4, &foundVal) || 7 != foundVal)
+    {
+        printf("HtUpsert / HtIncrementBy failed!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    if (0 != HtGetValuePtr(ownTable, "mere", &valuePtr) || -1 != HtGetValuePtr(ownTable, "k1", &valuePtr))
+    {
+        printf("HtGetValuePtr failed!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    HtGetValuePtr(ownTable, "mere", &valuePtr);
+    *valuePtr += 10;
+    if (0 != HtGetKeyValue(ownTable, "mere", &foundVal) || 15 != foundVal || 3 != HtGetKeyCount(ownTable))
+    {
+        printf("Invalid value after an update through HtGetValuePtr!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    //keys come back in insertion order, the holes left by removed keys get packed on rehash
+    CC_HASH_TABLE_OPTIONS orderedOptions = { 0 };
+    CC_HASH_TABLE_ITERATOR orderedIterator;
+    char* orderedKey;
+    int expected = 0;
+    orderedOptions.Flags = HT_FLAG_OWN_KEYS | HT_FLAG_INSERTION_ORDER;
+    retVal = HtCreateEx(&orderedTable, &orderedOptions);
+    if (0 != retVal)
+    {
+        printf("HtCreateEx failed!\n");
+        goto cleanup;
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        snprintf(keyBuffer, sizeof(keyBuffer), "k%d", i);
+        HtSetKeyValue(orderedTable, keyBuffer, i);
+        if (i % 3 == 0)
+        {
+            HtRemoveKey(orderedTable, keyBuffer);
+        }
+    }
+    for (int status = HtInitIterator(orderedTable, &orderedIterator, &orderedKey); status >= 0; status = HtGetNextKey(&orderedIterator, &orderedKey))
+    {
+        if (expected % 3 == 0)
+        {
+            expected++;
+        }
+        if (atoi(orderedKey + 1) != expected || orderedIterator.Current->Data != expected)
+        {
+            printf("Keys out of insertion order at %s!\n", orderedKey);
+            retVal = -1;
+            goto cleanup;
+        }
+        expected++;
+    }
+    if (999 != expected || 666 != HtGetKeyCount(orderedTable))
+    {
+        printf("Invalid key count in insertion order mode!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    //a frozen table keeps every key and refuses changes
+    if (0 != HtFreeze(orderedTable) || 666 != HtGetKeyCount(orderedTable))
+    {
+        printf("HtFreeze failed!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        snprintf(keyBuffer, sizeof(keyBuffer), "k%d", i);
+        retVal = HtGetKeyValue(orderedTable, keyBuffer, &foundVal);
+        if ((i % 3 == 0) ? (-1 != retVal) : (0 != retVal || foundVal != i))
+        {
+            printf("Invalid value in a frozen table!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    if (-1 != HtSetKeyValue(orderedTable, "k3", 3) || -1 != HtRemoveKey(orderedTable, "k1"))
+    {
+        printf("Frozen table was changed!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    //a snapshot is queried straight from the mapped file
+    if (0 != HtSaveSnapshot(orderedTable, "test_hashtable.snap")
+        || 0 != HtLoadSnapshot(&loadedTable, "test_hashtable.snap", HT_SNAPSHOT_VERIFY))
+    {
+        printf("HtSaveSnapshot / HtLoadSnapshot failed!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    if (666 != HtGetKeyCount(loadedTable) || 0 != HtGetKeyValue(loadedTable, "k998", &foundVal) || 998 != foundVal
+        || 0 != HtHasKey(loadedTable, "k999"))
+    {
+        printf("Invalid keys in a loaded snapshot!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    if (0 != TestTruncatedSnapshot())
+    {
+        retVal = -1;
+        goto cleanup;
+    }
+
+    //sized for fewer keys than it gets, the filter has to be rebuilt on the way
+    CC_HASH_TABLE_OPTIONS filteredOptions = { 0 };
+    CC_HASH_TABLE_STATS stats;
+    filteredOptions.Flags = HT_FLAG_OWN_KEYS | HT_FLAG_BLOOM_FILTER;
+    filteredOptions.ExpectedKeyCount = 1000;
+    retVal = HtCreateEx(&filteredTable, &filteredOptions);
+    if (0 != retVal)
+    {
+        printf("HtCreateEx failed!\n");
+        goto cleanup;
+    }
+    for (int i = 0; i < 5000; i++)
+    {
+        snprintf(keyBuffer, sizeof(keyBuffer), "filtered%d", i);
+        HtSetKeyValue(filteredTable, keyBuffer, i);
+        if (i % 2)
+        {
+            HtRemoveKey(filteredTable, keyBuffer);
+        }
+    }
+    for (int i = 0; i < 10000; i++)
+    {
+        snprintf(keyBuffer, sizeof(keyBuffer), "filtered%d", i);
+        if (HtHasKey(filteredTable, keyBuffer) != (i < 5000 && i % 2 == 0))
+        {
+            printf("Invalid key found in a table with a filter!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    if (0 != HtGetStats(filteredTable, &stats) || 2500 != stats.Count || 0 == stats.FilterBytes
+        || stats.FilterBitsPerKey < HT_BLOOM_BITS_PER_KEY || stats.FilterFalsePositiveRate > 0.05)
+    {
+        printf("Invalid filter statistics!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    //every key is counted once in the histogram, the keys are short enough to be inline
+    int histogramKeys = 0;
+    for (int i = 0; i < HT_STATS_PROBE_BUCKETS; i++)
+    {
+        histogramKeys += stats.ProbeHistogram[i];
+    }
+    if (2500 != histogramKeys || stats.Capacity < 2500 || stats.LoadFactor > 0.875 || 0 == stats.ResizeCount
+        || 0 == stats.SlotBytes || stats.Tombstones > 2500 || stats.MaxProbeDistance >= stats.Capacity / 16)
+    {
+        printf("Invalid table statistics!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    
+    CC_HASH_TABLE_ITERATOR* iterator = NULL;
+    char* key = NULL;
+    if (HtGetFirstKey(usedTable, &iterator, &key) < 0 || 1 != HtHasKey(usedTable, key)
+        || HtGetNextKey(iterator, &key) < 0 || 1 != HtHasKey(usedTable, key)
+        || HtGetNextKey(iterator, &key) < 0 || 1 != HtHasKey(usedTable, key))
+    {
+        printf("HtGetFirstKey or HtGetNextKey failed!\n");
+        HtReleaseIterator(&iterator);
+        retVal = -1;
+        goto cleanup;
+    }
+
+    retVal = HtReleaseIterator(&iterator);
+    if (0 != retVal || NULL != iterator)
+    {
+        printf("HtReleaseIterator failed!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    //retVal = HtClear(usedTable);
+cleanup:
+    if (NULL != usedTable)
+    {
+        if (0 != HtDestroy(&usedTable))
+        {
+            printf("HtDestroy failed!\n");
+            retVal = -1;
+        }
+    }
+    if (NULL != ownTable)
+    {
+        HtDestroy(&ownTable);
+    }
+    if (NULL != orderedTable)
+    {
+        HtDestroy(&orderedTable);
+    }
+    if (NULL != loadedTable)
+    {
+        HtDestroy(&loadedTable);
+    }
+    if (NULL != filteredTable)
+    {
+        HtDestroy(&filteredTable);
+    }
+    if (NULL != incrementalTable)
+    {
+        HtDestroy(&incrementalTable);
+    }
+    remove("test_hashtable.snap");
+    return retVal;
+}
+
+#define TEST_THREAD_COUNT   4
+#define TEST_SHARED_KEYS    1000
+
+static char gSharedKeys[TEST_SHARED_KEYS][32];
+static int gLastValues[TEST_SHARED_KEYS];
+static int gInvalidReads;   //values ReadSharedKeys saw going down or over TEST_THREAD_COUNT
+
+// Every thread adds 1 to every shared key, inserting it first if needed
+static void IncrementSharedKeys(void* Context)
+{
+    CC_CONCURRENT_HASH_TABLE* table = (CC_CONCURRENT_HASH_TABLE*)Context;
+
+    for (int i = 0; i < TEST_SHARED_KEYS; i++)
+    {
+        int current;
+
+        //half the keys go through ChtIncrementBy, the others through a compare-and-set loop
+        if (i % 2)
+        {
+            ChtIncrementBy(table, gSharedKeys[i], 1, NULL);
+            continue;
+        }
+        if (ChtGetOrInsert(table, gSharedKeys[i], 0, &current) < 0)
+        {
+            continue;
+        }
+        while (1 == ChtCompareAndSet(table, gSharedKeys[i], &current, current + 1))
+        {
+            //current now holds the value another thread stored, retry with it
+        }
+    }
+}
+
+// Reads the shared keys while the other threads update them, values only go up
+static void ReadSharedKeys(void* Context)
+{
+    CC_CONCURRENT_HASH_TABLE* table = (CC_CONCURRENT_HASH_TABLE*)Context;
+
+    for (int round = 0; round < 20; round++)
+    {
+        for (int i = 0; i < TEST_SHARED_KEYS; i++)
+        {
+            int value;
+
+            if (0 == ChtGetKeyValue(table, gSharedKeys[i], &value))
+            {
+                if (value < gLastValues[i] || value > TEST_THREAD_COUNT)
+                {
+                    gInvalidReads++;
+                }
+                gLastValues[i] = value;
+            }
+        }
+    }
+}
+
+int TestConcurrentHashTableWithFlags(int Flags)
+{
+    int retVal = -1;
+    int foundVal = -1;
+    int threadCount = 0;
+    CC_THREAD threads[TEST_THREAD_COUNT + 1];
+    CC_HASH_TABLE_OPTIONS options = { 0 };
+    CC_CONCURRENT_HASH_TABLE* usedTable = NULL;
+
+    options.Flags = Flags;
+    retVal = ChtCreate(&usedTable, 0, &options);
+    if (0 != retVal)
+    {
+        printf("ChtCreate failed!\n");
+        goto cleanup;
+    }
+
+    //the values start over for every table
+    for (int i = 0; i < TEST_SHARED_KEYS; i++)
+    {
+        snprintf(gSharedKeys[i], sizeof(gSharedKeys[i]), "shared%d", i);
+        gLastValues[i] = 0;
+    }
+    gInvalidReads = 0;
+
+    for (threadCount = 0; threadCount < TEST_THREAD_COUNT; threadCount++)
+    {
+        if (0 != CcThreadCreate(&threads[threadCount], IncrementSharedKeys, usedTable))
+        {
+            printf("CcThreadCreate failed!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    if (0 != CcThreadCreate(&threads[threadCount], ReadSharedKeys, usedTable))
+    {
+        printf("CcThreadCreate failed!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    threadCount++;
+    for (int i = 0; i < threadCount; i++)
+    {
+        CcThreadJoin(threads[i]);
+    }
+    threadCount = 0;
+
+    if (0 != gInvalidReads)
+    {
+        printf("%d invalid values read during concurrent updates!\n", gInvalidReads);
+        retVal = -1;
+        goto cleanup;
+    }
+
+    //no increment may be lost
+    for (int i = 0; i < TEST_SHARED_KEYS; i++)
+    {
+        if (0 != ChtGetKeyValue(usedTable, gSharedKeys[i], &foundVal) || foundVal != TEST_THREAD_COUNT)
+        {
+            printf("Invalid value after concurrent updates!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    if (TEST_SHARED_KEYS != ChtGetKeyCount(usedTable))
+    {
+        printf("Invalid key count after concurrent updates!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    retVal = ChtRemoveKey(usedTable, gSharedKeys[0]);
+    if (0 != retVal || 0 != ChtHasKey(usedTable, gSharedKeys[0]) || 1 != ChtHasKey(usedTable, gSharedKeys[1]))
+    {
+        printf("ChtRemoveKey failed!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    CC_CONCURRENT_HASH_TABLE_ITERATOR* iterator = NULL;
+    char* key = NULL;
+    int iterated = 0;
+    retVal = ChtGetFirstKey(usedTable, &iterator, &key);
+    while (retVal >= 0)
+    {
+        iterated++;
+        retVal = ChtGetNextKey(iterator, &key);
+    }
+    ChtReleaseIterator(&iterator);
+    if (TEST_SHARED_KEYS - 1 != iterated)
+    {
+        printf("Invalid number of keys iterated!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    retVal = ChtClear(usedTable);
+    if (0 != retVal || 0 != ChtGetKeyCount(usedTable))
+    {
+        printf("ChtClear failed!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+cleanup:
+    for (int i = 0; i < threadCount; i++)
+    {
+        CcThreadJoin(threads[i]);
+    }
+    if (NULL != usedTable)
+    {
+        if (0 != ChtDestroy(&usedTable))
+        {
+            printf("ChtDestroy failed!\n");
+            retVal = -1;
+        }
+    }
+    return retVal;
+}
+
+// EpSynchronize waits for the readers inside and gives up on one that never leaves
+static int TestEpochSynchronize(void)
+{
+    int retVal = -1;
+    int token;
+    CC_EPOCH epoch;
+
+    if (0 != EpInit(&epoch))
+    {
+        printf("EpInit failed!\n");
+        return -1;
+    }
+
+    if (0 != EpSynchronize(&epoch))
+    {
+        printf("EpSynchronize failed without readers!\n");
+        goto cleanup;
+    }
+
+    token = EpEnter(&epoch);
+    if (-1 != EpSynchronize(&epoch))
+    {
+        printf("EpSynchronize did not wait for a reader!\n");
+        EpExit(&epoch, token);
+        goto cleanup;
+    }
+    EpExit(&epoch, token);
+
+    if (0 != EpSynchronize(&epoch))
+    {
+        printf("EpSynchronize failed after the reader left!\n");
+        goto cleanup;
+    }
+    retVal = 0;
+
+cleanup:
+    EpDestroy(&epoch);
+    return retVal;
+}
+
+int TestConcurrentHashTable()
+{
+    if (0 != TestEpochSynchronize())
+    {
+        return -1;
+    }
+    if (0 != TestConcurrentHashTableWithFlags(0))
+    {
+        return -1;
+    }
+    return TestConcurrentHashTableWithFlags(CHT_FLAG_LOCK_FREE_READS);
+}
+
+int TestIntMap()
+{
+    int retVal = -1;
+    int foundVal = -1;
+    int iterated = 0;
+    long long key;
+    CC_INT_MAP* usedMap = NULL;
+    CC_INT_MAP_ITERATOR* iterator = NULL;
+
+    retVal = ImCreate(&usedMap);
+    if (0 != retVal)
+    {
+        printf("ImCreate failed!\n");
+        goto cleanup;
+    }
+
+    //ids far apart and negative ones hash as well as consecutive ones
+    for (long long i = -500; i < 500; i++)
+    {
+        if (0 != ImSetKeyValue(usedMap, i * 1000003, (int)i))
+        {
+            printf("ImSetKeyValue failed!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    if (-1 != ImSetKeyValue(usedMap, 0, 1))
+    {
+        printf("ImSetKeyValue accepted a duplicate key!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    for (long long i = -500; i < 500; i += 2)
+    {
+        ImRemoveKey(usedMap, i * 1000003);
+    }
+    if (500 != ImGetKeyCount(usedMap) || 0 != ImGetKeyValue(usedMap, -499LL * 1000003, &foundVal) || -499 != foundVal
+        || 0 != ImHasKey(usedMap, -500LL * 1000003))
+    {
+        printf("Invalid values in the map!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    for (retVal = ImGetFirstKey(usedMap, &iterator, &key); retVal == 0; retVal = ImGetNextKey(iterator, &key))
+    {
+        if (0 != ImGetKeyValue(usedMap, key, &foundVal) || key != foundVal * 1000003LL)
+        {
+            printf("Invalid key from the iterator!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+        iterated++;
+    }
+    if (500 != iterated)
+    {
+        printf("Iterator missed keys!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    ImClear(usedMap);
+    if (0 != ImGetKeyCount(usedMap) || 0 != ImHasKey(usedMap, 1000003) || 0 != ImSetKeyValue(usedMap, 7, 7))
+    {
+        printf("Invalid map after ImClear!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    retVal = 0;
+
+cleanup:
+    if (NULL != iterator)
+    {
+        ImReleaseIterator(&iterator);
+    }
+    if (NULL != usedMap)
+    {
+        if (0 != ImDestroy(&usedMap))
+        {
+            printf("ImDestroy failed!\n");
+            retVal = -1;
+        }
+    }
+    return retVal;
+}
+
+int TestStack()
+{
+    int retVal = -1;
+    int foundVal = -1;
+    CC_STACK* usedStack = NULL;
+
+    retVal = StCreate(&usedStack);
+    if (0 != retVal)
+    {
+        printf("StCreate failed!\n");
+        goto cleanup;
+    }
+
+    retVal = StPush(usedStack, 10);
+    if (0 != retVal)
+    {
+        printf("StPush failed!\n");
+        goto cleanup;
+    }
+
+    if (0 != StIsEmpty(usedStack))
+    {
+        printf("Invalid answer to StIsEmpty!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    retVal = StPush(usedStack, 10);
+    retVal = StPop(usedStack, &foundVal);
+    if (0 != retVal)
+    {
+        printf("StPop failed!\n");
+        goto cleanup;
+    }
+
+    if (foundVal != 10)
+    {
+        printf("Invalid value after pop!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    retVal = StPush(usedStack, 10);
+    retVal = StPush(usedStack, 11);
+    retVal = StPush(usedStack, 12);
+    retVal = StPush(usedStack, 13);
+    if (0 != StClear(usedStack)) 
+    {
+        printf("Invalid answer to StClear!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    CC_STACK* stack1 = NULL;
+    CC_STACK* stack2 = NULL;
+    retVal = StCreate(&stack1);
+    retVal = StCreate(&stack2);
+
+    retVal = StPush(stack1, 10);
+    retVal = StPush(stack1, 11);
+    retVal = StPush(stack2, 12);
+    retVal = StPush(stack2, 13);
+
+    if (0 != StPushStack(stack1, stack2)) 
+    {
+        printf("StPushStack failed!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+
+
+cleanup:
+    if (NULL != usedStack)
+    {
+        if (0 != StDestroy(&usedStack))
+        {
+            printf("StDestroy failed!\n");
+            retVal = -1;
+        }
+    }
+    StDestroy(&stack1);
+    StDestroy(&stack2);
+    return retVal;
+}
+
+static int CompareIntsAscending(const void* Left, const void* Right)
+{
+    int left = *(const int*)Left;
+    int right = *(const int*)Right;
+
+    return (left > right) - (left < right);
+}
+
+// Fills Array with Count values of Pattern: 0 random, 1 sorted, 2 reversed, 3 few unique
+static void FillSortInput(int* Array, int Count, int Pattern)
+{
+    for (int i = 0; i < Count; i++)
+    {
+        switch (Pattern)
+        {
+        case 0:
+            Array[i] = (int)(((unsigned int)rand() << 16) ^ (unsigned int)rand());
+            break;
+        case 1:
+        case 4:
+            Array[i] = i - Count / 2;
+            break;
+        case 2:
+        case 5:
+            Array[i] = Count / 2 - i;
+            break;
+        default:
+            Array[i] = rand() % 4 - 2;
+            break;
+        }
+    }
+    //almost in order, the first scan cannot take the input as sorted or reversed
+    if (Count > 2 && Pattern >= 4)
+    {
+        for (int i = 0; i < Count / 32 + 1; i++)
+        {
+            int first = rand() % Count;
+            int second = rand() % Count;
+            int swapped = Array[first];
+
+            Array[first] = Array[second];
+            Array[second] = swapped;
+        }
+        Array[0] = Array[Count - 1] + (Pattern == 4 ? 1 : -1);
+    }
+    //the extremes check the sign handling of the radix sort, sorted input is kept sorted
+    if (Count > 2 && (Pattern == 0 || Pattern == 3))
+    {
+        Array[Count / 3] = INT_MIN;
+        Array[Count / 2] = INT_MAX;
+    }
+}
+
+// Sorts the same input with VecSortEx, SrtIntroSort, SrtRadixSort and VecSortParallelEx
+// in both orders and compares them with qsort
+static int TestVectorSortPattern(CC_VECTOR* Vector, int Count, int Pattern)
+{
+    int retVal = -1;
+    int* input = (int*)malloc(sizeof(int) * (size_t)(Count + 1));
+    int* expected = (int*)malloc(sizeof(int) * (size_t)(Count + 1));
+    int* sorted = (int*)malloc(sizeof(int) * (size_t)(Count + 1));
+
+    if (NULL == input || NULL == expected || NULL == sorted)
+    {
+        goto cleanup;
+    }
+
+    FillSortInput(input, Count, Pattern);
+    memcpy(expected, input, sizeof(int) * (size_t)Count);
+    qsort(expected, (size_t)Count, sizeof(int), CompareIntsAscending);
+
+    for (int order = VEC_SORT_DESCENDING; order <= VEC_SORT_ASCENDING; order++)
+    {
+        for (int engine = 0; engine < 4; engine++)
+        {
+            VecClear(Vector);
+            if (0 != VecInsertRange(Vector, 0, input, Count))
+            {
+                goto cleanup;
+            }
+
+            if (engine == 0)
+            {
+                if (0 != VecSortEx(Vector, order))
+                {
+                    goto cleanup;
+                }
+            }
+            else if (engine == 1)
+            {
+                SrtIntroSort(Vector->Array, Count, order == VEC_SORT_DESCENDING);
+            }
+            else if (engine == 2)
+            {
+                if (0 != SrtRadixSort(Vector->Array, Count, order == VEC_SORT_DESCENDING, sorted))
+                {
+                    goto cleanup;
+                }
+            }
+            else if (0 != VecSortParallelEx(Vector, 4, order))
+            {
+                goto cleanup;
+            }
+
+            for (int i = 0; i < Count; i++)
+            {
+                int value = order == VEC_SORT_ASCENDING ? expected[i] : expected[Count - 1 - i];
+
+                if (Vector->Array[i] != value)
+                {
+                    printf("Invalid sort of %d elements, pattern %d, order %d, engine %d\n", Count, Pattern, order, engine);
+                    goto cleanup;
+                }
+            }
+        }
+    }
+    retVal = 0;
+
+cleanup:
+    free(input);
+    free(expected);
+    free(sorted);
+    return retVal;
+}
+
+// Checks VecSum, VecMinMax, VecFind, VecCountEqual and VecFillRange against plain
+// loops at every SIMD level, on sizes that leave a tail after the last full block and
+// large enough for the fill to bypass the cache
+static int TestVectorKernels(CC_VECTOR* Vector)
+{
+    int counts[] = { 1, 7, 8, 31, 32, 33, 100, 1000, 4099, 1100000 };
+
+    for (int level = CC_SIMD_NONE; level <= CC_SIMD_AVX2; level++)
+    {
+        CcSetSimdLevel(level);
+        for (int i = 0; i < (int)(sizeof(counts) / sizeof(counts[0])); i++)
+        {
+            int count = counts[i];
+            long long sum = 0;
+            long long expectedSum = 0;
+            int min = 0;
+            int max = 0;
+            int expectedMin = INT_MAX;
+            int expectedMax = INT_MIN;
+            int equal = 0;
+
+            VecClear(Vector);
+            for (int j = 0; j < count; j++)
+            {
+                //large values overflow a 32-bit sum
+                int value = j % 5 == 0 ? 7 : (int)(((unsigned int)rand() << 16) ^ (unsigned int)rand());
+
+                VecInsertTail(Vector, value);
+                expectedSum += value;
+                expectedMin = value < expectedMin ? value : expectedMin;
+                expectedMax = value > expectedMax ? value : expectedMax;
+                equal += value == 7;
+            }
+
+            if ((size_t)Vector->Array % VEC_ALIGNMENT != 0
+                || 0 != VecSum(Vector, &sum) || sum != expectedSum
+                || 0 != VecMinMax(Vector, &min, &max) || min != expectedMin || max != expectedMax
+                || VecCountEqual(Vector, 7) != equal || VecFind(Vector, 7) != 0)
+            {
+                printf("Vector kernels failed on %d elements, SIMD level %d\n", count, level);
+                CcSetSimdLevel(CC_SIMD_AVX2);
+                return -1;
+            }
+
+            //the last element only, then no element at all
+            Vector->Array[count - 1] = INT_MIN;
+            if (VecFind(Vector, INT_MIN) != count - 1 || 0 != VecFillRange(Vector, 0, count, 3)
+                || VecFind(Vector, INT_MIN) != -1 || VecCountEqual(Vector, 3) != count)
+            {
+                printf("VecFind / VecFillRange failed on %d elements, SIMD level %d\n", count, level);
+                CcSetSimdLevel(CC_SIMD_AVX2);
+                return -1;
+            }
+
+            //a range that is not aligned on either end
+            if (count > 2 && (0 != VecFillRange(Vector, 1, count - 2, 4) || VecCountEqual(Vector, 4) != count - 2
+                || Vector->Array[0] != 3 || Vector->Array[count - 1] != 3 || -1 != VecFillRange(Vector, 1, count, 4)))
+            {
+                printf("VecFillRange failed on a range of %d elements, SIMD level %d\n", count - 2, level);
+                CcSetSimdLevel(CC_SIMD_AVX2);
+                return -1;
+            }
+        }
+    }
+    CcSetSimdLevel(CC_SIMD_AVX2);
+
+    VecClear(Vector);
+    if (-1 != VecMinMax(Vector, &counts[0], &counts[1]) || -1 != VecFind(Vector, 0) || 0 != VecCountEqual(Vector, 0))
+    {
+        printf("Vector kernels failed on an empty vector\n");
+        return -1;
+    }
+    return 0;
+}
+
+// VecCreateSmall and VecInit: the elements stay in the inline buffer while they fit,
+// move to an allocated array past it and come back when shrunk
+static int TestSmallVector()
+{
+    int retVal = -1;
+    int buffer[41];
+    long long sum = 0;
+    int min = 0;
+    int max = 0;
+    CC_VECTOR* smallVector = NULL;
+    CC_VECTOR embedded;
+    CC_SMALL_VECTOR(4) local;
+
+    memset(&embedded, 0, sizeof(embedded));
+    memset(&local, 0, sizeof(local));
+    if (0 != VecCreateSmall(&smallVector, 8) || smallVector->Array != smallVector->Inline || 8 != smallVector->Size
+        || 0 != VEC_INIT_SMALL(local) || local.Vector.Array != local.Inline || 4 != local.Vector.Size
+        || -1 != VecInit(&embedded, NULL, 4) || -1 != VecCreateSmall(&smallVector, -1))
+    {
+        printf("VecCreateSmall / VecInit failed!\n");
+        goto cleanup;
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        VecInsertTail(smallVector, i);
+    }
+    if (smallVector->Array != smallVector->Inline || 0 != VecInsertHead(smallVector, -1) || smallVector->Array == smallVector->Inline
+        || (size_t)smallVector->Array % VEC_ALIGNMENT != 0 || 9 != VecGetCount(smallVector) || -1 != smallVector->Array[0] || 7 != smallVector->Array[8])
+    {
+        printf("Small vector did not move past its inline buffer!\n");
+        goto cleanup;
+    }
+    if (0 != VecRemoveRange(smallVector, 0, 6) || 0 != VecShrinkToFit(smallVector) || smallVector->Array != smallVector->Inline || 8 != smallVector->Size
+        || 3 != VecGetCount(smallVector) || 5 != smallVector->Array[0] || 7 != smallVector->Array[2])
+    {
+        printf("Small vector did not come back to its inline buffer!\n");
+        goto cleanup;
+    }
+
+    //an inline buffer that is not aligned for the SIMD kernels
+    if (0 != VecInit(&embedded, buffer + 1, 40))
+    {
+        goto cleanup;
+    }
+    VecInsertManyAt(&embedded, 0, 0, 40);
+    for (int level = CC_SIMD_NONE; level <= CC_SIMD_AVX2; level++)
+    {
+        CcSetSimdLevel(level);
+        for (int i = 0; i < 40; i++)
+        {
+            embedded.Array[i] = i % 10;
+        }
+        if (embedded.Array != buffer + 1 || 0 != VecSum(&embedded, &sum) || 180 != sum || 0 != VecMinMax(&embedded, &min, &max)
+            || 0 != min || 9 != max || 4 != VecCountEqual(&embedded, 9) || 9 != VecFind(&embedded, 9)
+            || 0 != VecFillRange(&embedded, 3, 30, 11) || 30 != VecCountEqual(&embedded, 11))
+        {
+            printf("Vector kernels failed on an inline buffer, SIMD level %d\n", level);
+            CcSetSimdLevel(CC_SIMD_AVX2);
+            goto cleanup;
+        }
+    }
+    CcSetSimdLevel(CC_SIMD_AVX2);
+
+    VecInsertTail(&embedded, 12);
+    VecInsertTail(&local.Vector, 13);
+    if (embedded.Array == buffer + 1 || 41 != VecGetCount(&embedded) || 11 != embedded.Array[3] || 12 != embedded.Array[40]
+        || 0 != VecSort(&embedded) || 12 != embedded.Array[0] || 13 != local.Inline[0])
+    {
+        printf("Embedded vector failed!\n");
+        goto cleanup;
+    }
+    retVal = 0;
+
+cleanup:
+    VecDestroy(&smallVector);
+    VecUninit(&embedded);
+    VecUninit(&local.Vector);
+    return retVal;
+}
+
+#define TEST_MAPPED_PATH    "test_mapped_vector.bin"
+
+// VecCreateMapped: the elements are back when the file is opened again, the in memory
+// and the external sort of a mapped vector match qsort
+static int TestMappedVector()
+{
+    int retVal = -1;
+    int count = 100000;
+    int* expected = (int*)malloc(sizeof(int) * (size_t)count);
+    CC_VECTOR* mapped = NULL;
+    CC_VECTOR* memory = NULL;
+    FILE* file = NULL;
+
+    remove(TEST_MAPPED_PATH);
+    if (NULL == expected || 0 != VecCreate(&memory) || 0 != VecCreateMapped(&mapped, TEST_MAPPED_PATH)
+        || 0 != VecGetCount(mapped) || (size_t)mapped->Array % VEC_ALIGNMENT != 0)
+    {
+        printf("VecCreateMapped failed!\n");
+        goto cleanup;
+    }
+
+    FillSortInput(expected, count, 0);
+    if (0 != VecInsertRange(memory, 0, expected + 1000, count - 1000) || 0 != VecAdvise(mapped, VEC_ACCESS_SEQUENTIAL)
+        || -1 != VecAdvise(mapped, 3))
+    {
+        goto cleanup;
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        if (0 != VecInsertTail(mapped, expected[i]))
+        {
+            printf("VecInsertTail failed on a mapped vector!\n");
+            goto cleanup;
+        }
+    }
+    if (0 != VecAppend(memory, mapped) || count != VecGetCount(mapped) || 0 != VecSync(mapped) || 0 != VecDestroy(&mapped))
+    {
+        printf("VecAppend / VecSync failed on a mapped vector!\n");
+        goto cleanup;
+    }
+
+    //opened again, then the external sort with runs of 8192 elements
+    if (0 != VecCreateMapped(&mapped, TEST_MAPPED_PATH) || count != VecGetCount(mapped)
+        || 0 != memcmp(mapped->Array, expected, sizeof(int) * (size_t)count))
+    {
+        printf("Mapped vector changed when opened again!\n");
+        goto cleanup;
+    }
+    qsort(expected, (size_t)count, sizeof(int), CompareIntsAscending);
+    for (int engine = 0; engine < 3; engine++)
+    {
+        VecSetSortMemory(engine == 0 ? 0 : 64 * 1024);
+        if (0 != VecSortEx(mapped, VEC_SORT_DESCENDING) || expected[count - 1] != mapped->Array[0] || expected[0] != mapped->Array[count - 1]
+            || 0 != (engine == 2 ? VecSortParallelEx(mapped, 4, VEC_SORT_ASCENDING) : VecSortEx(mapped, VEC_SORT_ASCENDING))
+            || 0 != memcmp(mapped->Array, expected, sizeof(int) * (size_t)count))
+        {
+            printf("Invalid sort of a mapped vector, engine %d\n", engine);
+            VecSetSortMemory(0);
+            goto cleanup;
+        }
+    }
+    VecSetSortMemory(0);
+
+    //the count is written by VecDestroy too, the file shrinks with the vector
+    if (0 != VecRemoveRange(mapped, 10, count - 20) || 0 != VecShrinkToFit(mapped) || 20 != mapped->Size || 0 != VecDestroy(&mapped)
+        || 0 != VecCreateMapped(&mapped, TEST_MAPPED_PATH) || 20 != VecGetCount(mapped) || expected[count - 1] != mapped->Array[19])
+    {
+        printf("Mapped vector did not keep its elements!\n");
+        goto cleanup;
+    }
+    VecDestroy(&mapped);
+
+    //a file that is not a vector is left alone
+    file = fopen(TEST_MAPPED_PATH, "wb");
+    if (NULL == file)
+    {
+        goto cleanup;
+    }
+    fputs("not a vector", file);
+    fclose(file);
+    if (-1 != VecCreateMapped(&mapped, TEST_MAPPED_PATH))
+    {
+        printf("VecCreateMapped opened a file that is not a vector!\n");
+        goto cleanup;
+    }
+    retVal = 0;
+
+cleanup:
+    VecDestroy(&mapped);
+    VecDestroy(&memory);
+    remove(TEST_MAPPED_PATH);
+    free(expected);
+    return retVal;
+}
+
+typedef struct _TEST_RECORD {
+    int Id;
+    int Position;
+    double Score;
+} TEST_RECORD;
+
+#define TEST_RECORD_LESS(A, B)  ((A).Id < (B).Id)
+
+CC_VECTOR_DEFINE(CC_VECTOR_I64, long long, SRT_LESS)
+CC_VECTOR_DEFINE_SUM(CC_VECTOR_I64, long long, long long)
+CC_VECTOR_DEFINE(CC_VECTOR_F64, double, SRT_LESS)
+CC_VECTOR_DEFINE(CC_VECTOR_RECORD, TEST_RECORD, TEST_RECORD_LESS)
+
+static int CompareI64Ascending(const void* Left, const void* Right)
+{
+    long long left = *(const long long*)Left;
+    long long right = *(const long long*)Right;
+
+    return (left > right) - (left < right);
+}
+
+static int CompareF64Ascending(const void* Left, const void* Right)
+{
+    double left = *(const double*)Left;
+    double right = *(const double*)Right;
+
+    return (left > right) - (left < right);
+}
+
+// Sorts long longs, doubles and records made from the same input with SortEx and
+// SortParallelEx in both orders, the numbers are compared with qsort and the records
+// must be in Id order with their other fields still matching the Id
+static int TestTypedVectorSortPattern(int Count, int Pattern)
+{
+    int retVal = -1;
+    int* input = (int*)malloc(sizeof(int) * (size_t)(Count + 1));
+    long long* expectedI64 = (long long*)malloc(sizeof(long long) * (size_t)(Count + 1));
+    double* expectedF64 = (double*)malloc(sizeof(double) * (size_t)(Count + 1));
+    CC_VECTOR_I64* vectorI64 = NULL;
+    CC_VECTOR_F64* vectorF64 = NULL;
+    CC_VECTOR_RECORD* vectorRecord = NULL;
+
+    if (NULL == input || NULL == expectedI64 || NULL == expectedF64 || 0 != CC_VECTOR_I64Create(&vectorI64)
+        || 0 != CC_VECTOR_F64Create(&vectorF64) || 0 != CC_VECTOR_RECORDCreateWithCapacity(&vectorRecord, Count))
+    {
+        goto cleanup;
+    }
+
+    FillSortInput(input, Count, Pattern);
+    for (int i = 0; i < Count; i++)
+    {
+        //the low bits keep the values apart when the ints are equal
+        expectedI64[i] = (long long)input[i] * 1048576 + i % 1024;
+        expectedF64[i] = input[i] / 3.0;
+    }
+    qsort(expectedI64, (size_t)Count, sizeof(long long), CompareI64Ascending);
+    qsort(expectedF64, (size_t)Count, sizeof(double), CompareF64Ascending);
+
+    for (int order = VEC_SORT_DESCENDING; order <= VEC_SORT_ASCENDING; order++)
+    {
+        for (int engine = 0; engine < 2; engine++)
+        {
+            CC_VECTOR_I64Clear(vectorI64);
+            CC_VECTOR_F64Clear(vectorF64);
+            CC_VECTOR_RECORDClear(vectorRecord);
+            for (int i = 0; i < Count; i++)
+            {
+                TEST_RECORD record = { input[i], i, input[i] * 0.5 };
+
+                if (0 != CC_VECTOR_I64InsertTail(vectorI64, (long long)input[i] * 1048576 + i % 1024)
+                    || 0 != CC_VECTOR_F64InsertTail(vectorF64, input[i] / 3.0) || 0 != CC_VECTOR_RECORDInsertTail(vectorRecord, record))
+                {
+                    goto cleanup;
+                }
+            }
+
+            if (engine == 0)
+            {
+                if (0 != CC_VECTOR_I64SortEx(vectorI64, order) || 0 != CC_VECTOR_F64SortEx(vectorF64, order)
+                    || 0 != CC_VECTOR_RECORDSortEx(vectorRecord, order))
+                {
+                    goto cleanup;
+                }
+            }
+            else if (0 != CC_VECTOR_I64SortParallelEx(vectorI64, 4, order) || 0 != CC_VECTOR_F64SortParallelEx(vectorF64, 4, order)
+                || 0 != CC_VECTOR_RECORDSortParallelEx(vectorRecord, 4, order))
+            {
+                goto cleanup;
+            }
+
+            for (int i = 0; i < Count; i++)
+            {
+                int expected = order == VEC_SORT_ASCENDING ? i : Count - 1 - i;
+                TEST_RECORD* record = &vectorRecord->Array[i];
+
+                if (vectorI64->Array[i] != expectedI64[expected] || vectorF64->Array[i] != expectedF64[expected]
+                    || record->Score != record->Id * 0.5 || input[record->Position] != record->Id
+                    || (i > 0 && (order == VEC_SORT_ASCENDING ? record[-1].Id > record->Id : record[-1].Id < record->Id)))
+                {
+                    printf("Invalid typed sort of %d elements, pattern %d, order %d, engine %d\n", Count, Pattern, order, engine);
+                    goto cleanup;
+                }
+            }
+        }
+    }
+    retVal = 0;
+
+cleanup:
+    CC_VECTOR_I64Destroy(&vectorI64);
+    CC_VECTOR_F64Destroy(&vectorF64);
+    CC_VECTOR_RECORDDestroy(&vectorRecord);
+    free(input);
+    free(expectedI64);
+    free(expectedF64);
+    return retVal;
+}
+
+// The CC_VECTOR_DEFINE vectors, the edits mirror TestVector with values that do not
+// fit an int
+static int TestTypedVector()
+{
+    int retVal = -1;
+    long long big = 3000000000LL;
+    long long range[] = { 100 * big, 101 * big, 102 * big };
+    long long value = 0;
+    long long sum = 0;
+    long long min = 0;
+    long long max = 0;
+    CC_VECTOR_I64* vector = NULL;
+    CC_VECTOR_I64* other = NULL;
+    int counts[] = { 0, 1, 2, 17, 1000, 4 * SRT_PARALLEL_MIN_CHUNK + 1 };
+
+    if (0 != CC_VECTOR_I64Create(&vector) || NULL != vector->Array || 0 != CC_VECTOR_I64CreateWithCapacity(&other, 100)
+        || 100 != other->Size)
+    {
+        printf("CC_VECTOR_DEFINE Create failed!\n");
+        goto cleanup;
+    }
+
+    for (int i = 0; i < 10; i++)
+    {
+        if (0 != CC_VECTOR_I64InsertTail(vector, i * big))
+        {
+            printf("CC_VECTOR_DEFINE InsertTail failed!\n");
+            goto cleanup;
+        }
+    }
+    //0 1 2 100 101 102 3 4 5 6 7 8 9 7 7 7, times big
+    if (0 != CC_VECTOR_I64InsertRange(vector, 3, range, 3) || 0 != CC_VECTOR_I64InsertManyAt(vector, 13, 7 * big, 3)
+        || -1 != CC_VECTOR_I64InsertRange(vector, 17, range, 1) || 16 != CC_VECTOR_I64GetCount(vector)
+        || 101 * big != vector->Array[4] || 3 * big != vector->Array[6] || 7 * big != vector->Array[15])
+    {
+        printf("CC_VECTOR_DEFINE InsertRange / InsertManyAt failed!\n");
+        goto cleanup;
+    }
+    if (0 != CC_VECTOR_I64Sum(vector, &sum) || 369 * big != sum || 0 != CC_VECTOR_I64MinMax(vector, &min, &max)
+        || 0 != min || 102 * big != max || 3 != CC_VECTOR_I64Find(vector, 100 * big) || -1 != CC_VECTOR_I64Find(vector, 1)
+        || 4 != CC_VECTOR_I64CountEqual(vector, 7 * big))
+    {
+        printf("CC_VECTOR_DEFINE Sum / MinMax / Find / CountEqual failed!\n");
+        goto cleanup;
+    }
+    //drop the inserted range, then 0 goes away and 7 takes its place
+    if (0 != CC_VECTOR_I64RemoveRange(vector, 3, 3) || -1 != CC_VECTOR_I64RemoveRange(vector, 10, 4)
+        || 0 != CC_VECTOR_I64SwapRemove(vector, 0) || 12 != CC_VECTOR_I64GetCount(vector) || 7 * big != vector->Array[0]
+        || 1 * big != vector->Array[1] || 9 * big != vector->Array[9])
+    {
+        printf("CC_VECTOR_DEFINE RemoveRange / SwapRemove failed!\n");
+        goto cleanup;
+    }
+    if (0 != CC_VECTOR_I64InsertHead(vector, -big) || 0 != CC_VECTOR_I64InsertAfterIndex(vector, 0, -2 * big)
+        || 0 != CC_VECTOR_I64RemoveByIndex(vector, 2) || 0 != CC_VECTOR_I64GetValueByIndex(vector, 1, &value) || -2 * big != value
+        || 0 != CC_VECTOR_I64FillRange(vector, 2, 11, big) || -1 != CC_VECTOR_I64FillRange(vector, 2, 12, big)
+        || 11 != CC_VECTOR_I64CountEqual(vector, big) || 0 != CC_VECTOR_I64Sort(vector) || big != vector->Array[0]
+        || -2 * big != vector->Array[12])
+    {
+        printf("CC_VECTOR_DEFINE InsertHead / FillRange / Sort failed!\n");
+        goto cleanup;
+    }
+
+    //the elements of vector go to the end of other
+    if (0 != CC_VECTOR_I64InsertTail(other, 5) || 0 != CC_VECTOR_I64Append(vector, other) || 14 != other->Count
+        || 5 != other->Array[0] || -2 * big != other->Array[13] || 0 != CC_VECTOR_I64Clear(other)
+        || 0 != CC_VECTOR_I64ShrinkToFit(other) || NULL != other->Array || 0 != CC_VECTOR_I64Reserve(other, 50) || 50 != other->Size)
+    {
+        printf("CC_VECTOR_DEFINE Append / ShrinkToFit / Reserve failed!\n");
+        goto cleanup;
+    }
+
+    for (int i = 0; i < (int)(sizeof(counts) / sizeof(counts[0])); i++)
+    {
+        for (int pattern = 0; pattern < 4; pattern++)
+        {
+            if (0 != TestTypedVectorSortPattern(counts[i], pattern))
+            {
+                goto cleanup;
+            }
+        }
+    }
+    retVal = 0;
+
+cleanup:
+    CC_VECTOR_I64Destroy(&vector);
+    CC_VECTOR_I64Destroy(&other);
+    return retVal;
+}
+
+int TestVector()
+{
+    int retVal = -1;
+    int retVal2 = -1;
+    int foundVal = 0;
+    CC_VECTOR* usedVector = NULL;
+    CC_VECTOR* usedVector2 = NULL;
+    CC_VECTOR* sizedVector = NULL;
+    
+    retVal = VecCreate(&usedVector);
+    retVal2 = VecCreate(&usedVector2);
+
+    if (0 != retVal)
+    {
+        printf("VecCreate failed!\n");
+        goto cleanup;
+    }
+
+    if (0 != retVal2)
+    {
+        printf("VecCreate failed!\n");
+        goto cleanup;
+    }
+
+    //nothing is allocated before the first insert
+    if (NULL != usedVector->Array || 0 != usedVector->Size)
+    {
+        printf("VecCreate allocated an array!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    retVal = VecCreateWithCapacity(&sizedVector, 100);
+    if (0 != retVal || 100 != sizedVector->Size)
+    {
+        printf("VecCreateWithCapacity failed!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        VecInsertTail(sizedVector, i);
+    }
+    if (0 != VecShrinkToFit(sizedVector) || 1000 != sizedVector->Size
+        || 0 != VecReserve(sizedVector, 5000) || 5000 != sizedVector->Size || 0 != VecReserve(sizedVector, 10) || 5000 != sizedVector->Size)
+    {
+        printf("VecReserve / VecShrinkToFit failed!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        if (0 != VecGetValueByIndex(sizedVector, i, &foundVal) || foundVal != i)
+        {
+            printf("Invalid value after VecReserve / VecShrinkToFit!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    VecClear(sizedVector);
+    if (0 != VecShrinkToFit(sizedVector) || NULL != sizedVector->Array)
+    {
+        printf("VecShrinkToFit kept the array of an empty vector!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    //range edits: 0 1 2 3 4 5 6 7 8 9 with 100 101 102 inserted at 3, then 3 copies of 7 at the end
+    int range[] = { 100, 101, 102 };
+    int expectedRange[] = { 0, 1, 2, 100, 101, 102, 3, 4, 5, 6, 7, 8, 9, 7, 7, 7 };
+    for (int i = 0; i < 10; i++)
+    {
+        VecInsertTail(sizedVector, i);
+    }
+    if (0 != VecInsertRange(sizedVector, 3, range, 3) || 0 != VecInsertManyAt(sizedVector, 13, 7, 3)
+        || -1 != VecInsertRange(sizedVector, 17, range, 1) || 16 != VecGetCount(sizedVector))
+    {
+        printf("VecInsertRange / VecInsertManyAt failed!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    for (int i = 0; i < 16; i++)
+    {
+        if (sizedVector->Array[i] != expectedRange[i])
+        {
+            printf("Invalid value after VecInsertRange / VecInsertManyAt!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+    //drop the inserted range, then 0 goes away and 7 takes its place
+    if (0 != VecRemoveRange(sizedVector, 3, 3) || -1 != VecRemoveRange(sizedVector, 10, 4) || 0 != VecSwapRemove(sizedVector, 0)
+        || 12 != VecGetCount(sizedVector) || 7 != sizedVector->Array[0] || 1 != sizedVector->Array[1] || 9 != sizedVector->Array[9])
+    {
+        printf("VecRemoveRange / VecSwapRemove failed!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    retVal = TestVectorKernels(sizedVector);
+    if (0 != retVal)
+    {
+        goto cleanup;
+    }
+
+    retVal = TestSmallVector();
+    if (0 != retVal)
+    {
+        goto cleanup;
+    }
+
+    retVal = TestMappedVector();
+    if (0 != retVal)
+    {
+        goto cleanup;
+    }
+
+    retVal = TestTypedVector();
+    if (0 != retVal)
+    {
+        goto cleanup;
+    }
+
+    retVal = VecInsertTail(usedVector, 10);
+    if (0 != retVal)
+    {
+        printf("VecInsertTail failed!\n");
+        goto cleanup;
+    }
+
+    retVal = VecInsertHead(usedVector, 16);
+    if (0 != retVal)
+    {
+        printf("VecInsertHead failed!\n");
+        goto cleanup;
+    }
+
+    if (VecGetCount(usedVector) != 2)
+    {
+        printf("Invalid count returned!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    retVal = VecInsertAfterIndex(usedVector, 0, 20);
+    if (0 != retVal)
+    {
+        printf("VecInsertAfterIndex failed!\n");
+        goto cleanup;
+    }
+
+    retVal = VecRemoveByIndex(usedVector, 0);
+    if (0 != retVal)
+    {
+        printf("VecRemoveByIndex failed!\n");
+        goto cleanup;
+    }
+
+    retVal = VecGetValueByIndex(usedVector, 0, &foundVal);
+    if (0 != retVal)
+    {
+        printf("VecGetValueByIndex failed!\n");
+        goto cleanup;
+    }
+
+    if (foundVal != 20)
+    {
+        printf("Invalid value found at position 0\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    retVal = VecClear(usedVector);
+    if (0 != retVal)
+    {
+        printf("VecClear failed!\n");
+        goto cleanup;
+    }
+
+    if (0 != VecGetCount(usedVector))
+    {
+        printf("Invalid count after clear\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    retVal = VecInsertTail(usedVector, 15);
+    retVal = VecInsertTail(usedVector, 150);
+    retVal = VecInsertTail(usedVector, 425);
+    retVal = VecInsertTail(usedVector, 65465);
+    retVal = VecInsertTail(usedVector, 2156);
+    retVal = VecInsertTail(usedVector, 65186);
+    retVal = VecInsertTail(usedVector, 166);
+    retVal = VecInsertTail(usedVector, 1023);
+    retVal = VecInsertTail(usedVector, 5465);
+
+    if (0 != VecSort(usedVector))
+    {
+        printf("Invalid sort return value\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    for (int i = 0; i < usedVector->Count-1; i++)
+    {
+        if (usedVector->Array[i] - usedVector->Array[i + 1] < 0)
+        {
+            printf("Invalid sort!\n");
+            retVal = -1;
+            goto cleanup;
+        }
+    }
+
+    //on both sides of the insertion sort, ninther and radix sort limits, with random, ordered
+    //and almost ordered input
+    {
+        int sortCounts[] = { 0, 1, 2, 15, 17, 100, 200, SRT_RADIX_LIMIT - 1, SRT_RADIX_LIMIT, 100000, 4 * SRT_PARALLEL_MIN_CHUNK + 1 };
+
+        for (int i = 0; i < (int)(sizeof(sortCounts) / sizeof(sortCounts[0])); i++)
+        {
+            for (int pattern = 0; pattern < 6; pattern++)
+            {
+                if (0 != TestVectorSortPattern(sizedVector, sortCounts[i], pattern))
+                {
+                    printf("VecSortEx failed!\n");
+                    retVal = -1;
+                    goto cleanup;
+                }
+            }
+        }
+    }
+    if (-1 != VecSortEx(usedVector, 2))
+    {
+        printf("VecSortEx accepted an invalid order!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+    if (-1 != VecSortParallel(usedVector, 0) || 0 != VecSortParallel(usedVector, 8))
+    {
+        printf("VecSortParallel failed!\n");
+        retVal = -1;
+        goto cleanup;
+    }
+
+    retVal = VecClear(usedVector);
+    if (0 != retVal)
+    {
+        printf("VecClear failed!\n");
+        goto cleanup;
+    }
+
+    retVal = VecInsertTail(usedVector, 15);
+    retVal = VecInsertTail(usedVector, 150);
     retVal = VecInsertTail(usedVector, 425);
     retVal = VecInsertTail(usedVector2, 65465);
     retVal = VecInsertTail(usedVector2, 2156);
@@ -563,6 +2323,12 @@ int TestVector()
     }
 
 cleanup:
+    if (NULL != sizedVector)
+    {
+        VecDestroy(&sizedVector);
+    }
+    //the threads started by VecSortParallel would show as leaks
+    TpReleaseSharedPool();
     retVal = VecDestroy(&usedVector2);
     if (NULL != usedVector)
     {